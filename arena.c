@@ -0,0 +1,141 @@
+#include "./arena.h"
+#include "./stats.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Smallest chunk; later chunks double in size so that a snapshot of any
+ * size ends up in a handful of them.
+ */
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+	struct arena_chunk* next;
+	size_t              cap;
+	size_t              used;
+	char                data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+static size_t
+arena_align(size_t len)
+{
+	return (len + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static struct arena_chunk*
+arena_chunk_new(struct arena_chunk* prev, size_t len)
+{
+	struct arena_chunk* chunk;
+	size_t              cap = ARENA_CHUNK_SIZE;
+
+	if (prev != NULL && prev->cap * 2 > cap) {
+		cap = prev->cap * 2;
+	}
+
+	while (cap < len) {
+		cap *= 2;
+	}
+
+	chunk = malloc(sizeof(*chunk) + cap);
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	chunk->next = NULL;
+	chunk->cap  = cap;
+	chunk->used = 0;
+	stats_memory(cap);
+
+	return chunk;
+}
+
+void*
+arena_alloc(struct arena* arena, size_t len)
+{
+	struct arena_chunk* chunk = arena->current;
+
+	len = arena_align(len);
+
+	/**
+	 * Chunks after the current one are left over from bigger snapshots
+	 * and are emptied as we move into them.
+	 */
+	while (chunk == NULL || chunk->used + len > chunk->cap) {
+		struct arena_chunk* next =
+		  chunk != NULL ? chunk->next : arena->head;
+
+		if (next == NULL) {
+			next = arena_chunk_new(chunk, len);
+			if (next == NULL) {
+				return NULL;
+			}
+
+			if (chunk != NULL) {
+				chunk->next = next;
+			} else {
+				arena->head = next;
+			}
+		}
+
+		chunk       = next;
+		chunk->used = 0;
+	}
+
+	arena->current = chunk;
+	arena->last    = chunk->data + chunk->used;
+	chunk->used += len;
+
+	return arena->last;
+}
+
+void*
+arena_extend(struct arena* arena, void* ptr, size_t old_len, size_t len)
+{
+	struct arena_chunk* chunk = arena->current;
+	void*               moved;
+
+	if (ptr != NULL && ptr == arena->last) {
+		size_t offset = (char*)ptr - chunk->data;
+
+		if (offset + arena_align(len) <= chunk->cap) {
+			chunk->used = offset + arena_align(len);
+			return ptr;
+		}
+	}
+
+	moved = arena_alloc(arena, len);
+	if (moved != NULL && ptr != NULL) {
+		memcpy(moved, ptr, old_len < len ? old_len : len);
+	}
+
+	return moved;
+}
+
+void
+arena_reset(struct arena* arena)
+{
+	arena->current = arena->head;
+	arena->last    = NULL;
+	if (arena->head != NULL) {
+		arena->head->used = 0;
+	}
+}
+
+void
+arena_free(struct arena* arena)
+{
+	struct arena_chunk* chunk = arena->head;
+
+	while (chunk != NULL) {
+		struct arena_chunk* next = chunk->next;
+
+		stats_memory(-(long)chunk->cap);
+		free(chunk);
+		chunk = next;
+	}
+
+	*arena = (struct arena){ 0 };
+}
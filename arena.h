@@ -0,0 +1,68 @@
+#ifndef IFACER__ARENA_H
+#define IFACER__ARENA_H
+
+/**
+ * arena - a bump allocator for the state of one snapshot (the links,
+ *         addresses and rendered output of one enumeration).
+ *
+ * Long-running modes enumerate over and over. Instead of a `malloc` and a
+ * `free` per object, everything belonging to a snapshot is carved out of an
+ * arena, and the whole snapshot is thrown away at once with `arena_reset`,
+ * which is O(1): the memory is kept (as a list of chunks) and handed out
+ * again by the next snapshot. Once an arena has grown to the size of a
+ * snapshot, enumerating doesn't touch the heap at all.
+ *
+ * Modes that want to compare a snapshot with the previous one keep two
+ * arenas and alternate between them (double buffering): the one being
+ * filled is reset, the other one still holds the previous snapshot.
+ *
+ * The memory held by all arenas (and its peak) is reported by `--stats`.
+ */
+
+#include <stddef.h>
+
+struct arena_chunk;
+
+struct arena {
+	struct arena_chunk* head;
+	struct arena_chunk* current;
+
+	/**
+	 * The most recent allocation, which `arena_extend` can grow in
+	 * place.
+	 */
+	void* last;
+};
+
+/**
+ * Returns `len` bytes (aligned for any type) or NULL if out of memory.
+ */
+void*
+arena_alloc(struct arena* arena, size_t len);
+
+/**
+ * Grows `ptr` (allocated from `arena`, `old_len` bytes long) to `len`
+ * bytes, in place if it's the most recent allocation and there's room
+ * left in its chunk, by copying it to a new allocation otherwise.
+ * `ptr` may be NULL.
+ *
+ * Returns the (possibly moved) allocation or NULL if out of memory, in
+ * which case `ptr` is left untouched.
+ */
+void*
+arena_extend(struct arena* arena, void* ptr, size_t old_len, size_t len);
+
+/**
+ * Releases everything allocated from `arena` (keeping its memory for the
+ * next allocations) in constant time.
+ */
+void
+arena_reset(struct arena* arena);
+
+/**
+ * Gives the memory of `arena` back to the system.
+ */
+void
+arena_free(struct arena* arena);
+
+#endif
@@ -0,0 +1,969 @@
+#define _GNU_SOURCE
+#include "./audit.h"
+#include "./ethtool.h"
+#include "./kio.h"
+#include "./nl.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ethtool.h>
+#include <linux/ethtool_netlink.h>
+#include <net/if.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum audit_key {
+	AUDIT_SPEED = 0,
+	AUDIT_RX_RING,
+	AUDIT_RX_RING_MAX,
+	AUDIT_TX_RING,
+	AUDIT_TX_RING_MAX,
+	AUDIT_RX_CHANNELS,
+	AUDIT_RX_CHANNELS_MAX,
+	AUDIT_TX_CHANNELS,
+	AUDIT_TX_CHANNELS_MAX,
+	AUDIT_COMBINED_CHANNELS,
+	AUDIT_COMBINED_CHANNELS_MAX,
+	AUDIT_RX_USECS,
+	AUDIT_TX_USECS,
+	AUDIT_RX_FRAMES,
+	AUDIT_TX_FRAMES,
+	AUDIT_ADAPTIVE_RX,
+	AUDIT_ADAPTIVE_TX,
+	AUDIT_KEY_COUNT,
+};
+
+/**
+ * Names of the numeric settings as used in the report and in baselines.
+ *
+ * `max` points to the setting holding the hardware maximum (or is 0 for
+ * settings that don't have one).
+ */
+static const struct {
+	const char*    name;
+	enum audit_key max;
+} audit_keys[AUDIT_KEY_COUNT] = {
+	[AUDIT_SPEED]             = { "speed", 0 },
+	[AUDIT_RX_RING]           = { "rx_ring", AUDIT_RX_RING_MAX },
+	[AUDIT_RX_RING_MAX]       = { "rx_ring_max", 0 },
+	[AUDIT_TX_RING]           = { "tx_ring", AUDIT_TX_RING_MAX },
+	[AUDIT_TX_RING_MAX]       = { "tx_ring_max", 0 },
+	[AUDIT_RX_CHANNELS]       = { "rx_channels", AUDIT_RX_CHANNELS_MAX },
+	[AUDIT_RX_CHANNELS_MAX]   = { "rx_channels_max", 0 },
+	[AUDIT_TX_CHANNELS]       = { "tx_channels", AUDIT_TX_CHANNELS_MAX },
+	[AUDIT_TX_CHANNELS_MAX]   = { "tx_channels_max", 0 },
+	[AUDIT_COMBINED_CHANNELS] = { "combined_channels",
+	                              AUDIT_COMBINED_CHANNELS_MAX },
+	[AUDIT_COMBINED_CHANNELS_MAX] = { "combined_channels_max", 0 },
+	[AUDIT_RX_USECS]              = { "rx_usecs", 0 },
+	[AUDIT_TX_USECS]              = { "tx_usecs", 0 },
+	[AUDIT_RX_FRAMES]             = { "rx_frames", 0 },
+	[AUDIT_TX_FRAMES]             = { "tx_frames", 0 },
+	[AUDIT_ADAPTIVE_RX]           = { "adaptive_rx", 0 },
+	[AUDIT_ADAPTIVE_TX]           = { "adaptive_tx", 0 },
+};
+
+/**
+ * The baseline used when none is specified: the settings whose absence we
+ * most often find out about only after packet loss.
+ */
+static const char* audit_default_baseline = "rx-gro = on\n"
+                                            "rx-checksum = on\n"
+                                            "tx-generic-segmentation = on\n"
+                                            "rx_ring >= 1024\n"
+                                            "tx_ring >= 1024\n"
+                                            "combined_channels >= 2\n";
+
+/**
+ * Sections of settings, each one retrieved by a different request.
+ */
+enum audit_section {
+	AUDIT_SECTION_FEATURES = 1 << 0,
+	AUDIT_SECTION_RINGS    = 1 << 1,
+	AUDIT_SECTION_CHANNELS = 1 << 2,
+	AUDIT_SECTION_COALESCE = 1 << 3,
+	AUDIT_SECTION_SPEED    = 1 << 4,
+	AUDIT_SECTION_ALL      = (1 << 5) - 1,
+};
+
+struct audit_nic {
+	char     name[IFNAMSIZ];
+	unsigned ifindex;
+	unsigned sections;
+	uint32_t present;
+	uint32_t values[AUDIT_KEY_COUNT];
+	char (*features)[ETH_GSTRING_LEN];
+	size_t n_features;
+};
+
+enum audit_op {
+	AUDIT_OP_EQ = 0,
+	AUDIT_OP_NE,
+	AUDIT_OP_LT,
+	AUDIT_OP_LE,
+	AUDIT_OP_GT,
+	AUDIT_OP_GE,
+};
+
+static const char* audit_ops[] = {
+	[AUDIT_OP_EQ] = "=",  [AUDIT_OP_NE] = "!=", [AUDIT_OP_LT] = "<",
+	[AUDIT_OP_LE] = "<=", [AUDIT_OP_GT] = ">",  [AUDIT_OP_GE] = ">=",
+};
+
+/**
+ * A single baseline rule.
+ *
+ * `key` is -1 for rules about offload features, in which case `feature`
+ * holds its name and `value` is 1 (on) or 0 (off).
+ */
+struct audit_rule {
+	int           key;
+	char          feature[ETH_GSTRING_LEN];
+	enum audit_op op;
+	int           value_is_max;
+	unsigned long value;
+	char          text[128];
+};
+
+struct audit {
+	struct audit_nic*  nics;
+	size_t             n_nics;
+	struct audit_rule* rules;
+	size_t             n_rules;
+};
+
+static int
+audit_key_is_max(int key)
+{
+	for (int i = 0; i < AUDIT_KEY_COUNT; i++) {
+		if (audit_keys[i].max != 0 && (int)audit_keys[i].max == key) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+audit_nic_cmp(const void* a, const void* b)
+{
+	const struct audit_nic* x = a;
+	const struct audit_nic* y = b;
+
+	return (x->ifindex > y->ifindex) - (x->ifindex < y->ifindex);
+}
+
+static struct audit_nic*
+audit_nic_find(struct audit* audit, unsigned ifindex)
+{
+	struct audit_nic key = { .ifindex = ifindex };
+
+	return bsearch(&key,
+	               audit->nics,
+	               audit->n_nics,
+	               sizeof(*audit->nics),
+	               audit_nic_cmp);
+}
+
+static void
+audit_set(struct audit_nic* nic, enum audit_key key, uint32_t value)
+{
+	nic->values[key] = value;
+	nic->present |= 1u << key;
+}
+
+static void
+audit_set_attr(struct audit_nic*    nic,
+               enum audit_key       key,
+               const struct nlattr* attr,
+               int                  is_u8)
+{
+	if (attr != NULL) {
+		audit_set(
+		  nic, key, is_u8 ? nl_attr_u8(attr) : nl_attr_u32(attr));
+	}
+}
+
+static int
+audit_feature_add(struct audit_nic* nic, const char* name)
+{
+	void* features = realloc(
+	  nic->features, (nic->n_features + 1) * sizeof(*nic->features));
+
+	if (features == NULL) {
+		return -ENOMEM;
+	}
+
+	nic->features = features;
+	snprintf(nic->features[nic->n_features++], ETH_GSTRING_LEN, "%s", name);
+	return 0;
+}
+
+static int
+audit_feature_active(const struct audit_nic* nic, const char* name)
+{
+	for (size_t i = 0; i < nic->n_features; i++) {
+		if (!strcmp(nic->features[i], name)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Finds out which physical NICs exist.
+ */
+static int
+audit_load_nics(struct audit* audit)
+{
+	struct if_nameindex* ifaces = kio_if_nameindex();
+	int                  sysfs;
+
+	if (ifaces == NULL) {
+		perror("if_nameindex failed");
+		return -1;
+	}
+
+	sysfs = open("/sys/class/net", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	for (size_t i = 0; ifaces[i].if_index != 0; i++) {
+		char              path[IFNAMSIZ + sizeof("/device")];
+		struct audit_nic* nic;
+		void*             nics;
+
+		snprintf(path, sizeof(path), "%s/device", ifaces[i].if_name);
+		if (sysfs != -1 && faccessat(sysfs, path, F_OK, 0) == -1) {
+			continue;
+		}
+
+		nics = realloc(audit->nics, (audit->n_nics + 1) * sizeof(*nic));
+		if (nics == NULL) {
+			perror("realloc failed");
+			break;
+		}
+
+		audit->nics = nics;
+		nic         = &audit->nics[audit->n_nics++];
+		memset(nic, 0, sizeof(*nic));
+		nic->ifindex = ifaces[i].if_index;
+		snprintf(nic->name, sizeof(nic->name), "%s", ifaces[i].if_name);
+	}
+
+	if (sysfs != -1) {
+		close(sysfs);
+	}
+	if_freenameindex(ifaces);
+
+	qsort(audit->nics, audit->n_nics, sizeof(*audit->nics), audit_nic_cmp);
+	return 0;
+}
+
+/**
+ * Finds the NIC that an ethtool netlink reply refers to (by looking at the
+ * device index in its header attribute) and indexes the reply attributes.
+ */
+static struct audit_nic*
+audit_reply_nic(struct audit*          audit,
+                const struct nlmsghdr* msg,
+                const struct nlattr**  tb,
+                int                    max)
+{
+	const struct nlattr* header[ETHTOOL_A_HEADER_MAX + 1];
+
+	/**
+	 * Every ethtool reply carries its header as attribute number 1.
+	 */
+	nl_msg_parse(msg, GENL_HDRLEN, tb, max);
+	if (tb[1] == NULL) {
+		return NULL;
+	}
+
+	nl_attr_parse_nested(tb[1], header, ETHTOOL_A_HEADER_MAX);
+	if (header[ETHTOOL_A_HEADER_DEV_INDEX] == NULL) {
+		return NULL;
+	}
+
+	return audit_nic_find(audit,
+	                      nl_attr_u32(header[ETHTOOL_A_HEADER_DEV_INDEX]));
+}
+
+static int
+audit_features_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[ETHTOOL_A_FEATURES_MAX + 1];
+	const struct nlattr* bitset[ETHTOOL_A_BITSET_MAX + 1];
+	const struct nlattr* bit;
+	struct audit_nic*    nic;
+	int                  nomask;
+
+	nic = audit_reply_nic(data, msg, tb, ETHTOOL_A_FEATURES_MAX);
+	if (nic == NULL || tb[ETHTOOL_A_FEATURES_ACTIVE] == NULL) {
+		return 0;
+	}
+
+	nl_attr_parse_nested(
+	  tb[ETHTOOL_A_FEATURES_ACTIVE], bitset, ETHTOOL_A_BITSET_MAX);
+	if (bitset[ETHTOOL_A_BITSET_BITS] == NULL) {
+		return 0;
+	}
+
+	/**
+	 * Without a mask, the bitset only lists the bits that are set;
+	 * otherwise each bit carries a flag telling whether it is.
+	 */
+	nomask = bitset[ETHTOOL_A_BITSET_NOMASK] != NULL;
+
+	nl_attr_for_each_nested(bit, bitset[ETHTOOL_A_BITSET_BITS])
+	{
+		const struct nlattr* attrs[ETHTOOL_A_BITSET_BIT_MAX + 1];
+
+		nl_attr_parse_nested(bit, attrs, ETHTOOL_A_BITSET_BIT_MAX);
+		if (attrs[ETHTOOL_A_BITSET_BIT_NAME] == NULL ||
+		    (!nomask && attrs[ETHTOOL_A_BITSET_BIT_VALUE] == NULL)) {
+			continue;
+		}
+
+		if (audit_feature_add(
+		      nic, nl_attr_str(attrs[ETHTOOL_A_BITSET_BIT_NAME])) < 0) {
+			return -ENOMEM;
+		}
+	}
+
+	nic->sections |= AUDIT_SECTION_FEATURES;
+	return 0;
+}
+
+static int
+audit_rings_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[ETHTOOL_A_RINGS_MAX + 1];
+	struct audit_nic*    nic;
+
+	nic = audit_reply_nic(data, msg, tb, ETHTOOL_A_RINGS_MAX);
+	if (nic == NULL) {
+		return 0;
+	}
+
+	audit_set_attr(nic, AUDIT_RX_RING, tb[ETHTOOL_A_RINGS_RX], 0);
+	audit_set_attr(nic, AUDIT_RX_RING_MAX, tb[ETHTOOL_A_RINGS_RX_MAX], 0);
+	audit_set_attr(nic, AUDIT_TX_RING, tb[ETHTOOL_A_RINGS_TX], 0);
+	audit_set_attr(nic, AUDIT_TX_RING_MAX, tb[ETHTOOL_A_RINGS_TX_MAX], 0);
+
+	nic->sections |= AUDIT_SECTION_RINGS;
+	return 0;
+}
+
+static int
+audit_channels_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[ETHTOOL_A_CHANNELS_MAX + 1];
+	struct audit_nic*    nic;
+
+	nic = audit_reply_nic(data, msg, tb, ETHTOOL_A_CHANNELS_MAX);
+	if (nic == NULL) {
+		return 0;
+	}
+
+	audit_set_attr(
+	  nic, AUDIT_RX_CHANNELS, tb[ETHTOOL_A_CHANNELS_RX_COUNT], 0);
+	audit_set_attr(
+	  nic, AUDIT_RX_CHANNELS_MAX, tb[ETHTOOL_A_CHANNELS_RX_MAX], 0);
+	audit_set_attr(
+	  nic, AUDIT_TX_CHANNELS, tb[ETHTOOL_A_CHANNELS_TX_COUNT], 0);
+	audit_set_attr(
+	  nic, AUDIT_TX_CHANNELS_MAX, tb[ETHTOOL_A_CHANNELS_TX_MAX], 0);
+	audit_set_attr(nic,
+	               AUDIT_COMBINED_CHANNELS,
+	               tb[ETHTOOL_A_CHANNELS_COMBINED_COUNT],
+	               0);
+	audit_set_attr(nic,
+	               AUDIT_COMBINED_CHANNELS_MAX,
+	               tb[ETHTOOL_A_CHANNELS_COMBINED_MAX],
+	               0);
+
+	nic->sections |= AUDIT_SECTION_CHANNELS;
+	return 0;
+}
+
+static int
+audit_coalesce_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[ETHTOOL_A_COALESCE_MAX + 1];
+	struct audit_nic*    nic;
+
+	nic = audit_reply_nic(data, msg, tb, ETHTOOL_A_COALESCE_MAX);
+	if (nic == NULL) {
+		return 0;
+	}
+
+	audit_set_attr(nic, AUDIT_RX_USECS, tb[ETHTOOL_A_COALESCE_RX_USECS], 0);
+	audit_set_attr(nic, AUDIT_TX_USECS, tb[ETHTOOL_A_COALESCE_TX_USECS], 0);
+	audit_set_attr(
+	  nic, AUDIT_RX_FRAMES, tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES], 0);
+	audit_set_attr(
+	  nic, AUDIT_TX_FRAMES, tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES], 0);
+	audit_set_attr(
+	  nic, AUDIT_ADAPTIVE_RX, tb[ETHTOOL_A_COALESCE_USE_ADAPTIVE_RX], 1);
+	audit_set_attr(
+	  nic, AUDIT_ADAPTIVE_TX, tb[ETHTOOL_A_COALESCE_USE_ADAPTIVE_TX], 1);
+
+	nic->sections |= AUDIT_SECTION_COALESCE;
+	return 0;
+}
+
+static int
+audit_linkmodes_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[ETHTOOL_A_LINKMODES_MAX + 1];
+	struct audit_nic*    nic;
+
+	nic = audit_reply_nic(data, msg, tb, ETHTOOL_A_LINKMODES_MAX);
+	if (nic == NULL) {
+		return 0;
+	}
+
+	if (tb[ETHTOOL_A_LINKMODES_SPEED] != NULL &&
+	    nl_attr_u32(tb[ETHTOOL_A_LINKMODES_SPEED]) !=
+	      (uint32_t)SPEED_UNKNOWN) {
+		audit_set(
+		  nic, AUDIT_SPEED, nl_attr_u32(tb[ETHTOOL_A_LINKMODES_SPEED]));
+	}
+
+	nic->sections |= AUDIT_SECTION_SPEED;
+	return 0;
+}
+
+/**
+ * Issues a dump of an ethtool netlink `cmd` across all devices.
+ *
+ * `flags` are the ETHTOOL_FLAG_* to set in the request header: bitsets are
+ * requested in their verbose form only when we need the names of the bits.
+ */
+static int
+audit_dump(int           fd,
+           int           family,
+           uint8_t       cmd,
+           uint32_t      flags,
+           nl_msg_cb     cb,
+           struct audit* audit)
+{
+	struct {
+		struct nlmsghdr   hdr;
+		struct genlmsghdr genl;
+		char              attrs[64];
+	} req = { 0 };
+	struct nlattr* header;
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(GENL_HDRLEN);
+	req.hdr.nlmsg_type  = family;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.genl.cmd        = cmd;
+	req.genl.version    = ETHTOOL_GENL_VERSION;
+
+	header = nl_nest_start(&req.hdr, sizeof(req), 1);
+	nl_attr_put(
+	  &req.hdr, sizeof(req), ETHTOOL_A_HEADER_FLAGS, &flags, sizeof(flags));
+	nl_nest_end(&req.hdr, header);
+
+	return nl_transact(fd, &req.hdr, cb, audit);
+}
+
+/**
+ * Gathers the settings of every NIC with one dump per section over the
+ * ethtool generic netlink family.
+ *
+ * Failures are not fatal: whatever is missing is retrieved via ioctl.
+ */
+static void
+audit_gather_netlink(struct audit* audit)
+{
+	int fd;
+	int family;
+
+	fd = nl_open(NETLINK_GENERIC, 0);
+	if (fd == -1) {
+		return;
+	}
+
+	family = genl_family_id(fd, ETHTOOL_GENL_NAME);
+	if (family == -1) {
+		close(fd);
+		return;
+	}
+
+	audit_dump(
+	  fd, family, ETHTOOL_MSG_FEATURES_GET, 0, audit_features_cb, audit);
+	audit_dump(fd,
+	           family,
+	           ETHTOOL_MSG_RINGS_GET,
+	           ETHTOOL_FLAG_COMPACT_BITSETS,
+	           audit_rings_cb,
+	           audit);
+	audit_dump(fd,
+	           family,
+	           ETHTOOL_MSG_CHANNELS_GET,
+	           ETHTOOL_FLAG_COMPACT_BITSETS,
+	           audit_channels_cb,
+	           audit);
+	audit_dump(fd,
+	           family,
+	           ETHTOOL_MSG_COALESCE_GET,
+	           ETHTOOL_FLAG_COMPACT_BITSETS,
+	           audit_coalesce_cb,
+	           audit);
+	audit_dump(fd,
+	           family,
+	           ETHTOOL_MSG_LINKMODES_GET,
+	           ETHTOOL_FLAG_COMPACT_BITSETS,
+	           audit_linkmodes_cb,
+	           audit);
+
+	close(fd);
+}
+
+/**
+ * Retrieves the active offload features using the legacy interface: the
+ * names come from the ETH_SS_FEATURES string set and the values from
+ * ETHTOOL_GFEATURES, one bit per name.
+ */
+static void
+audit_ioctl_features(int fd, struct audit_nic* nic)
+{
+	struct ethtool_gstrings*  names;
+	struct ethtool_gfeatures* features;
+	uint32_t                  count;
+	uint32_t                  blocks;
+	size_t                    names_len;
+	size_t                    features_len;
+
+	count = ethtool_sset_count(fd, nic->name, ETH_SS_FEATURES);
+	if (count == 0) {
+		return;
+	}
+
+	blocks       = (count + 31) / 32;
+	names_len    = sizeof(*names) + count * ETH_GSTRING_LEN;
+	features_len = sizeof(*features) +
+	               blocks * sizeof(struct ethtool_get_features_block);
+	names    = calloc(1, names_len);
+	features = calloc(1, features_len);
+	if (names == NULL || features == NULL) {
+		goto out;
+	}
+
+	names->cmd        = ETHTOOL_GSTRINGS;
+	names->string_set = ETH_SS_FEATURES;
+	names->len        = count;
+	features->cmd     = ETHTOOL_GFEATURES;
+	features->size    = blocks;
+
+	if (ethtool_ioctl(fd, nic->name, names, names_len) == -1 ||
+	    ethtool_ioctl(fd, nic->name, features, features_len) == -1) {
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < count && i < names->len; i++) {
+		char name[ETH_GSTRING_LEN + 1] = { 0 };
+
+		if (!(features->features[i / 32].active & (1u << (i % 32)))) {
+			continue;
+		}
+
+		memcpy(
+		  name, names->data + i * ETH_GSTRING_LEN, ETH_GSTRING_LEN);
+		if (name[0] != '\0' && audit_feature_add(nic, name) < 0) {
+			break;
+		}
+	}
+
+	nic->sections |= AUDIT_SECTION_FEATURES;
+
+out:
+	free(names);
+	free(features);
+}
+
+/**
+ * Fills in whatever the netlink dumps didn't give us with per-interface
+ * SIOCETHTOOL requests.
+ */
+static void
+audit_gather_ioctl(struct audit* audit)
+{
+	int fd = -1;
+
+	for (size_t i = 0; i < audit->n_nics; i++) {
+		struct audit_nic* nic = &audit->nics[i];
+
+		if (nic->sections == AUDIT_SECTION_ALL) {
+			continue;
+		}
+
+		if (fd == -1) {
+			fd = kio_socket(AF_INET, SOCK_DGRAM, 0);
+			if (fd == -1) {
+				perror("cannot open socket");
+				return;
+			}
+		}
+
+		if (!(nic->sections & AUDIT_SECTION_FEATURES)) {
+			audit_ioctl_features(fd, nic);
+		}
+
+		if (!(nic->sections & AUDIT_SECTION_RINGS)) {
+			struct ethtool_ringparam ring = {
+				.cmd = ETHTOOL_GRINGPARAM
+			};
+
+			if (ethtool_ioctl(fd, nic->name, &ring, sizeof(ring)) ==
+			    0) {
+				audit_set(nic, AUDIT_RX_RING, ring.rx_pending);
+				audit_set(
+				  nic, AUDIT_RX_RING_MAX, ring.rx_max_pending);
+				audit_set(nic, AUDIT_TX_RING, ring.tx_pending);
+				audit_set(
+				  nic, AUDIT_TX_RING_MAX, ring.tx_max_pending);
+			}
+		}
+
+		if (!(nic->sections & AUDIT_SECTION_CHANNELS)) {
+			struct ethtool_channels ch = { .cmd =
+				                         ETHTOOL_GCHANNELS };
+
+			if (ethtool_ioctl(fd, nic->name, &ch, sizeof(ch)) ==
+			    0) {
+				audit_set(nic, AUDIT_RX_CHANNELS, ch.rx_count);
+				audit_set(
+				  nic, AUDIT_RX_CHANNELS_MAX, ch.max_rx);
+				audit_set(nic, AUDIT_TX_CHANNELS, ch.tx_count);
+				audit_set(
+				  nic, AUDIT_TX_CHANNELS_MAX, ch.max_tx);
+				audit_set(nic,
+				          AUDIT_COMBINED_CHANNELS,
+				          ch.combined_count);
+				audit_set(nic,
+				          AUDIT_COMBINED_CHANNELS_MAX,
+				          ch.max_combined);
+			}
+		}
+
+		if (!(nic->sections & AUDIT_SECTION_COALESCE)) {
+			struct ethtool_coalesce c = { .cmd =
+				                        ETHTOOL_GCOALESCE };
+
+			if (ethtool_ioctl(fd, nic->name, &c, sizeof(c)) == 0) {
+				audit_set(
+				  nic, AUDIT_RX_USECS, c.rx_coalesce_usecs);
+				audit_set(
+				  nic, AUDIT_TX_USECS, c.tx_coalesce_usecs);
+				audit_set(nic,
+				          AUDIT_RX_FRAMES,
+				          c.rx_max_coalesced_frames);
+				audit_set(nic,
+				          AUDIT_TX_FRAMES,
+				          c.tx_max_coalesced_frames);
+				audit_set(nic,
+				          AUDIT_ADAPTIVE_RX,
+				          c.use_adaptive_rx_coalesce);
+				audit_set(nic,
+				          AUDIT_ADAPTIVE_TX,
+				          c.use_adaptive_tx_coalesce);
+			}
+		}
+
+		if (!(nic->sections & AUDIT_SECTION_SPEED)) {
+			struct ethtool_cmd cmd = { .cmd = ETHTOOL_GSET };
+
+			if (ethtool_ioctl(fd, nic->name, &cmd, sizeof(cmd)) ==
+			      0 &&
+			    ethtool_cmd_speed(&cmd) !=
+			      (uint32_t)SPEED_UNKNOWN) {
+				audit_set(
+				  nic, AUDIT_SPEED, ethtool_cmd_speed(&cmd));
+			}
+		}
+	}
+
+	if (fd != -1) {
+		close(fd);
+	}
+}
+
+static int
+audit_parse_rule(const char* line, struct audit_rule* rule)
+{
+	char key[ETH_GSTRING_LEN];
+	char op[3];
+	char value[32];
+	int  i;
+
+	memset(rule, 0, sizeof(*rule));
+
+	if (sscanf(line, "%31s %2s %31s", key, op, value) != 3) {
+		return -1;
+	}
+
+	rule->op = (enum audit_op) - 1;
+	for (i = 0; i < (int)(sizeof(audit_ops) / sizeof(*audit_ops)); i++) {
+		if (!strcmp(op, audit_ops[i])) {
+			rule->op = i;
+		}
+	}
+	if ((int)rule->op == -1) {
+		return -1;
+	}
+
+	rule->key = -1;
+	for (i = 0; i < AUDIT_KEY_COUNT; i++) {
+		if (!strcmp(key, audit_keys[i].name)) {
+			rule->key = i;
+		}
+	}
+
+	if (!strcmp(value, "on")) {
+		rule->value = 1;
+	} else if (!strcmp(value, "off")) {
+		rule->value = 0;
+	} else if (!strcmp(value, "max")) {
+		if (rule->key == -1 || audit_keys[rule->key].max == 0) {
+			return -1;
+		}
+		rule->value_is_max = 1;
+	} else {
+		char* end;
+
+		rule->value = strtoul(value, &end, 10);
+		if (*end != '\0' || rule->key == -1) {
+			return -1;
+		}
+	}
+
+	snprintf(rule->feature, sizeof(rule->feature), "%s", key);
+	snprintf(rule->text, sizeof(rule->text), "%s %s %s", key, op, value);
+	return 0;
+}
+
+/**
+ * Parses the baseline rules out of `text`, one per line.
+ */
+static int
+audit_parse_baseline(struct audit* audit, const char* text)
+{
+	int lineno = 0;
+
+	while (*text != '\0') {
+		const char* eol = strchrnul(text, '\n');
+		char        line[256];
+		char*       start;
+
+		lineno++;
+		snprintf(line, sizeof(line), "%.*s", (int)(eol - text), text);
+		text = *eol == '\n' ? eol + 1 : eol;
+
+		start = line + strspn(line, " \t");
+		if (*start == '\0' || *start == '#') {
+			continue;
+		}
+
+		struct audit_rule* rules =
+		  realloc(audit->rules, (audit->n_rules + 1) * sizeof(*rules));
+		if (rules == NULL) {
+			perror("realloc failed");
+			return -1;
+		}
+		audit->rules = rules;
+
+		if (audit_parse_rule(start, &audit->rules[audit->n_rules]) <
+		    0) {
+			fprintf(stderr,
+			        "baseline:%d: invalid rule '%s'\n",
+			        lineno,
+			        start);
+			return -1;
+		}
+
+		audit->n_rules++;
+	}
+
+	return 0;
+}
+
+static int
+audit_load_baseline(struct audit* audit, const char* path)
+{
+	char*  text = NULL;
+	size_t len  = 0;
+	FILE*  file;
+	int    err;
+
+	if (path == NULL) {
+		return audit_parse_baseline(audit, audit_default_baseline);
+	}
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		perror("cannot open baseline");
+		return -1;
+	}
+
+	if (getdelim(&text, &len, '\0', file) == -1 && ferror(file)) {
+		perror("cannot read baseline");
+		fclose(file);
+		free(text);
+		return -1;
+	}
+	fclose(file);
+
+	err = audit_parse_baseline(audit, text != NULL ? text : "");
+	free(text);
+	return err;
+}
+
+static int
+audit_compare(enum audit_op op, unsigned long actual, unsigned long expected)
+{
+	switch (op) {
+		case AUDIT_OP_EQ:
+			return actual == expected;
+		case AUDIT_OP_NE:
+			return actual != expected;
+		case AUDIT_OP_LT:
+			return actual < expected;
+		case AUDIT_OP_LE:
+			return actual <= expected;
+		case AUDIT_OP_GT:
+			return actual > expected;
+		case AUDIT_OP_GE:
+			return actual >= expected;
+	}
+
+	return 0;
+}
+
+/**
+ * Prints the settings of a NIC followed by the rules it violates.
+ *
+ * Returns the number of deviations. Rules about settings that the NIC
+ * doesn't report are not considered deviations.
+ */
+static size_t
+audit_report(const struct audit* audit, const struct audit_nic* nic)
+{
+	size_t deviations = 0;
+
+	printf("iface: %s\n", nic->name);
+
+	for (int key = 0; key < AUDIT_KEY_COUNT; key++) {
+		int max = audit_keys[key].max;
+
+		/**
+		 * Maximums are printed next to the setting they bound.
+		 */
+		if (!(nic->present & (1u << key)) || audit_key_is_max(key)) {
+			continue;
+		}
+
+		if (max != 0 && (nic->present & (1u << max))) {
+			printf("%s: %u (max %u)\n",
+			       audit_keys[key].name,
+			       nic->values[key],
+			       nic->values[max]);
+		} else {
+			printf(
+			  "%s: %u\n", audit_keys[key].name, nic->values[key]);
+		}
+	}
+
+	if (nic->sections & AUDIT_SECTION_FEATURES) {
+		printf("features:");
+		for (size_t i = 0; i < nic->n_features; i++) {
+			printf(" %s", nic->features[i]);
+		}
+		printf("\n");
+	}
+
+	for (size_t i = 0; i < audit->n_rules; i++) {
+		const struct audit_rule* rule = &audit->rules[i];
+		unsigned long            actual;
+		unsigned long            expected = rule->value;
+
+		if (rule->key == -1) {
+			if (!(nic->sections & AUDIT_SECTION_FEATURES)) {
+				continue;
+			}
+			actual = audit_feature_active(nic, rule->feature);
+		} else {
+			if (!(nic->present & (1u << rule->key))) {
+				continue;
+			}
+			actual = nic->values[rule->key];
+
+			if (rule->value_is_max) {
+				int max = audit_keys[rule->key].max;
+
+				if (!(nic->present & (1u << max))) {
+					continue;
+				}
+				expected = nic->values[max];
+			}
+		}
+
+		if (audit_compare(rule->op, actual, expected)) {
+			continue;
+		}
+
+		deviations++;
+		if (rule->key == -1) {
+			printf("deviation: %s (is %s)\n",
+			       rule->text,
+			       actual ? "on" : "off");
+		} else {
+			printf("deviation: %s (is %lu)\n", rule->text, actual);
+		}
+	}
+
+	printf("\n");
+	return deviations;
+}
+
+int
+audit_run(const char* baseline_path)
+{
+	struct audit audit      = { 0 };
+	size_t       deviations = 0;
+	int          ret        = 0;
+
+	if (audit_load_baseline(&audit, baseline_path) < 0) {
+		return 1;
+	}
+
+	if (audit_load_nics(&audit) < 0) {
+		free(audit.rules);
+		return 2;
+	}
+
+	audit_gather_netlink(&audit);
+	audit_gather_ioctl(&audit);
+
+	for (size_t i = 0; i < audit.n_nics; i++) {
+		deviations += audit_report(&audit, &audit.nics[i]);
+	}
+
+	printf("deviations: %zu\n", deviations);
+	if (deviations > 0) {
+		ret = 3;
+	}
+
+	for (size_t i = 0; i < audit.n_nics; i++) {
+		free(audit.nics[i].features);
+	}
+	free(audit.nics);
+	free(audit.rules);
+
+	return ret;
+}
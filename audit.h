@@ -0,0 +1,47 @@
+#ifndef IFACER__AUDIT_H
+#define IFACER__AUDIT_H
+
+/**
+ * audit - reports the tuning of every physical NIC (offload features, ring
+ *         sizes, channels, interrupt coalescing and link speed) and flags
+ *         the settings that deviate from a baseline.
+ *
+ * Physical NICs are the interfaces that have a `device` entry under
+ * `/sys/class/net/<iface>`, i.e., the ones backed by a bus device instead of
+ * being purely virtual (bridges, veths, tunnels, ...).
+ *
+ * The settings are gathered with the ethtool generic netlink family when the
+ * kernel has it (Linux 5.6+). There, a single dump request per kind of
+ * setting covers every device at once, so the number of round trips doesn't
+ * grow with the number of NICs. Whatever can't be gathered that way (older
+ * kernels, or drivers that only implement the legacy operations) is then
+ * retrieved per interface with the SIOCETHTOOL `ioctl(2)` (see `ethtool.h`).
+ *
+ * A baseline is a text file with one rule per line:
+ *
+ *      # comments start with a hash
+ *      rx-gro = on
+ *      rx_ring >= 1024
+ *      combined_channels >= max
+ *
+ * where the left-hand side is either one of the numeric settings
+ * (speed, rx_ring, tx_ring, rx_channels, tx_channels, combined_channels,
+ * rx_usecs, tx_usecs, rx_frames, tx_frames, adaptive_rx, adaptive_tx) or
+ * the name of an offload feature as the kernel calls it (see
+ * `ethtool -k`), the operator is one of `=`, `!=`, `<`, `<=`, `>` and `>=`,
+ * and the right-hand side is a number, `on`/`off` or, for rings and
+ * channels, `max` (the maximum supported by the hardware).
+ */
+
+/**
+ * Audits every physical NIC against the baseline at `baseline_path` (or
+ * against a built-in baseline if NULL), printing the settings of each NIC
+ * followed by the deviations found.
+ *
+ * Returns 0 when no NIC deviates, 3 when at least one does and another
+ * non-zero exit code if the audit could not be performed.
+ */
+int
+audit_run(const char* baseline_path);
+
+#endif
@@ -0,0 +1,755 @@
+#define _GNU_SOURCE
+#include "./ethtool.h"
+#include "./arena.h"
+#include "./kio.h"
+#include "./probes.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The set of statistic names of a given driver as retrieved via
+ * ETHTOOL_GSTRINGS.
+ *
+ * Entries are immutable once inserted in the cache, so jobs can keep
+ * pointers to them without holding the pool lock.
+ */
+struct ethtool_strings {
+	char                     driver[32];
+	uint32_t                 count;
+	struct ethtool_gstrings* raw;
+	struct ethtool_strings*  next;
+};
+
+enum ethtool_job_state {
+	ETHTOOL_JOB_PENDING = 0,
+	ETHTOOL_JOB_RUNNING,
+	ETHTOOL_JOB_DONE,
+	ETHTOOL_JOB_TIMEDOUT,
+};
+
+/**
+ * The query of a single interface.
+ *
+ * `deadline` is only meaningful once the job is running (i.e., a worker
+ * picked it up). `out` is the record of the interface, already rendered by
+ * the worker that queried it (NULL if it couldn't be).
+ */
+struct ethtool_job {
+	char                   name[IFNAMSIZ];
+	enum ethtool_job_state state;
+	struct timespec        deadline;
+	const char*            out;
+	size_t                 out_len;
+};
+
+/**
+ * Each worker renders the records of its interfaces into an arena of its
+ * own, so workers never contend on the output: records are only put in
+ * order (and written with a single `writev(2)`) once all of them are in.
+ * Arena allocations never move, so a record stays valid while its worker
+ * keeps rendering others.
+ */
+struct ethtool_worker {
+	struct ethtool_pool*   pool;
+	struct arena           arena;
+	struct ethtool_worker* next;
+};
+
+/**
+ * A record being rendered into an arena.
+ */
+struct ethtool_out {
+	struct arena* arena;
+	char*         data;
+	size_t        len;
+	size_t        cap;
+	int           failed;
+};
+
+/**
+ * State shared between the workers and the thread that waits for them.
+ *
+ * Every field is protected by `lock`, including the driver strings cache.
+ */
+struct ethtool_pool {
+	pthread_mutex_t         lock;
+	pthread_cond_t          cond;
+	int                     fd;
+	int                     timeout_ms;
+	struct ethtool_job*     jobs;
+	size_t                  n_jobs;
+	size_t                  next;
+	size_t                  remaining;
+	size_t                  workers;
+	size_t                  timed_out;
+	struct ethtool_strings* cache;
+	struct ethtool_worker*  worker_list;
+};
+
+static void
+timespec_add_ms(struct timespec* ts, int ms)
+{
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec += 1;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static int
+timespec_before(const struct timespec* a, const struct timespec* b)
+{
+	return a->tv_sec < b->tv_sec ||
+	       (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void __attribute__((format(printf, 2, 3)))
+ethtool_out_printf(struct ethtool_out* out, const char* fmt, ...)
+{
+	va_list ap;
+	int     n;
+
+	while (!out->failed) {
+		va_start(ap, fmt);
+		n =
+		  vsnprintf(out->data + out->len, out->cap - out->len, fmt, ap);
+		va_end(ap);
+
+		if (n >= 0 && (size_t)n < out->cap - out->len) {
+			out->len += n;
+			return;
+		}
+
+		if (n >= 0) {
+			size_t cap  = out->cap ? out->cap * 2 : 4096;
+			char*  data = NULL;
+
+			while (cap < out->len + n + 1) {
+				cap *= 2;
+			}
+
+			data =
+			  arena_extend(out->arena, out->data, out->len, cap);
+			if (data != NULL) {
+				out->data = data;
+				out->cap  = cap;
+				continue;
+			}
+		}
+
+		out->failed = 1;
+	}
+}
+
+/**
+ * Gives the room the record didn't use back to the arena (it's the most
+ * recent allocation, so it shrinks in place).
+ */
+static void
+ethtool_out_finish(struct ethtool_out* out)
+{
+	if (!out->failed) {
+		arena_extend(out->arena, out->data, out->len, out->len);
+	}
+}
+
+int
+ethtool_ioctl(int fd, const char* name, void* cmd, size_t len)
+{
+	struct ifreq ifr = { 0 };
+
+	snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", name);
+	ifr.ifr_data = cmd;
+
+	return kio_ioctl(fd, SIOCETHTOOL, &ifr, cmd, len);
+}
+
+uint32_t
+ethtool_sset_count(int fd, const char* name, int set)
+{
+	union {
+		struct ethtool_sset_info info;
+		uint8_t buf[sizeof(struct ethtool_sset_info) + sizeof(__u32)];
+	} sset = { 0 };
+
+	sset.info.cmd       = ETHTOOL_GSSET_INFO;
+	sset.info.sset_mask = 1ULL << set;
+
+	if (ethtool_ioctl(fd, name, &sset, sizeof(sset)) == 0 &&
+	    sset.info.sset_mask != 0) {
+		return sset.info.data[0];
+	}
+
+	return 0;
+}
+
+/**
+ * Retrieves the number of statistics that the interface exposes.
+ *
+ * ETHTOOL_GSSET_INFO is preferred as the count in ETHTOOL_GDRVINFO is
+ * deprecated (and not filled by every driver).
+ */
+static uint32_t
+ethtool_stats_count(int                           fd,
+                    const char*                   name,
+                    const struct ethtool_drvinfo* drvinfo)
+{
+	uint32_t count = ethtool_sset_count(fd, name, ETH_SS_STATS);
+
+	return count != 0 ? count : drvinfo->n_stats;
+}
+
+static const struct ethtool_strings*
+ethtool_cache_lookup(struct ethtool_pool* pool,
+                     const char*          driver,
+                     uint32_t             count)
+{
+	struct ethtool_strings* entry;
+
+	for (entry = pool->cache; entry != NULL; entry = entry->next) {
+		if (entry->count == count && !strcmp(entry->driver, driver)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Retrieves the statistic names for the driver of the interface, going to
+ * the kernel only if no other interface with the same driver (and the same
+ * number of statistics) has been seen before.
+ *
+ * The lock is not held while issuing the ioctl, so two workers may race
+ * to fill the same entry; the loser simply discards its copy.
+ */
+static const struct ethtool_strings*
+ethtool_strings_get(struct ethtool_pool* pool,
+                    const char*          name,
+                    const char*          driver,
+                    uint32_t             count,
+                    int*                 err)
+{
+	const struct ethtool_strings* cached;
+	struct ethtool_strings*       entry;
+	size_t                        len;
+
+	pthread_mutex_lock(&pool->lock);
+	cached = ethtool_cache_lookup(pool, driver, count);
+	pthread_mutex_unlock(&pool->lock);
+	if (cached != NULL) {
+		return cached;
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		*err = errno;
+		return NULL;
+	}
+
+	len        = sizeof(*entry->raw) + count * ETH_GSTRING_LEN;
+	entry->raw = calloc(1, len);
+	if (entry->raw == NULL) {
+		*err = errno;
+		free(entry);
+		return NULL;
+	}
+
+	entry->raw->cmd        = ETHTOOL_GSTRINGS;
+	entry->raw->string_set = ETH_SS_STATS;
+	entry->raw->len        = count;
+
+	if (ethtool_ioctl(pool->fd, name, entry->raw, len) == -1) {
+		*err = errno;
+		free(entry->raw);
+		free(entry);
+		return NULL;
+	}
+
+	snprintf(entry->driver, sizeof(entry->driver), "%s", driver);
+	entry->count = entry->raw->len < count ? entry->raw->len : count;
+
+	pthread_mutex_lock(&pool->lock);
+	cached = ethtool_cache_lookup(pool, driver, count);
+	if (cached == NULL) {
+		entry->next = pool->cache;
+		pool->cache = entry;
+		cached      = entry;
+		entry       = NULL;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (entry != NULL) {
+		free(entry->raw);
+		free(entry);
+	}
+
+	return cached;
+}
+
+/**
+ * Performs all of the ethtool requests for a single interface.
+ *
+ * Returns 0 on success or the errno of the request that failed.
+ */
+static int
+ethtool_query(struct ethtool_pool*           pool,
+              const char*                    name,
+              char*                          driver,
+              const struct ethtool_strings** strings,
+              struct ethtool_stats**         stats)
+{
+	struct ethtool_drvinfo drvinfo = { .cmd = ETHTOOL_GDRVINFO };
+	struct ethtool_stats*  values;
+	uint32_t               count;
+	size_t                 len;
+	int                    err = 0;
+
+	if (ethtool_ioctl(pool->fd, name, &drvinfo, sizeof(drvinfo)) == -1) {
+		return errno;
+	}
+
+	memcpy(driver, drvinfo.driver, sizeof(drvinfo.driver));
+	driver[sizeof(drvinfo.driver) - 1] = '\0';
+
+	count = ethtool_stats_count(pool->fd, name, &drvinfo);
+	if (count == 0) {
+		return 0;
+	}
+
+	*strings = ethtool_strings_get(pool, name, driver, count, &err);
+	if (*strings == NULL) {
+		return err;
+	}
+
+	len    = sizeof(*values) + count * sizeof(__u64);
+	values = calloc(1, len);
+	if (values == NULL) {
+		return errno;
+	}
+
+	values->cmd     = ETHTOOL_GSTATS;
+	values->n_stats = count;
+
+	if (ethtool_ioctl(pool->fd, name, values, len) == -1) {
+		err = errno;
+		free(values);
+		return err;
+	}
+
+	*stats = values;
+	return 0;
+}
+
+/**
+ * Renders the record of an interface whose query is over.
+ */
+static void
+ethtool_render(struct ethtool_out*           out,
+               const char*                   name,
+               int                           err,
+               const char*                   driver,
+               const struct ethtool_strings* strings,
+               const struct ethtool_stats*   stats)
+{
+	ethtool_out_printf(out, "iface: %s\n", name);
+
+	if (err != 0) {
+		ethtool_out_printf(out, "error: %s\n\n", strerror(err));
+		return;
+	}
+
+	ethtool_out_printf(out, "driver: %s\n", driver);
+
+	if (stats != NULL) {
+		uint32_t count = strings->count;
+
+		if (stats->n_stats < count) {
+			count = stats->n_stats;
+		}
+
+		for (uint32_t j = 0; j < count; j++) {
+			ethtool_out_printf(out,
+			                   "%.*s: %llu\n",
+			                   ETH_GSTRING_LEN,
+			                   (const char*)strings->raw->data +
+			                     j * ETH_GSTRING_LEN,
+			                   (unsigned long long)stats->data[j]);
+		}
+	}
+
+	ethtool_out_printf(out, "\n");
+}
+
+static void*
+ethtool_worker(void* arg)
+{
+	struct ethtool_worker* worker = arg;
+	struct ethtool_pool*   pool   = worker->pool;
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->next < pool->n_jobs) {
+		struct ethtool_job*           job = &pool->jobs[pool->next++];
+		struct ethtool_out            out = { .arena = &worker->arena };
+		const struct ethtool_strings* strings = NULL;
+		struct ethtool_stats*         stats   = NULL;
+		char                          driver[32];
+		int                           err;
+
+		job->state = ETHTOOL_JOB_RUNNING;
+		clock_gettime(CLOCK_MONOTONIC, &job->deadline);
+		timespec_add_ms(&job->deadline, pool->timeout_ms);
+		pthread_mutex_unlock(&pool->lock);
+
+		PROBE2(iface__start, job - pool->jobs, job->name);
+		err = ethtool_query(pool, job->name, driver, &strings, &stats);
+		PROBE3(iface__end, job - pool->jobs, job->name, err);
+
+		ethtool_render(&out, job->name, err, driver, strings, stats);
+		ethtool_out_finish(&out);
+		free(stats);
+
+		pthread_mutex_lock(&pool->lock);
+		if (job->state != ETHTOOL_JOB_RUNNING) {
+			/**
+			 * We took too long: the job has already been reported
+			 * as timed out and another worker took our place, so
+			 * step out of the pool.
+			 */
+			break;
+		}
+
+		job->state = ETHTOOL_JOB_DONE;
+		if (!out.failed) {
+			job->out     = out.data;
+			job->out_len = out.len;
+		}
+		pool->remaining--;
+		pthread_cond_signal(&pool->cond);
+	}
+
+	pool->workers--;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/**
+ * Starts a detached worker. Must be called with the pool lock held.
+ */
+static int
+ethtool_spawn_worker(struct ethtool_pool* pool)
+{
+	struct ethtool_worker* worker;
+	pthread_attr_t         attr;
+	pthread_t              thread;
+	int                    err;
+
+	worker = calloc(1, sizeof(*worker));
+	if (worker == NULL) {
+		return errno;
+	}
+
+	worker->pool = pool;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	err = pthread_create(&thread, &attr, ethtool_worker, worker);
+	pthread_attr_destroy(&attr);
+	if (err != 0) {
+		free(worker);
+		return err;
+	}
+
+	worker->next      = pool->worker_list;
+	pool->worker_list = worker;
+	pool->workers++;
+
+	return 0;
+}
+
+/**
+ * Waits until every job is either done or timed out.
+ *
+ * The wait always targets the earliest deadline among the running jobs,
+ * so a slow interface is flagged as soon as its deadline passes rather
+ * than when the slowest one finishes. Must be called with the pool lock
+ * held.
+ */
+static void
+ethtool_pool_wait(struct ethtool_pool* pool)
+{
+	struct timespec now;
+
+	while (pool->remaining > 0) {
+		struct timespec* earliest = NULL;
+
+		for (size_t i = 0; i < pool->n_jobs; i++) {
+			struct ethtool_job* job = &pool->jobs[i];
+
+			if (job->state == ETHTOOL_JOB_RUNNING &&
+			    (earliest == NULL ||
+			     timespec_before(&job->deadline, earliest))) {
+				earliest = &job->deadline;
+			}
+		}
+
+		if (earliest == NULL) {
+			pthread_cond_wait(&pool->cond, &pool->lock);
+			continue;
+		}
+
+		pthread_cond_timedwait(&pool->cond, &pool->lock, earliest);
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		for (size_t i = 0; i < pool->n_jobs; i++) {
+			struct ethtool_job* job = &pool->jobs[i];
+
+			if (job->state != ETHTOOL_JOB_RUNNING ||
+			    timespec_before(&now, &job->deadline)) {
+				continue;
+			}
+
+			job->state = ETHTOOL_JOB_TIMEDOUT;
+			pool->remaining--;
+			pool->timed_out++;
+
+			if (pool->next < pool->n_jobs) {
+				ethtool_spawn_worker(pool);
+			}
+		}
+	}
+
+	/**
+	 * Workers that are still blocked in the kernel keep a reference to
+	 * the pool, so we can only wait for the ones that are not.
+	 */
+	while (pool->workers > pool->timed_out) {
+		pthread_cond_wait(&pool->cond, &pool->lock);
+	}
+}
+
+/**
+ * Writes the records of every interface, in order, with as few `writev(2)`
+ * calls as IOV_MAX allows. Records the workers couldn't render (timed out
+ * or out of memory) are rendered here, into `arena`.
+ */
+static int
+ethtool_print(struct ethtool_pool* pool, struct arena* arena)
+{
+	struct iovec* iov;
+	size_t        n_iov = 0;
+	int           ret   = 0;
+
+	iov = calloc(pool->n_jobs ? pool->n_jobs : 1, sizeof(*iov));
+	if (iov == NULL) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < pool->n_jobs; i++) {
+		struct ethtool_job* job = &pool->jobs[i];
+
+		if (job->out == NULL) {
+			struct ethtool_out out = { .arena = arena };
+
+			ethtool_out_printf(&out, "iface: %s\n", job->name);
+			if (job->state == ETHTOOL_JOB_TIMEDOUT) {
+				ethtool_out_printf(
+				  &out,
+				  "error: timed out after %dms\n\n",
+				  pool->timeout_ms);
+			} else {
+				ethtool_out_printf(
+				  &out, "error: %s\n\n", strerror(ENOMEM));
+			}
+
+			if (out.failed) {
+				free(iov);
+				return -1;
+			}
+
+			ethtool_out_finish(&out);
+
+			job->out     = out.data;
+			job->out_len = out.len;
+		}
+
+		iov[n_iov++] = (struct iovec){
+			.iov_base = (void*)job->out,
+			.iov_len  = job->out_len,
+		};
+	}
+
+	/**
+	 * Nothing else is printed by this mode, but whatever stdio holds
+	 * must go first.
+	 */
+	fflush(stdout);
+
+	for (struct iovec* next = iov; n_iov > 0 && ret == 0;) {
+		ssize_t n = writev(
+		  STDOUT_FILENO, next, n_iov < IOV_MAX ? n_iov : IOV_MAX);
+
+		if (n == -1) {
+			if (errno != EINTR) {
+				ret = -1;
+			}
+			continue;
+		}
+
+		while (n_iov > 0 && (size_t)n >= next->iov_len) {
+			n -= next->iov_len;
+			next++;
+			n_iov--;
+		}
+
+		if (n > 0) {
+			next->iov_base = (char*)next->iov_base + n;
+			next->iov_len -= n;
+		}
+	}
+
+	free(iov);
+	return ret;
+}
+
+int
+ethtool_stats_run(int timeout_ms, int jobs)
+{
+	struct ethtool_pool* pool;
+	struct if_nameindex* ifaces;
+	pthread_condattr_t   condattr;
+	struct arena         arena    = { 0 };
+	size_t               n_ifaces = 0;
+	int                  ret      = 0;
+
+	if (timeout_ms <= 0) {
+		timeout_ms = ETHTOOL_DEFAULT_TIMEOUT_MS;
+	}
+
+	if (jobs <= 0) {
+		jobs = ETHTOOL_DEFAULT_JOBS;
+	}
+
+	ifaces = kio_if_nameindex();
+	if (ifaces == NULL) {
+		perror("if_nameindex failed");
+		return 2;
+	}
+
+	while (ifaces[n_ifaces].if_index != 0) {
+		n_ifaces++;
+	}
+
+	/**
+	 * The pool is heap-allocated and purposefully leaked when an
+	 * interface times out: the worker stuck in the kernel will touch it
+	 * once the ioctl returns.
+	 */
+	pool = calloc(1, sizeof(*pool));
+	if (pool == NULL) {
+		perror("calloc failed");
+		if_freenameindex(ifaces);
+		return 1;
+	}
+
+	pool->jobs = calloc(n_ifaces ? n_ifaces : 1, sizeof(*pool->jobs));
+	if (pool->jobs == NULL) {
+		perror("calloc failed");
+		if_freenameindex(ifaces);
+		free(pool);
+		return 1;
+	}
+
+	for (size_t i = 0; i < n_ifaces; i++) {
+		snprintf(pool->jobs[i].name, IFNAMSIZ, "%s", ifaces[i].if_name);
+	}
+	if_freenameindex(ifaces);
+
+	pool->n_jobs     = n_ifaces;
+	pool->remaining  = n_ifaces;
+	pool->timeout_ms = timeout_ms;
+
+	pool->fd = kio_socket(AF_INET, SOCK_DGRAM, 0);
+	if (pool->fd == -1) {
+		perror("cannot open socket");
+		free(pool->jobs);
+		free(pool);
+		return 1;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_condattr_init(&condattr);
+	pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&pool->cond, &condattr);
+	pthread_condattr_destroy(&condattr);
+
+	pthread_mutex_lock(&pool->lock);
+	for (size_t i = 0; i < (size_t)jobs && i < n_ifaces; i++) {
+		if (ethtool_spawn_worker(pool) != 0) {
+			break;
+		}
+	}
+
+	if (pool->workers == 0 && n_ifaces > 0) {
+		pthread_mutex_unlock(&pool->lock);
+		fprintf(stderr, "cannot start ethtool workers\n");
+		return 1;
+	}
+
+	ethtool_pool_wait(pool);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (ethtool_print(pool, &arena) != 0) {
+		perror("cannot write statistics");
+		ret = 1;
+	}
+
+	arena_free(&arena);
+
+	if (pool->timed_out > 0) {
+		return ret;
+	}
+
+	while (pool->worker_list != NULL) {
+		struct ethtool_worker* next = pool->worker_list->next;
+
+		arena_free(&pool->worker_list->arena);
+		free(pool->worker_list);
+		pool->worker_list = next;
+	}
+
+	while (pool->cache != NULL) {
+		struct ethtool_strings* next = pool->cache->next;
+
+		free(pool->cache->raw);
+		free(pool->cache);
+		pool->cache = next;
+	}
+
+	close(pool->fd);
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->jobs);
+	free(pool);
+
+	return ret;
+}
@@ -0,0 +1,84 @@
+#ifndef IFACER__ETHTOOL_H
+#define IFACER__ETHTOOL_H
+
+/**
+ * ethtool - retrieves the driver-specific statistics (the ones that
+ *           `ethtool -S <iface>` shows) of every network interface.
+ *
+ * The counters are gathered through the SIOCETHTOOL `ioctl(2)` request
+ * code, which (differently from SIOCGIFCONF and SIOCGIFADDR) carries a
+ * pointer to an ethtool command structure in `ifr_data`:
+ *
+ *   - ETHTOOL_GDRVINFO         : tells us the driver bound to the interface;
+ *   - ETHTOOL_GSSET_INFO       : tells us how many statistics there are;
+ *   - ETHTOOL_GSTRINGS         : gives us the name of each statistic; and
+ *   - ETHTOOL_GSTATS           : gives us the value of each statistic.
+ *
+ * Given that the names of the statistics only depend on the driver (and on
+ * how many of them the driver exposes), they're cached per driver so that
+ * hosts with dozens of identical NICs only pay for ETHTOOL_GSTRINGS once.
+ *
+ * Some drivers block for milliseconds while answering these requests (they
+ * talk to the firmware), so the queries are spread across a small pool of
+ * threads. Each interface gets its own deadline that starts counting when a
+ * worker picks it up; interfaces that don't answer in time are reported as
+ * timed out and the worker that got stuck is replaced so that the remaining
+ * interfaces are not held back by it.
+ *
+ * Workers also render the records of the interfaces they queried, each
+ * into a buffer of its own, so the output doesn't serialize them through
+ * a locked stdio stream; the records are written out in interface order
+ * with a single `writev(2)` once every interface is accounted for.
+ *
+ * See `man 8 ethtool` and `linux/ethtool.h` for more.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Default number of milliseconds that a single interface is allowed to take
+ * to answer all of its ethtool requests.
+ */
+#define ETHTOOL_DEFAULT_TIMEOUT_MS 1000
+
+/**
+ * Default upper bound on the number of threads used to query interfaces
+ * concurrently.
+ */
+#define ETHTOOL_DEFAULT_JOBS 8
+
+/**
+ * Queries the driver statistics of every interface in the system and prints
+ * them to stdout, one `name: value` line per statistic.
+ *
+ * `timeout_ms` is the per-interface deadline and `jobs` the maximum number
+ * of concurrent queries (values <= 0 fall back to the defaults above).
+ *
+ * Returns 0 on success or a non-zero exit code in case the interfaces could
+ * not be listed at all (failures of individual interfaces are reported
+ * inline).
+ */
+int
+ethtool_stats_run(int timeout_ms, int jobs);
+
+/**
+ * Issues a SIOCETHTOOL ioctl against the interface `name` with `cmd` being
+ * the ethtool command structure (which the kernel reads the command number
+ * from and writes the answer to) of `len` bytes, trailing data included.
+ *
+ * Returns the ioctl result (-1 with errno set on failure).
+ */
+int
+ethtool_ioctl(int fd, const char* name, void* cmd, size_t len);
+
+/**
+ * Retrieves the number of strings in the string set `set` (one of
+ * ETH_SS_*) of the interface `name` via ETHTOOL_GSSET_INFO.
+ *
+ * Returns 0 if the set is not supported.
+ */
+uint32_t
+ethtool_sset_count(int fd, const char* name, int set);
+
+#endif
@@ -0,0 +1,921 @@
+#define _GNU_SOURCE
+#include "./exporter.h"
+#include "./arena.h"
+#include "./interrupt.h"
+#include "./kio.h"
+#include "./nl.h"
+#include "./probes.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Width of the pre-allocated field of each counter value: enough for the
+ * largest 64-bit unsigned integer.
+ */
+#define EXPORTER_VALUE_WIDTH 20
+
+/**
+ * Clients being read from at once, and how long one has to send its
+ * request.
+ */
+#define EXPORTER_MAX_CLIENTS 16
+#define EXPORTER_CLIENT_TIMEOUT_MS 2000
+
+static const struct {
+	const char* name;
+	const char* help;
+	size_t      offset;
+} exporter_counters[] = {
+	{ "ifacer_receive_bytes_total",
+	  "Bytes received.",
+	  offsetof(struct rtnl_link_stats64, rx_bytes) },
+	{ "ifacer_transmit_bytes_total",
+	  "Bytes transmitted.",
+	  offsetof(struct rtnl_link_stats64, tx_bytes) },
+	{ "ifacer_receive_packets_total",
+	  "Packets received.",
+	  offsetof(struct rtnl_link_stats64, rx_packets) },
+	{ "ifacer_transmit_packets_total",
+	  "Packets transmitted.",
+	  offsetof(struct rtnl_link_stats64, tx_packets) },
+	{ "ifacer_receive_errors_total",
+	  "Receive errors.",
+	  offsetof(struct rtnl_link_stats64, rx_errors) },
+	{ "ifacer_transmit_errors_total",
+	  "Transmit errors.",
+	  offsetof(struct rtnl_link_stats64, tx_errors) },
+	{ "ifacer_receive_dropped_total",
+	  "Packets dropped on receive.",
+	  offsetof(struct rtnl_link_stats64, rx_dropped) },
+	{ "ifacer_transmit_dropped_total",
+	  "Packets dropped on transmit.",
+	  offsetof(struct rtnl_link_stats64, tx_dropped) },
+};
+
+#define EXPORTER_N_COUNTERS                                                    \
+	(sizeof(exporter_counters) / sizeof(*exporter_counters))
+
+static const char* exporter_operstates[] = {
+	"unknown", "notpresent", "down", "lowerlayerdown",
+	"testing", "dormant",    "up",
+};
+
+/**
+ * A growable buffer (living in an arena) for rendering the response body.
+ */
+struct exporter_buf {
+	struct arena* arena;
+	char*         data;
+	size_t        len;
+	size_t        cap;
+	int           failed;
+};
+
+struct exporter_link {
+	unsigned ifindex;
+	unsigned mtu;
+	uint8_t  operstate;
+	uint8_t  mac[32];
+	size_t   mac_len;
+	char     name[IFNAMSIZ];
+	size_t   slots[EXPORTER_N_COUNTERS];
+};
+
+/**
+ * Everything that a render produces: the links (sorted by ifindex) and the
+ * page, all of it allocated from the snapshot's arena.
+ */
+struct exporter_snapshot {
+	struct arena          arena;
+	struct exporter_buf   page;
+	struct exporter_link* links;
+	size_t                n_links;
+	size_t                cap_links;
+};
+
+/**
+ * A connection whose request is still being read.
+ */
+struct exporter_client {
+	int     fd;
+	size_t  len;
+	int64_t deadline;
+	char    request[2048];
+};
+
+/**
+ * Renders alternate between the two snapshots: the one being rendered is
+ * reset (in O(1), keeping its memory) while `live` keeps being served, and
+ * only replaces it once the render succeeded. The previous snapshot stays
+ * readable until the next render.
+ */
+struct exporter {
+	int                       listen_fd;
+	int                       monitor_fd;
+	int                       query_fd;
+	int                       dirty;
+	struct exporter_snapshot  snapshots[2];
+	struct exporter_snapshot* live;
+	struct exporter_client    clients[EXPORTER_MAX_CLIENTS];
+	size_t                    n_clients;
+};
+
+static int
+exporter_buf_reserve(struct exporter_buf* buf, size_t len)
+{
+	char*  data;
+	size_t cap = buf->cap ? buf->cap : 65536;
+
+	if (buf->len + len <= buf->cap) {
+		return 0;
+	}
+
+	while (cap < buf->len + len) {
+		cap *= 2;
+	}
+
+	data = arena_extend(buf->arena, buf->data, buf->len, cap);
+	if (data == NULL) {
+		buf->failed = 1;
+		return -1;
+	}
+
+	buf->data = data;
+	buf->cap  = cap;
+	return 0;
+}
+
+static int __attribute__((format(printf, 2, 3)))
+exporter_buf_printf(struct exporter_buf* buf, const char* fmt, ...)
+{
+	va_list ap;
+	int     n;
+
+	for (;;) {
+		va_start(ap, fmt);
+		n =
+		  vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+		va_end(ap);
+
+		if (n < 0) {
+			return -1;
+		}
+
+		if ((size_t)n < buf->cap - buf->len) {
+			buf->len += n;
+			return 0;
+		}
+
+		if (exporter_buf_reserve(buf, n + 1) < 0) {
+			return -1;
+		}
+	}
+}
+
+/**
+ * Writes `value` as a zero-padded fixed-width decimal (no terminator).
+ */
+static void
+exporter_put_value(char* dst, uint64_t value)
+{
+	for (int i = EXPORTER_VALUE_WIDTH - 1; i >= 0; i--) {
+		dst[i] = '0' + value % 10;
+		value /= 10;
+	}
+}
+
+/**
+ * Writes a label value escaping the characters that the exposition format
+ * requires to be escaped.
+ */
+static int
+exporter_buf_label(struct exporter_buf* buf, const char* value)
+{
+	for (; *value != '\0'; value++) {
+		if (*value == '"' || *value == '\\') {
+			if (exporter_buf_printf(buf, "\\%c", *value) < 0) {
+				return -1;
+			}
+		} else if (*value == '\n') {
+			if (exporter_buf_printf(buf, "\\n") < 0) {
+				return -1;
+			}
+		} else if (exporter_buf_printf(buf, "%c", *value) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+exporter_link_cmp(const void* a, const void* b)
+{
+	const struct exporter_link* x = a;
+	const struct exporter_link* y = b;
+
+	return (x->ifindex > y->ifindex) - (x->ifindex < y->ifindex);
+}
+
+static struct exporter_link*
+exporter_link_find(struct exporter_snapshot* snapshot, unsigned ifindex)
+{
+	struct exporter_link key = { .ifindex = ifindex };
+
+	return bsearch(&key,
+	               snapshot->links,
+	               snapshot->n_links,
+	               sizeof(*snapshot->links),
+	               exporter_link_cmp);
+}
+
+static int
+exporter_link_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct exporter_snapshot* snapshot = data;
+	const struct ifinfomsg*   ifi      = NLMSG_DATA(msg);
+	const struct nlattr*      tb[IFLA_MAX + 1];
+	struct exporter_link*     link;
+
+	if (msg->nlmsg_type != RTM_NEWLINK) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+	if (tb[IFLA_IFNAME] == NULL) {
+		return 0;
+	}
+
+	if (snapshot->n_links == snapshot->cap_links) {
+		size_t cap = snapshot->cap_links ? snapshot->cap_links * 2 : 64;
+		void*  links = arena_extend(&snapshot->arena,
+                                           snapshot->links,
+                                           snapshot->n_links * sizeof(*link),
+                                           cap * sizeof(*link));
+
+		if (links == NULL) {
+			return -ENOMEM;
+		}
+
+		snapshot->links     = links;
+		snapshot->cap_links = cap;
+	}
+
+	link = &snapshot->links[snapshot->n_links++];
+	memset(link, 0, sizeof(*link));
+	link->ifindex = ifi->ifi_index;
+	snprintf(
+	  link->name, sizeof(link->name), "%s", nl_attr_str(tb[IFLA_IFNAME]));
+
+	if (tb[IFLA_MTU] != NULL) {
+		link->mtu = nl_attr_u32(tb[IFLA_MTU]);
+	}
+
+	if (tb[IFLA_OPERSTATE] != NULL) {
+		link->operstate = nl_attr_u8(tb[IFLA_OPERSTATE]);
+	}
+
+	if (tb[IFLA_ADDRESS] != NULL &&
+	    nl_attr_len(tb[IFLA_ADDRESS]) <= sizeof(link->mac)) {
+		link->mac_len = nl_attr_len(tb[IFLA_ADDRESS]);
+		memcpy(
+		  link->mac, nl_attr_data(tb[IFLA_ADDRESS]), link->mac_len);
+	}
+
+	return 0;
+}
+
+static int
+exporter_addr_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct exporter_snapshot* snapshot = data;
+	const struct ifaddrmsg*   ifa      = NLMSG_DATA(msg);
+	const struct nlattr*      tb[IFA_MAX + 1];
+	const struct nlattr*      addr;
+	struct exporter_link*     link;
+	char                      ip[INET6_ADDRSTRLEN];
+
+	if (msg->nlmsg_type != RTM_NEWADDR) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+
+	/**
+	 * For point-to-point links IFA_ADDRESS is the peer; IFA_LOCAL is
+	 * always ours when present.
+	 */
+	addr = tb[IFA_LOCAL] != NULL ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	link = exporter_link_find(snapshot, ifa->ifa_index);
+	if (addr == NULL || link == NULL ||
+	    inet_ntop(ifa->ifa_family, nl_attr_data(addr), ip, sizeof(ip)) ==
+	      NULL) {
+		return 0;
+	}
+
+	if (exporter_buf_printf(&snapshot->page,
+	                        "ifacer_address_info{name=\"") < 0 ||
+	    exporter_buf_label(&snapshot->page, link->name) < 0 ||
+	    exporter_buf_printf(
+	      &snapshot->page,
+	      "\",family=\"%s\",address=\"%s\",prefixlen=\"%u\"} 1\n",
+	      ifa->ifa_family == AF_INET ? "inet" : "inet6",
+	      ip,
+	      ifa->ifa_prefixlen) < 0) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/**
+ * Issues an rtnetlink dump of `type` with a zeroed family header of
+ * `hdrlen` bytes whose first byte (the family in every rtnetlink header)
+ * is `family`.
+ */
+static int
+exporter_dump(int       fd,
+              uint16_t  type,
+              uint8_t   family,
+              size_t    hdrlen,
+              nl_msg_cb cb,
+              void*     data)
+{
+	struct {
+		struct nlmsghdr hdr;
+		char            body[64];
+	} req = { 0 };
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(hdrlen);
+	req.hdr.nlmsg_type  = type;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.body[0]         = family;
+
+	return nl_transact(fd, &req.hdr, cb, data);
+}
+
+/**
+ * Renders the whole body, remembering where each counter value lives.
+ *
+ * Counter values are left zeroed; they're filled by `exporter_patch`.
+ */
+static int
+exporter_render(struct exporter* exporter)
+{
+	struct exporter_snapshot* snapshot =
+	  &exporter->snapshots[exporter->live == &exporter->snapshots[0]];
+	struct exporter_buf* page = &snapshot->page;
+	int                  err;
+
+	arena_reset(&snapshot->arena);
+	snapshot->links     = NULL;
+	snapshot->n_links   = 0;
+	snapshot->cap_links = 0;
+	*page = (struct exporter_buf){ .arena = &snapshot->arena };
+
+	err = exporter_dump(exporter->query_fd,
+	                    RTM_GETLINK,
+	                    AF_UNSPEC,
+	                    sizeof(struct ifinfomsg),
+	                    exporter_link_cb,
+	                    snapshot);
+	if (err < 0) {
+		return err;
+	}
+
+	qsort(snapshot->links,
+	      snapshot->n_links,
+	      sizeof(*snapshot->links),
+	      exporter_link_cmp);
+
+	exporter_buf_printf(page,
+	                    "# HELP ifacer_interface_info Network interfaces.\n"
+	                    "# TYPE ifacer_interface_info gauge\n");
+	for (size_t i = 0; i < snapshot->n_links; i++) {
+		struct exporter_link* link      = &snapshot->links[i];
+		const char*           operstate = "unknown";
+
+		if (link->operstate < sizeof(exporter_operstates) /
+		                        sizeof(*exporter_operstates)) {
+			operstate = exporter_operstates[link->operstate];
+		}
+
+		exporter_buf_printf(page, "ifacer_interface_info{name=\"");
+		exporter_buf_label(page, link->name);
+		exporter_buf_printf(page,
+		                    "\",ifindex=\"%u\",operstate=\"%s\",mac=\"",
+		                    link->ifindex,
+		                    operstate);
+		for (size_t j = 0; j < link->mac_len; j++) {
+			exporter_buf_printf(
+			  page, "%s%02x", j ? ":" : "", link->mac[j]);
+		}
+		exporter_buf_printf(page, "\"} 1\n");
+	}
+
+	exporter_buf_printf(
+	  page,
+	  "# HELP ifacer_interface_mtu Maximum transmission unit.\n"
+	  "# TYPE ifacer_interface_mtu gauge\n");
+	for (size_t i = 0; i < snapshot->n_links; i++) {
+		exporter_buf_printf(page, "ifacer_interface_mtu{name=\"");
+		exporter_buf_label(page, snapshot->links[i].name);
+		exporter_buf_printf(page, "\"} %u\n", snapshot->links[i].mtu);
+	}
+
+	exporter_buf_printf(page,
+	                    "# HELP ifacer_address_info Addresses assigned to "
+	                    "interfaces.\n"
+	                    "# TYPE ifacer_address_info gauge\n");
+	err = exporter_dump(exporter->query_fd,
+	                    RTM_GETADDR,
+	                    AF_UNSPEC,
+	                    sizeof(struct ifaddrmsg),
+	                    exporter_addr_cb,
+	                    snapshot);
+	if (err < 0) {
+		return err;
+	}
+
+	for (size_t c = 0; c < EXPORTER_N_COUNTERS; c++) {
+		exporter_buf_printf(page,
+		                    "# HELP %s %s\n# TYPE %s counter\n",
+		                    exporter_counters[c].name,
+		                    exporter_counters[c].help,
+		                    exporter_counters[c].name);
+
+		for (size_t i = 0; i < snapshot->n_links; i++) {
+			struct exporter_link* link = &snapshot->links[i];
+
+			exporter_buf_printf(
+			  page, "%s{name=\"", exporter_counters[c].name);
+			exporter_buf_label(page, link->name);
+			exporter_buf_printf(page, "\"} ");
+
+			if (exporter_buf_reserve(
+			      page, EXPORTER_VALUE_WIDTH + 1) < 0) {
+				return -ENOMEM;
+			}
+
+			link->slots[c] = page->len;
+			exporter_put_value(page->data + page->len, 0);
+			page->len += EXPORTER_VALUE_WIDTH;
+			page->data[page->len++] = '\n';
+		}
+	}
+
+	/**
+	 * Rendering only fails when out of memory, in which case the page
+	 * is truncated; make sure we don't serve it.
+	 */
+	if (page->failed) {
+		page->failed = 0;
+		return -ENOMEM;
+	}
+
+	exporter->live  = snapshot;
+	exporter->dirty = 0;
+	return 0;
+}
+
+static int
+exporter_stats_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct exporter_snapshot*  snapshot = data;
+	const struct if_stats_msg* ifsm     = NLMSG_DATA(msg);
+	const struct nlattr*       tb[IFLA_STATS_MAX + 1];
+	struct rtnl_link_stats64   stats;
+	struct exporter_link*      link;
+
+	if (msg->nlmsg_type != RTM_NEWSTATS ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifsm))) {
+		return 0;
+	}
+
+	link = exporter_link_find(snapshot, ifsm->ifindex);
+	if (link == NULL) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifsm), tb, IFLA_STATS_MAX);
+	if (tb[IFLA_STATS_LINK_64] == NULL ||
+	    nl_attr_len(tb[IFLA_STATS_LINK_64]) < sizeof(stats)) {
+		return 0;
+	}
+
+	memcpy(&stats, nl_attr_data(tb[IFLA_STATS_LINK_64]), sizeof(stats));
+
+	for (size_t c = 0; c < EXPORTER_N_COUNTERS; c++) {
+		uint64_t value;
+
+		memcpy(&value,
+		       (const char*)&stats + exporter_counters[c].offset,
+		       sizeof(value));
+		exporter_put_value(snapshot->page.data + link->slots[c], value);
+	}
+
+	return 0;
+}
+
+/**
+ * Refreshes the counter values in place with a single stats dump.
+ */
+static int
+exporter_patch(struct exporter* exporter)
+{
+	struct {
+		struct nlmsghdr     hdr;
+		struct if_stats_msg ifsm;
+	} req = { 0 };
+
+	req.hdr.nlmsg_len    = NLMSG_LENGTH(sizeof(req.ifsm));
+	req.hdr.nlmsg_type   = RTM_GETSTATS;
+	req.hdr.nlmsg_flags  = NLM_F_REQUEST | NLM_F_DUMP;
+	req.ifsm.family      = AF_UNSPEC;
+	req.ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	return nl_transact(
+	  exporter->query_fd, &req.hdr, exporter_stats_cb, exporter->live);
+}
+
+/**
+ * Drains the notification socket, marking the page as stale if anything
+ * about links or addresses changed.
+ */
+static void
+exporter_drain_notifications(struct exporter* exporter)
+{
+	char buf[NL_BUFSIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+	for (;;) {
+		ssize_t n = kio_recv(
+		  exporter->monitor_fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+		if (n == -1) {
+			/**
+			 * ENOBUFS means we lost notifications: we can't
+			 * know what changed, so assume everything did.
+			 */
+			if (errno == ENOBUFS) {
+				exporter->dirty = 1;
+				continue;
+			}
+			return;
+		}
+
+		for (const struct nlmsghdr* msg = (const struct nlmsghdr*)buf;
+		     NLMSG_OK(msg, n);
+		     msg = NLMSG_NEXT(msg, n)) {
+			int ifindex = nl_msg_ifindex(msg);
+
+			PROBE2(event__start, msg->nlmsg_type, ifindex);
+			switch (msg->nlmsg_type) {
+				case RTM_NEWLINK:
+				case RTM_DELLINK:
+				case RTM_NEWADDR:
+				case RTM_DELADDR:
+					exporter->dirty = 1;
+					break;
+			}
+			PROBE2(event__end, msg->nlmsg_type, ifindex);
+		}
+	}
+}
+
+static void
+exporter_respond(int fd, const char* status, const char* body, size_t len)
+{
+	char          header[256];
+	struct iovec  iov[2];
+	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+	int           n;
+
+	n =
+	  snprintf(header,
+	           sizeof(header),
+	           "HTTP/1.1 %s\r\n"
+	           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+	           "Content-Length: %zu\r\n"
+	           "Connection: close\r\n"
+	           "\r\n",
+	           status,
+	           len);
+
+	iov[0].iov_base = header;
+	iov[0].iov_len  = n;
+	iov[1].iov_base = (void*)body;
+	iov[1].iov_len  = len;
+
+	PROBE1(flush__start, n + len);
+	while (msg.msg_iovlen > 0) {
+		ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+		if (sent <= 0) {
+			break;
+		}
+
+		while (msg.msg_iovlen > 0 &&
+		       (size_t)sent >= msg.msg_iov->iov_len) {
+			sent -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+
+		if (msg.msg_iovlen > 0) {
+			msg.msg_iov->iov_base =
+			  (char*)msg.msg_iov->iov_base + sent;
+			msg.msg_iov->iov_len -= sent;
+		}
+	}
+	PROBE1(flush__end, n + len);
+}
+
+static void
+exporter_serve(struct exporter* exporter, int fd, const char* request)
+{
+	struct timeval timeout = { .tv_sec = 2 };
+
+	/**
+	 * The response is written in one go, with a bounded wait on a
+	 * client that doesn't read it.
+	 */
+	fcntl(fd, F_SETFL, 0);
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	if (strncmp(request, "GET /metrics ", 13) != 0 &&
+	    strncmp(request, "GET /metrics?", 13) != 0) {
+		exporter_respond(fd, "404 Not Found", "not found\n", 10);
+		return;
+	}
+
+	PROBE0(scrape__start);
+	exporter_drain_notifications(exporter);
+	/**
+	 * A failed render leaves the live snapshot alone: serve it (stale
+	 * inventory, fresh counters) and try again on the next scrape.
+	 */
+	if (exporter->dirty && exporter_render(exporter) < 0 &&
+	    exporter->live == NULL) {
+		exporter_respond(
+		  fd, "500 Internal Server Error", "render failed\n", 14);
+		return;
+	}
+
+	if (exporter_patch(exporter) < 0) {
+		exporter_respond(
+		  fd, "500 Internal Server Error", "stats failed\n", 13);
+		return;
+	}
+
+	exporter_respond(
+	  fd, "200 OK", exporter->live->page.data, exporter->live->page.len);
+	PROBE1(scrape__end, exporter->live->page.len);
+}
+
+/**
+ * Reads what a client sent so far, and answers it once its request is
+ * complete. We only care about the request line, but read up to the end
+ * of the headers so the client doesn't get a reset.
+ *
+ * Returns 1 while the request isn't complete, 0 once the client is done
+ * with.
+ */
+static int
+exporter_client_read(struct exporter* exporter, struct exporter_client* client)
+{
+	for (;;) {
+		ssize_t n = recv(client->fd,
+		                 client->request + client->len,
+		                 sizeof(client->request) - 1 - client->len,
+		                 0);
+
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return 1;
+		}
+
+		if (n <= 0) {
+			return 0;
+		}
+
+		client->len += n;
+		client->request[client->len] = '\0';
+		if (strstr(client->request, "\r\n\r\n") != NULL ||
+		    client->len == sizeof(client->request) - 1) {
+			exporter_serve(exporter, client->fd, client->request);
+			return 0;
+		}
+	}
+}
+
+static int64_t
+exporter_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int
+exporter_listen(const char* address)
+{
+	struct sockaddr_storage addr = { 0 };
+	socklen_t               addr_len;
+	char                    host[INET6_ADDRSTRLEN + 2];
+	const char*             colon = strrchr(address, ':');
+	int                     port;
+	int                     one = 1;
+	int                     fd;
+
+	if (colon == NULL) {
+		snprintf(host, sizeof(host), "127.0.0.1");
+		port = atoi(address);
+	} else {
+		snprintf(
+		  host, sizeof(host), "%.*s", (int)(colon - address), address);
+		port = atoi(colon + 1);
+	}
+
+	if (host[0] == '\0') {
+		snprintf(host, sizeof(host), "0.0.0.0");
+	}
+
+	if (host[0] == '[') {
+		struct sockaddr_in6* in6 = (struct sockaddr_in6*)&addr;
+
+		host[strlen(host) - 1] = '\0';
+		in6->sin6_family       = AF_INET6;
+		in6->sin6_port         = htons(port);
+		addr_len               = sizeof(*in6);
+		if (inet_pton(AF_INET6, host + 1, &in6->sin6_addr) != 1) {
+			errno = EINVAL;
+			return -1;
+		}
+	} else {
+		struct sockaddr_in* in = (struct sockaddr_in*)&addr;
+
+		in->sin_family = AF_INET;
+		in->sin_port   = htons(port);
+		addr_len       = sizeof(*in);
+		if (inet_pton(AF_INET, host, &in->sin_addr) != 1) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	fd =
+	  socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd == -1) {
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	if (bind(fd, (struct sockaddr*)&addr, addr_len) == -1 ||
+	    listen(fd, 64) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int
+exporter_run(const char* address)
+{
+	struct exporter exporter = { .dirty = 1 };
+
+	if (address == NULL) {
+		address = EXPORTER_DEFAULT_ADDRESS;
+	}
+
+	exporter.listen_fd = exporter_listen(address);
+	if (exporter.listen_fd == -1) {
+		perror("cannot listen");
+		return 1;
+	}
+
+	exporter.monitor_fd = nl_open(
+	  NETLINK_ROUTE, RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR);
+	exporter.query_fd = nl_open(NETLINK_ROUTE, 0);
+	if (exporter.monitor_fd == -1 || exporter.query_fd == -1) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	if (exporter_render(&exporter) < 0) {
+		fprintf(stderr, "cannot render metrics\n");
+		return 2;
+	}
+
+	fprintf(stderr, "listening on %s\n", address);
+
+	/**
+	 * Clients are read from as their requests come, next to the
+	 * notifications: one that connects and sends nothing only holds a
+	 * slot until it times out. With every slot taken, new connections
+	 * wait in the listen backlog.
+	 */
+	while (interrupt_signal() == 0) {
+		struct pollfd fds[2 + EXPORTER_MAX_CLIENTS];
+		int64_t       now     = exporter_now_ms();
+		int           timeout = -1;
+
+		fds[0] = (struct pollfd){
+			.fd     = exporter.n_clients < EXPORTER_MAX_CLIENTS
+			            ? exporter.listen_fd
+			            : -1,
+			.events = POLLIN,
+		};
+		fds[1] = (struct pollfd){ .fd     = exporter.monitor_fd,
+			                  .events = POLLIN };
+
+		for (size_t i = 0; i < exporter.n_clients; i++) {
+			int64_t left = exporter.clients[i].deadline - now;
+
+			fds[2 + i] = (struct pollfd){
+				.fd     = exporter.clients[i].fd,
+				.events = POLLIN,
+			};
+			if (timeout == -1 || left < timeout) {
+				timeout = left > 0 ? (int)left : 0;
+			}
+		}
+
+		if (interrupt_poll(fds, 2 + exporter.n_clients, timeout) ==
+		    -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll failed");
+			return 1;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			exporter_drain_notifications(&exporter);
+		}
+
+		/**
+		 * Backwards, as a client that's done with is replaced by the
+		 * last one.
+		 */
+		now = exporter_now_ms();
+		for (size_t i = exporter.n_clients; i-- > 0;) {
+			struct exporter_client* client = &exporter.clients[i];
+
+			if ((fds[2 + i].revents == 0 &&
+			     now < client->deadline) ||
+			    (fds[2 + i].revents != 0 &&
+			     exporter_client_read(&exporter, client) == 1)) {
+				continue;
+			}
+
+			close(client->fd);
+			*client = exporter.clients[--exporter.n_clients];
+		}
+
+		while ((fds[0].revents & POLLIN) &&
+		       exporter.n_clients < EXPORTER_MAX_CLIENTS) {
+			int fd = accept4(exporter.listen_fd,
+			                 NULL,
+			                 NULL,
+			                 SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+			if (fd == -1) {
+				break;
+			}
+
+			exporter.clients[exporter.n_clients++] =
+			  (struct exporter_client){
+				  .fd       = fd,
+				  .deadline = now + EXPORTER_CLIENT_TIMEOUT_MS,
+			  };
+		}
+	}
+
+	for (size_t i = 0; i < exporter.n_clients; i++) {
+		close(exporter.clients[i].fd);
+	}
+
+	return 0;
+}
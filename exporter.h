@@ -0,0 +1,48 @@
+#ifndef IFACER__EXPORTER_H
+#define IFACER__EXPORTER_H
+
+/**
+ * exporter - serves the interface inventory and counters over HTTP in the
+ *            Prometheus text exposition format (`GET /metrics`).
+ *
+ * The response body is made of two kinds of lines:
+ *
+ *   - inventory lines (which interfaces exist, their MTU, MAC, operational
+ *     state and addresses), which only change when the configuration does;
+ *     and
+ *   - counter lines (bytes, packets, errors and drops per interface), which
+ *     change all the time.
+ *
+ * Instead of rendering the whole body on every scrape, it is rendered once
+ * with each counter value written as a fixed-width (20 digits, zero-padded)
+ * field whose offset is remembered. A scrape then costs a single RTM_GETSTATS
+ * dump (asking for nothing but the 64-bit link stats) plus overwriting those
+ * fields in place.
+ *
+ * The body is only rendered again once a netlink notification (link or
+ * address added, removed or changed) tells us that the inventory is stale.
+ *
+ * Everything runs in a single thread: a `poll(2)` loop over the listening
+ * socket, the netlink notification socket and the connections whose
+ * request is still coming (non-blocking, up to 16 of them, each dropped
+ * if its request takes over 2s). A connection that sends nothing only
+ * holds its slot; it doesn't hold up scrapes nor notifications. Once the
+ * request is in, the response is written in one go, bounded by a send
+ * timeout.
+ */
+
+/**
+ * Default address to listen on.
+ */
+#define EXPORTER_DEFAULT_ADDRESS "127.0.0.1:9417"
+
+/**
+ * Serves `/metrics` on `address` (`ipv4:port`, `[ipv6]:port` or just
+ * `:port`) until interrupted.
+ *
+ * Returns a non-zero exit code if the exporter could not be started.
+ */
+int
+exporter_run(const char* address);
+
+#endif
@@ -0,0 +1,433 @@
+#define _GNU_SOURCE
+#include "./fdb.h"
+#include "./kio.h"
+#include "./nl.h"
+#include "./tally.h"
+
+#include <errno.h>
+#include <linux/neighbour.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum fdb_state {
+	FDB_DYNAMIC = 0,
+	FDB_STATIC,
+	FDB_PERMANENT,
+	FDB_N_STATES,
+};
+
+static const char* const fdb_state_names[FDB_N_STATES] = {
+	[FDB_DYNAMIC]   = "dynamic",
+	[FDB_STATIC]    = "static",
+	[FDB_PERMANENT] = "permanent",
+};
+
+struct fdb_port {
+	uint32_t ifindex;
+	uint32_t master; /* bridge, 0 if none */
+	uint64_t counts[FDB_N_STATES];
+};
+
+struct fdb_entry {
+	uint8_t  mac[6];
+	uint16_t vlan;
+	uint32_t ifindex; /* 0 for a free slot */
+	uint32_t master;
+	uint8_t  state;
+};
+
+/**
+ * The counts per port, and the index of entries by MAC: an
+ * open-addressing table (linear probing) where the entries of a MAC sit
+ * next to each other.
+ */
+struct fdb {
+	struct tally      ports;
+	int               indexed; /* whether addresses are looked up */
+	struct fdb_entry* index;
+	size_t            n_index;
+	size_t            index_cap; /* a power of 2 */
+};
+
+static uint32_t
+fdb_hash_mac(const uint8_t* mac)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < 6; i++) {
+		hash = (hash ^ mac[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Puts an entry in the index, next to the entries of the same MAC (or
+ * where they would be).
+ */
+static void
+fdb_index_put(struct fdb_entry*       index,
+              size_t                  cap,
+              const struct fdb_entry* entry)
+{
+	size_t i = fdb_hash_mac(entry->mac) & (cap - 1);
+
+	while (index[i].ifindex != 0) {
+		i = (i + 1) & (cap - 1);
+	}
+
+	index[i] = *entry;
+}
+
+static int
+fdb_index_add(struct fdb* fdb, const struct fdb_entry* entry)
+{
+	if ((fdb->n_index + 1) * 2 > fdb->index_cap) {
+		size_t cap = fdb->index_cap ? fdb->index_cap * 2 : 1024;
+		struct fdb_entry* index = calloc(cap, sizeof(*index));
+
+		if (index == NULL) {
+			return -1;
+		}
+
+		for (size_t i = 0; i < fdb->index_cap; i++) {
+			if (fdb->index[i].ifindex != 0) {
+				fdb_index_put(index, cap, &fdb->index[i]);
+			}
+		}
+
+		free(fdb->index);
+		fdb->index     = index;
+		fdb->index_cap = cap;
+	}
+
+	fdb_index_put(fdb->index, fdb->index_cap, entry);
+	fdb->n_index++;
+
+	return 0;
+}
+
+/**
+ * Counts (and indexes, if asked to) an entry of the dump.
+ */
+static int
+fdb_collect(const struct nlmsghdr* msg, void* data)
+{
+	struct fdb*          fdb = data;
+	const struct ndmsg*  ndm = NLMSG_DATA(msg);
+	const struct nlattr* tb[NDA_MAX + 1];
+	struct fdb_entry     entry = { 0 };
+	struct fdb_port      key   = { 0 };
+	struct fdb_port*     port;
+
+	if (msg->nlmsg_type != RTM_NEWNEIGH ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ndm)) ||
+	    ndm->ndm_family != AF_BRIDGE || ndm->ndm_ifindex <= 0) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ndm), tb, NDA_MAX);
+
+	entry.ifindex = ndm->ndm_ifindex;
+	if (tb[NDA_MASTER] != NULL) {
+		entry.master = nl_attr_u32(tb[NDA_MASTER]);
+	}
+
+	if (ndm->ndm_state & NUD_PERMANENT) {
+		entry.state = FDB_PERMANENT;
+	} else if (ndm->ndm_state & NUD_NOARP) {
+		entry.state = FDB_STATIC;
+	} else {
+		entry.state = FDB_DYNAMIC;
+	}
+
+	key.ifindex = entry.ifindex;
+	key.master  = entry.master;
+
+	port = tally_get(&fdb->ports, &key);
+	if (port == NULL) {
+		return -ENOMEM;
+	}
+
+	port->counts[entry.state]++;
+
+	if (!fdb->indexed || tb[NDA_LLADDR] == NULL ||
+	    nl_attr_len(tb[NDA_LLADDR]) != 6) {
+		return 0;
+	}
+
+	memcpy(entry.mac, nl_attr_data(tb[NDA_LLADDR]), 6);
+	if (tb[NDA_VLAN] != NULL) {
+		entry.vlan = nl_attr_u16(tb[NDA_VLAN]);
+	}
+
+	if (fdb_index_add(fdb, &entry) != 0) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+fdb_print_iface(const char*                key,
+                const struct if_nameindex* ifaces,
+                size_t                     count,
+                uint32_t                   ifindex)
+{
+	const char* name = kio_if_name(ifaces, count, ifindex);
+
+	if (name != NULL) {
+		printf("%s: %s\n", key, name);
+	} else {
+		printf("%s: %u\n", key, ifindex);
+	}
+}
+
+static int
+fdb_compare_ports(const void* a, const void* b)
+{
+	const struct fdb_port* x = a;
+	const struct fdb_port* y = b;
+
+	if (x->master != y->master) {
+		return x->master < y->master ? -1 : 1;
+	}
+
+	return x->ifindex < y->ifindex ? -1 : x->ifindex > y->ifindex;
+}
+
+static void
+fdb_print_ports(struct fdb*                fdb,
+                const struct if_nameindex* ifaces,
+                size_t                     count)
+{
+	size_t n = tally_sort(&fdb->ports, fdb_compare_ports);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct fdb_port* port  = tally_at(&fdb->ports, i);
+		uint64_t               total = 0;
+
+		for (int state = 0; state < FDB_N_STATES; state++) {
+			total += port->counts[state];
+		}
+
+		if (port->master != 0) {
+			fdb_print_iface("bridge", ifaces, count, port->master);
+		}
+		fdb_print_iface("port", ifaces, count, port->ifindex);
+		printf("entries: %llu\n", (unsigned long long)total);
+
+		for (int state = 0; state < FDB_N_STATES; state++) {
+			printf("%s: %llu\n",
+			       fdb_state_names[state],
+			       (unsigned long long)port->counts[state]);
+		}
+
+		printf("\n");
+	}
+}
+
+/**
+ * Prints the entries of `mac` found in the index.
+ *
+ * Returns whether there was any.
+ */
+static int
+fdb_lookup(const struct fdb*          fdb,
+           const uint8_t*             mac,
+           const struct if_nameindex* ifaces,
+           size_t                     count)
+{
+	int found = 0;
+
+	if (fdb->index_cap == 0) {
+		return 0;
+	}
+
+	for (size_t i = fdb_hash_mac(mac) & (fdb->index_cap - 1);
+	     fdb->index[i].ifindex != 0;
+	     i = (i + 1) & (fdb->index_cap - 1)) {
+		const struct fdb_entry* entry = &fdb->index[i];
+
+		if (memcmp(entry->mac, mac, 6) != 0) {
+			continue;
+		}
+
+		printf("mac: %02x:%02x:%02x:%02x:%02x:%02x\n",
+		       mac[0],
+		       mac[1],
+		       mac[2],
+		       mac[3],
+		       mac[4],
+		       mac[5]);
+		if (entry->master != 0) {
+			fdb_print_iface("bridge", ifaces, count, entry->master);
+		}
+		fdb_print_iface("port", ifaces, count, entry->ifindex);
+		if (entry->vlan != 0) {
+			printf("vlan: %u\n", entry->vlan);
+		}
+		printf("state: %s\n\n", fdb_state_names[entry->state]);
+
+		found = 1;
+	}
+
+	return found;
+}
+
+/**
+ * Looks up a MAC address given as text.
+ *
+ * Returns 0 if found, 3 if not and 1 if it isn't a MAC address.
+ */
+static int
+fdb_lookup_text(const struct fdb*          fdb,
+                const char*                text,
+                size_t                     len,
+                const struct if_nameindex* ifaces,
+                size_t                     count)
+{
+	uint8_t mac[6];
+	char    copy[32];
+	int     end = 0;
+
+	if (len >= sizeof(copy)) {
+		len = sizeof(copy) - 1;
+	}
+	memcpy(copy, text, len);
+	copy[len] = '\0';
+
+	if (sscanf(copy,
+	           "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx%n",
+	           &mac[0],
+	           &mac[1],
+	           &mac[2],
+	           &mac[3],
+	           &mac[4],
+	           &mac[5],
+	           &end) != 6 ||
+	    copy[end] != '\0') {
+		fprintf(stderr, "invalid MAC address: %s\n", copy);
+		return 1;
+	}
+
+	return fdb_lookup(fdb, mac, ifaces, count) ? 0 : 3;
+}
+
+/**
+ * Looks up every address of `macs`.
+ *
+ * Returns the exit code: the worst of the lookups.
+ */
+static int
+fdb_lookup_all(const struct fdb*          fdb,
+               const char*                macs,
+               const struct if_nameindex* ifaces,
+               size_t                     count)
+{
+	int ret = 0;
+
+	if (strcmp(macs, "-") == 0) {
+		char*   line = NULL;
+		size_t  cap  = 0;
+		ssize_t len;
+
+		while ((len = getline(&line, &cap, stdin)) != -1) {
+			int err;
+
+			len = strcspn(line, " \t\r\n");
+			if (len == 0) {
+				continue;
+			}
+
+			err = fdb_lookup_text(fdb, line, len, ifaces, count);
+			if (err == 1 || (err == 3 && ret == 0)) {
+				ret = err;
+			}
+		}
+
+		free(line);
+		return ret;
+	}
+
+	while (*macs != '\0') {
+		size_t len = strcspn(macs, ",");
+		int    err = fdb_lookup_text(fdb, macs, len, ifaces, count);
+
+		if (err == 1 || (err == 3 && ret == 0)) {
+			ret = err;
+		}
+
+		macs += len + (macs[len] == ',');
+	}
+
+	return ret;
+}
+
+int
+fdb_run(const char* macs)
+{
+	struct fdb fdb = {
+		.ports   = { .size    = sizeof(struct fdb_port),
+		             .key_len = offsetof(struct fdb_port, counts) },
+		.indexed = macs != NULL,
+	};
+	struct if_nameindex* ifaces;
+	size_t               count;
+	struct {
+		struct nlmsghdr hdr;
+		struct ndmsg    ndm;
+	} req = { 0 };
+	int fd;
+	int err;
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ndm));
+	req.hdr.nlmsg_type  = RTM_GETNEIGH;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.ndm.ndm_family  = AF_BRIDGE;
+
+	err = nl_transact(fd, &req.hdr, fdb_collect, &fdb);
+	close(fd);
+
+	if (err < 0) {
+		fprintf(stderr,
+		        "cannot dump forwarding database: %s\n",
+		        strerror(-err));
+		tally_free(&fdb.ports);
+		free(fdb.index);
+		return 2;
+	}
+
+	/**
+	 * Names are only needed for what's printed, so they're retrieved
+	 * once, sorted by index to be searched.
+	 */
+	ifaces = kio_if_nameindex_sorted(&count);
+
+	if (macs == NULL) {
+		fdb_print_ports(&fdb, ifaces, count);
+		err = 0;
+	} else {
+		err = fdb_lookup_all(&fdb, macs, ifaces, count);
+	}
+
+	if (ifaces != NULL) {
+		if_freenameindex(ifaces);
+	}
+	tally_free(&fdb.ports);
+	free(fdb.index);
+
+	return err;
+}
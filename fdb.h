@@ -0,0 +1,50 @@
+#ifndef IFACER__FDB_H
+#define IFACER__FDB_H
+
+/**
+ * fdb - bridge forwarding database entries counted per port (`--fdb`), or
+ *       looked up by MAC address (`--lookup-mac`).
+ *
+ * Entries come from a single AF_BRIDGE RTM_GETNEIGH dump (what `bridge
+ * fdb show` asks for). They are counted as they stream by, into a table
+ * keyed by port (and bridge), so that a bridge holding 100k entries costs
+ * memory in proportion to its ports. Ports and bridges are named from the
+ * interface list at the end. Output, one record per port:
+ *
+ *      bridge: br0
+ *      port: eth1
+ *      entries: 1032
+ *      dynamic: 1000
+ *      static: 2
+ *      permanent: 30
+ *
+ * with `bridge` left out for entries of a device's own table (NTF_SELF,
+ * e.g., a NIC's or a VXLAN device's) and the states named as by `bridge
+ * fdb`: `permanent` for local addresses, `static` for entries added by
+ * hand, `dynamic` for learned ones.
+ *
+ * Looking up MAC addresses, each entry is also put in a MAC -> port hash
+ * index as it streams by; the addresses asked for are then found in it
+ * without scanning the table once per address. Output, one record per
+ * entry found (an address may be in several VLANs or bridges):
+ *
+ *      mac: 02:00:00:00:00:01
+ *      bridge: br0
+ *      port: eth1
+ *      vlan: 10
+ *      state: dynamic
+ *
+ * with `vlan` left out when the entry has none.
+ */
+
+/**
+ * Prints the per-port counts or, if `macs` isn't NULL, the entries of the
+ * MAC addresses it lists (comma-separated, or one per line on stdin if
+ * "-").
+ *
+ * Returns the exit code: 3 if an address is nowhere to be found.
+ */
+int
+fdb_run(const char* macs);
+
+#endif
@@ -0,0 +1,262 @@
+#include "./hasaddr.h"
+#include "./interrupt.h"
+#include "./kio.h"
+#include "./nl.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_addr.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+struct has_addr {
+	int           family;
+	unsigned char addr[16];
+	size_t        len;
+	int           fd;
+
+	/**
+	 * Sequence number of the dump in flight (0 when there's none) and
+	 * whether another one is needed once it's over.
+	 */
+	uint32_t seq;
+	int      resync;
+};
+
+static int
+has_addr_request(struct has_addr* has)
+{
+	struct {
+		struct nlmsghdr  hdr;
+		struct ifaddrmsg ifa;
+	} req = { 0 };
+	int seq;
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifa));
+	req.hdr.nlmsg_type  = RTM_GETADDR;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.ifa.ifa_family  = has->family;
+
+	seq = nl_send(has->fd, &req.hdr);
+	if (seq == -1) {
+		return -errno;
+	}
+
+	has->seq = seq;
+	return 0;
+}
+
+/**
+ * Whether `msg` (a dump answer or a notification alike) announces the
+ * address we're after as usable.
+ */
+static int
+has_addr_match(const struct has_addr* has, const struct nlmsghdr* msg)
+{
+	const struct ifaddrmsg* ifa = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFA_MAX + 1];
+	const struct nlattr*    local;
+	uint32_t                flags;
+
+	if (msg->nlmsg_type != RTM_NEWADDR ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)) ||
+	    ifa->ifa_family != has->family) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+
+	/**
+	 * Flags that don't fit in `ifa_flags` only come in IFA_FLAGS.
+	 */
+	flags =
+	  tb[IFA_FLAGS] != NULL ? nl_attr_u32(tb[IFA_FLAGS]) : ifa->ifa_flags;
+	if (flags & (IFA_F_TENTATIVE | IFA_F_DADFAILED)) {
+		return 0;
+	}
+
+	/**
+	 * For point-to-point links IFA_ADDRESS is the peer; IFA_LOCAL is
+	 * always ours when present.
+	 */
+	local = tb[IFA_LOCAL] != NULL ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+
+	return local != NULL && nl_attr_len(local) == has->len &&
+	       !memcmp(nl_attr_data(local), has->addr, has->len);
+}
+
+static int64_t
+has_addr_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Goes through the messages received. Returns the exit status, or -1 to
+ * keep going.
+ */
+static int
+has_addr_dispatch(struct has_addr* has, const char* buf, ssize_t n, int wait)
+{
+	const struct nlmsghdr* msg;
+
+	for (msg = (const struct nlmsghdr*)buf; NLMSG_OK(msg, n);
+	     msg = NLMSG_NEXT(msg, n)) {
+		if (has_addr_match(has, msg)) {
+			return 0;
+		}
+
+		if (has->seq == 0 || msg->nlmsg_seq != has->seq) {
+			continue;
+		}
+
+		if (msg->nlmsg_type == NLMSG_ERROR) {
+			const struct nlmsgerr* err = NLMSG_DATA(msg);
+
+			if (err->error != 0) {
+				errno = -err->error;
+				perror("cannot dump addresses");
+				return 2;
+			}
+		}
+
+		if (msg->nlmsg_type == NLMSG_DONE) {
+			has->seq = 0;
+
+			if (!wait) {
+				return 3;
+			}
+
+			if (has->resync) {
+				int err = has_addr_request(has);
+
+				has->resync = 0;
+				if (err < 0) {
+					errno = -err;
+					perror("cannot dump addresses");
+					return 2;
+				}
+			}
+		}
+	}
+
+	return -1;
+}
+
+int
+has_addr_run(const char* address, int wait_ms)
+{
+	struct has_addr has      = { 0 };
+	uint32_t        groups   = 0;
+	int64_t         deadline = has_addr_now_ms() + wait_ms;
+	int             err;
+
+	if (inet_pton(AF_INET, address, has.addr) == 1) {
+		has.family = AF_INET;
+		has.len    = 4;
+		groups     = RTMGRP_IPV4_IFADDR;
+	} else if (inet_pton(AF_INET6, address, has.addr) == 1) {
+		has.family = AF_INET6;
+		has.len    = 16;
+		groups     = RTMGRP_IPV6_IFADDR;
+	} else {
+		fprintf(stderr, "invalid address: %s\n", address);
+		return 1;
+	}
+
+	has.fd = nl_open(NETLINK_ROUTE, wait_ms != 0 ? groups : 0);
+	if (has.fd == -1) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	err = has_addr_request(&has);
+	if (err < 0) {
+		errno = -err;
+		perror("cannot dump addresses");
+		close(has.fd);
+		return 2;
+	}
+
+	while (interrupt_signal() == 0) {
+		char buf[NL_BUFSIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+		struct pollfd pfd = { .fd = has.fd, .events = POLLIN };
+		ssize_t       n;
+		int           timeout = -1;
+		int           status;
+
+		n = kio_recv(has.fd, buf, sizeof(buf), MSG_DONTWAIT);
+		if (n >= 0) {
+			status = has_addr_dispatch(&has, buf, n, wait_ms != 0);
+			if (status >= 0) {
+				close(has.fd);
+				return status;
+			}
+			continue;
+		}
+
+		if (errno == EINTR) {
+			continue;
+		}
+
+		/**
+		 * Notifications were dropped: dump again (once the dump in
+		 * flight is over, as the kernel only runs one at a time per
+		 * socket).
+		 */
+		if (errno == ENOBUFS) {
+			if (has.seq != 0) {
+				has.resync = 1;
+			} else if ((err = has_addr_request(&has)) < 0) {
+				errno = -err;
+				perror("cannot dump addresses");
+				close(has.fd);
+				return 2;
+			}
+			continue;
+		}
+
+		if (errno == ENODATA) {
+			close(has.fd);
+			return 3;
+		}
+
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			perror("cannot receive from netlink");
+			close(has.fd);
+			return 2;
+		}
+
+		if (wait_ms > 0) {
+			int64_t left = deadline - has_addr_now_ms();
+
+			if (left <= 0 && has.seq == 0) {
+				close(has.fd);
+				return 3;
+			}
+
+			/**
+			 * A dump in flight is always finished, even past the
+			 * deadline.
+			 */
+			timeout = has.seq != 0 ? -1 : (int)left;
+		}
+
+		if (interrupt_poll(&pfd, 1, timeout) == -1 && errno != EINTR) {
+			perror("poll failed");
+			close(has.fd);
+			return 1;
+		}
+	}
+
+	close(has.fd);
+	return 3;
+}
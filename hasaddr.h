@@ -0,0 +1,35 @@
+#ifndef IFACER__HASADDR_H
+#define IFACER__HASADDR_H
+
+/**
+ * hasaddr - tells, through the exit status only, whether an address is
+ *           assigned to any local interface (`--has-addr`), e.g., for a
+ *           readiness probe.
+ *
+ * A single RTM_GETADDR dump is made, restricted by the kernel to the
+ * family of the address, and the answer is dropped as soon as the address
+ * shows up. IPv6 addresses still going through duplicate address
+ * detection (or that failed it) don't count: nothing can bind to them
+ * yet.
+ *
+ * When asked to wait, the socket is subscribed to address notifications
+ * of that family before the dump is requested (so that an address added
+ * in between isn't missed), and the probe then sleeps in `poll(2)` until
+ * the kernel announces the address or the deadline passes. If
+ * notifications are lost (ENOBUFS), the dump is made again.
+ *
+ * Exit status: 0 if the address is there, 3 if it isn't (or didn't show
+ * up in time), 1 for a bad address or setup failure and 2 if the kernel
+ * couldn't be asked.
+ */
+
+/**
+ * Checks for `address` (IPv4 or IPv6), waiting for it for up to `wait_ms`
+ * milliseconds (not at all if 0, indefinitely if negative).
+ *
+ * Returns the exit status.
+ */
+int
+has_addr_run(const char* address, int wait_ms);
+
+#endif
@@ -0,0 +1,446 @@
+#include "./ifacer.h"
+#include "./kio.h"
+#include "./nl.h"
+#include "./probes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/rtnetlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum ifacer_state {
+	IFACER_STATE_LINKS = 0,
+	IFACER_STATE_ADDRS,
+	IFACER_STATE_WATCH,
+	IFACER_STATE_DONE,
+};
+
+struct ifacer {
+	struct ifacer_callbacks callbacks;
+	void*                   data;
+	int                     flags;
+	int                     fd;
+	enum ifacer_state       state;
+
+	/**
+	 * Sequence number of the dump in flight (0 when there's none).
+	 */
+	uint32_t seq;
+
+	/**
+	 * Notifications were lost while a dump was in flight: start over
+	 * once it's done.
+	 */
+	int resync;
+
+	/**
+	 * NL_BUFSIZE bytes: right after the struct, or the pool's.
+	 */
+	char* buf;
+
+	/**
+	 * The pool the instance comes from (NULL if allocated on its own),
+	 * and the next free one of the pool.
+	 */
+	struct ifacer_pool* pool;
+	struct ifacer*      next;
+};
+
+struct ifacer_pool {
+	struct ifacer* instances;
+	struct ifacer* free;
+	char*          buf;
+};
+
+/**
+ * Sends the dump request for the state we're entering.
+ */
+static int
+ifacer_request(struct ifacer* ifacer, enum ifacer_state state)
+{
+	struct {
+		struct nlmsghdr hdr;
+		union {
+			struct ifinfomsg ifi;
+			struct ifaddrmsg ifa;
+		};
+	} req = { 0 };
+	int seq;
+
+	req.hdr.nlmsg_len =
+	  NLMSG_LENGTH(state == IFACER_STATE_LINKS ? sizeof(struct ifinfomsg)
+	                                           : sizeof(struct ifaddrmsg));
+	req.hdr.nlmsg_type =
+	  state == IFACER_STATE_LINKS ? RTM_GETLINK : RTM_GETADDR;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	seq = nl_send(ifacer->fd, &req.hdr);
+	if (seq == -1) {
+		return -errno;
+	}
+
+	ifacer->state = state;
+	ifacer->seq   = seq;
+	return 0;
+}
+
+/**
+ * Opens the socket of an instance whose `buf` and `pool` are set.
+ */
+static struct ifacer*
+ifacer_start(struct ifacer*                 ifacer,
+             const struct ifacer_callbacks* callbacks,
+             void*                          data,
+             int                            flags)
+{
+	uint32_t groups = 0;
+	int      err;
+
+	if (flags & IFACER_WATCH) {
+		groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	}
+
+	ifacer->callbacks = *callbacks;
+	ifacer->data      = data;
+	ifacer->flags     = flags;
+	ifacer->state     = IFACER_STATE_LINKS;
+	ifacer->seq       = 0;
+	ifacer->resync    = 0;
+
+	ifacer->fd = nl_open(NETLINK_ROUTE, groups);
+	if (ifacer->fd == -1) {
+		err = errno;
+		ifacer_close(ifacer);
+		errno = err;
+		return NULL;
+	}
+
+	if (fcntl(ifacer->fd, F_SETFL, O_NONBLOCK) == -1) {
+		err = errno;
+		ifacer_close(ifacer);
+		errno = err;
+		return NULL;
+	}
+
+	err = ifacer_request(ifacer, IFACER_STATE_LINKS);
+	if (err < 0) {
+		ifacer_close(ifacer);
+		errno = -err;
+		return NULL;
+	}
+
+	return ifacer;
+}
+
+struct ifacer*
+ifacer_open(const struct ifacer_callbacks* callbacks, void* data, int flags)
+{
+	struct ifacer* ifacer;
+
+	ifacer = calloc(1, sizeof(*ifacer) + NL_BUFSIZE);
+	if (ifacer == NULL) {
+		return NULL;
+	}
+
+	ifacer->buf = (char*)(ifacer + 1);
+
+	return ifacer_start(ifacer, callbacks, data, flags);
+}
+
+struct ifacer*
+ifacer_pool_open(struct ifacer_pool*            pool,
+                 const struct ifacer_callbacks* callbacks,
+                 void*                          data,
+                 int                            flags)
+{
+	struct ifacer* ifacer = pool->free;
+
+	if (ifacer == NULL) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	pool->free = ifacer->next;
+
+	return ifacer_start(ifacer, callbacks, data, flags);
+}
+
+struct ifacer_pool*
+ifacer_pool_new(size_t capacity)
+{
+	struct ifacer_pool* pool;
+
+	pool = calloc(1, sizeof(*pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	pool->instances = calloc(capacity, sizeof(*pool->instances));
+	pool->buf       = malloc(NL_BUFSIZE);
+	if (pool->instances == NULL || pool->buf == NULL) {
+		ifacer_pool_free(pool);
+		return NULL;
+	}
+
+	for (size_t i = capacity; i > 0; i--) {
+		struct ifacer* ifacer = &pool->instances[i - 1];
+
+		ifacer->buf  = pool->buf;
+		ifacer->pool = pool;
+		ifacer->next = pool->free;
+		pool->free   = ifacer;
+	}
+
+	return pool;
+}
+
+void
+ifacer_pool_free(struct ifacer_pool* pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	free(pool->instances);
+	free(pool->buf);
+	free(pool);
+}
+
+int
+ifacer_fd(const struct ifacer* ifacer)
+{
+	return ifacer->fd;
+}
+
+void
+ifacer_close(struct ifacer* ifacer)
+{
+	if (ifacer == NULL) {
+		return;
+	}
+
+	if (ifacer->fd != -1) {
+		close(ifacer->fd);
+	}
+
+	if (ifacer->pool != NULL) {
+		ifacer->next       = ifacer->pool->free;
+		ifacer->pool->free = ifacer;
+		return;
+	}
+
+	free(ifacer);
+}
+
+static void
+ifacer_report_link(struct ifacer*         ifacer,
+                   enum ifacer_event      event,
+                   const struct nlmsghdr* msg)
+{
+	const struct ifinfomsg* ifi  = NLMSG_DATA(msg);
+	struct ifacer_link      link = { 0 };
+	const struct nlattr*    tb[IFLA_MAX + 1];
+
+	if (ifacer->callbacks.on_link == NULL ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi))) {
+		return;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+	if (tb[IFLA_IFNAME] == NULL) {
+		return;
+	}
+
+	link.index = ifi->ifi_index;
+	link.name  = nl_attr_str(tb[IFLA_IFNAME]);
+	link.flags = ifi->ifi_flags;
+
+	if (tb[IFLA_MTU] != NULL) {
+		link.mtu = nl_attr_u32(tb[IFLA_MTU]);
+	}
+
+	if (tb[IFLA_ADDRESS] != NULL) {
+		link.mac     = nl_attr_data(tb[IFLA_ADDRESS]);
+		link.mac_len = nl_attr_len(tb[IFLA_ADDRESS]);
+	}
+
+	ifacer->callbacks.on_link(ifacer->data, event, &link);
+}
+
+static void
+ifacer_report_addr(struct ifacer*         ifacer,
+                   enum ifacer_event      event,
+                   const struct nlmsghdr* msg)
+{
+	const struct ifaddrmsg* ifa  = NLMSG_DATA(msg);
+	struct ifacer_addr      addr = { 0 };
+	const struct nlattr*    tb[IFA_MAX + 1];
+	const struct nlattr*    local;
+
+	if (ifacer->callbacks.on_addr == NULL ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)) ||
+	    (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
+		return;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+
+	/**
+	 * For point-to-point links IFA_ADDRESS is the peer; IFA_LOCAL is
+	 * always ours when present.
+	 */
+	local = tb[IFA_LOCAL] != NULL ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	if (local == NULL ||
+	    nl_attr_len(local) < (ifa->ifa_family == AF_INET ? 4 : 16)) {
+		return;
+	}
+
+	addr.index     = ifa->ifa_index;
+	addr.family    = ifa->ifa_family;
+	addr.prefixlen = ifa->ifa_prefixlen;
+	addr.addr      = nl_attr_data(local);
+
+	if (tb[IFA_LABEL] != NULL) {
+		addr.label = nl_attr_str(tb[IFA_LABEL]);
+	}
+
+	ifacer->callbacks.on_addr(ifacer->data, event, &addr);
+}
+
+/**
+ * Moves on once the dump in flight is over.
+ */
+static int
+ifacer_dump_done(struct ifacer* ifacer)
+{
+	ifacer->seq = 0;
+
+	if (ifacer->state == IFACER_STATE_LINKS && !ifacer->resync) {
+		return ifacer_request(ifacer, IFACER_STATE_ADDRS);
+	}
+
+	if (ifacer->resync) {
+		ifacer->resync = 0;
+		return ifacer_request(ifacer, IFACER_STATE_LINKS);
+	}
+
+	ifacer->state = (ifacer->flags & IFACER_WATCH) ? IFACER_STATE_WATCH
+	                                               : IFACER_STATE_DONE;
+	if (ifacer->callbacks.on_synced != NULL) {
+		ifacer->callbacks.on_synced(ifacer->data);
+	}
+
+	return 0;
+}
+
+static int
+ifacer_dispatch(struct ifacer* ifacer, const struct nlmsghdr* msg)
+{
+	/**
+	 * Dump answers are multipart; notifications aren't, and carry the
+	 * sequence number of whoever caused them (e.g., `ip addr add`), so
+	 * that number alone doesn't tell them apart. Answers to a dump that
+	 * we gave up on are dropped.
+	 */
+	if ((msg->nlmsg_flags & NLM_F_MULTI) || msg->nlmsg_type == NLMSG_DONE ||
+	    msg->nlmsg_type == NLMSG_ERROR) {
+		if (ifacer->seq == 0 || msg->nlmsg_seq != ifacer->seq) {
+			return 0;
+		}
+
+		if (msg->nlmsg_type == NLMSG_DONE) {
+			return ifacer_dump_done(ifacer);
+		}
+
+		if (msg->nlmsg_type == NLMSG_ERROR) {
+			const struct nlmsgerr* err = NLMSG_DATA(msg);
+
+			return err->error;
+		}
+	} else if (ifacer->state == IFACER_STATE_DONE) {
+		return 0;
+	}
+
+	switch (msg->nlmsg_type) {
+		case RTM_NEWLINK:
+			ifacer_report_link(ifacer, IFACER_EVENT_NEW, msg);
+			break;
+		case RTM_DELLINK:
+			ifacer_report_link(ifacer, IFACER_EVENT_DEL, msg);
+			break;
+		case RTM_NEWADDR:
+			ifacer_report_addr(ifacer, IFACER_EVENT_NEW, msg);
+			break;
+		case RTM_DELADDR:
+			ifacer_report_addr(ifacer, IFACER_EVENT_DEL, msg);
+			break;
+	}
+
+	return 0;
+}
+
+int
+ifacer_step(struct ifacer* ifacer)
+{
+	for (;;) {
+		const struct nlmsghdr* msg;
+		ssize_t                n;
+
+		if (ifacer->state == IFACER_STATE_DONE) {
+			return 1;
+		}
+
+		n = kio_recv(ifacer->fd, ifacer->buf, NL_BUFSIZE, MSG_DONTWAIT);
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return 0;
+			}
+
+			/**
+			 * Notifications were dropped: what we know can't be
+			 * trusted anymore, so dump everything again (right
+			 * away if no dump is in flight, as the kernel only
+			 * runs one at a time per socket).
+			 */
+			if (errno == ENOBUFS) {
+				int err = 0;
+
+				if (ifacer->seq != 0) {
+					ifacer->resync = 1;
+				} else {
+					err = ifacer_request(
+					  ifacer, IFACER_STATE_LINKS);
+				}
+
+				if (err < 0) {
+					return err;
+				}
+				continue;
+			}
+
+			return -errno;
+		}
+
+		for (msg = (const struct nlmsghdr*)ifacer->buf;
+		     NLMSG_OK(msg, n);
+		     msg = NLMSG_NEXT(msg, n)) {
+			int ifindex = nl_msg_ifindex(msg);
+			int err;
+
+			PROBE2(event__start, msg->nlmsg_type, ifindex);
+			err = ifacer_dispatch(ifacer, msg);
+			PROBE2(event__end, msg->nlmsg_type, ifindex);
+
+			if (err < 0) {
+				return err;
+			}
+		}
+	}
+}
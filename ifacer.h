@@ -0,0 +1,146 @@
+#ifndef IFACER__IFACER_H
+#define IFACER__IFACER_H
+
+/**
+ * ifacer - interface enumeration and change tracking as a non-blocking
+ *          state machine, to be driven by the caller's own event loop.
+ *
+ * The ioctls used by the default listing block for a round trip each, so
+ * the library talks rtnetlink instead, over a single non-blocking socket
+ * that the caller polls:
+ *
+ *      struct ifacer* ifacer = ifacer_open(&callbacks, data, IFACER_WATCH);
+ *
+ *      epoll_ctl(epfd, EPOLL_CTL_ADD, ifacer_fd(ifacer), &(struct
+ *                epoll_event){ .events = EPOLLIN, ... });
+ *
+ *      ... on EPOLLIN:
+ *
+ *      if (ifacer_step(ifacer) < 0) { ... }
+ *
+ * `ifacer_step` reads whatever is available without blocking, invoking the
+ * callbacks for every link and address it parses, and moves the machine
+ * along:
+ *
+ *      LINKS  --(links dumped)-->  ADDRS  --(addresses dumped)-->  WATCH
+ *                                                           (or DONE)
+ *
+ * `on_synced` is called when the dumps are over: from then on (with
+ * IFACER_WATCH), callbacks report changes as the kernel notifies them.
+ * The socket is subscribed to notifications before the dumps start, so no
+ * change is missed in between; a change that races with the dumps may be
+ * reported twice (once by the dump, once as a notification).
+ *
+ * If the kernel drops notifications (the socket buffer overflowed because
+ * the caller didn't step in time), the machine starts over from LINKS and
+ * `on_synced` is called again once the state is known again.
+ *
+ * Pointers handed to callbacks are only valid during the callback.
+ *
+ * A thread driving many instances at once (e.g., one per network
+ * namespace) can take them from a pool (`ifacer_pool_new`): the instances
+ * are preallocated and share a single receive buffer, so memory stays the
+ * same however many are open.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ifacer;
+
+enum ifacer_flags {
+	/**
+	 * Keep reporting changes after the initial dumps.
+	 */
+	IFACER_WATCH = 1 << 0,
+};
+
+enum ifacer_event {
+	IFACER_EVENT_NEW = 0,
+	IFACER_EVENT_DEL,
+};
+
+struct ifacer_link {
+	uint32_t       index;
+	const char*    name;
+	uint32_t       flags; /* IFF_* */
+	uint32_t       mtu;
+	const uint8_t* mac; /* NULL for links without one */
+	size_t         mac_len;
+};
+
+struct ifacer_addr {
+	uint32_t    index;
+	int         family; /* AF_INET or AF_INET6 */
+	uint8_t     prefixlen;
+	const void* addr;  /* 4 or 16 bytes, network order */
+	const char* label; /* IPv4 only, NULL otherwise */
+};
+
+struct ifacer_callbacks {
+	void (*on_link)(void*                     data,
+	                enum ifacer_event         event,
+	                const struct ifacer_link* link);
+	void (*on_addr)(void*                     data,
+	                enum ifacer_event         event,
+	                const struct ifacer_addr* addr);
+	void (*on_synced)(void* data);
+};
+
+/**
+ * Opens the netlink socket and sends the first dump request.
+ *
+ * Returns NULL (with errno set) on failure.
+ */
+struct ifacer*
+ifacer_open(const struct ifacer_callbacks* callbacks, void* data, int flags);
+
+/**
+ * The file descriptor to poll for readability.
+ */
+int
+ifacer_fd(const struct ifacer* ifacer);
+
+/**
+ * Consumes everything readable on the socket without blocking.
+ *
+ * Returns 0 when there's nothing more to read for now, 1 once the dumps
+ * are over without IFACER_WATCH (nothing else will ever come), or a
+ * negative errno on failure.
+ */
+int
+ifacer_step(struct ifacer* ifacer);
+
+void
+ifacer_close(struct ifacer* ifacer);
+
+struct ifacer_pool;
+
+/**
+ * Preallocates `capacity` instances sharing one receive buffer. They must
+ * all be stepped from the same thread, and not from within a callback.
+ *
+ * Returns NULL (with errno set) on failure.
+ */
+struct ifacer_pool*
+ifacer_pool_new(size_t capacity);
+
+/**
+ * Same as `ifacer_open`, with an instance of `pool` (given back by
+ * `ifacer_close`).
+ *
+ * Returns NULL (with errno set, ENOSPC if they're all open) on failure.
+ */
+struct ifacer*
+ifacer_pool_open(struct ifacer_pool*            pool,
+                 const struct ifacer_callbacks* callbacks,
+                 void*                          data,
+                 int                            flags);
+
+/**
+ * Frees the pool, whose instances must all be closed.
+ */
+void
+ifacer_pool_free(struct ifacer_pool* pool);
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef IFACER__IFACER_HPP
+#define IFACER__IFACER_HPP
+
+/**
+ * ifacer.hpp - header-only C++17 wrapper over ifacer's rtnetlink
+ *              enumeration:
+ *
+ *      using ifacer::Fields;
+ *
+ *      for (auto& iface : ifacer::interfaces<Fields::Name | Fields::Ipv4 |
+ *                                            Fields::Mtu>()) {
+ *              std::cout << iface.name << " " << iface.mtu << "\n";
+ *      }
+ *
+ * The set of fields is a template parameter:
+ *
+ *   - `ifacer::iface<F>` only has members for the fields in F (each field
+ *     lives in its own base class, which is empty when not selected); and
+ *   - the code extracting a field from the netlink attributes is behind an
+ *     `if constexpr`, so unselected fields cost nothing at runtime. Without
+ *     Ipv4 / Ipv6 the address dump isn't even requested; with only one of
+ *     them the kernel filters the other family out.
+ *
+ * `Ipv4` and `Ipv6` hold the first address of that family the kernel
+ * reports for the interface (all zeroes if there's none).
+ *
+ * Entries are written into a caller-owned buffer and the range handed out
+ * (`ifacer::view<F>`) just points into it: nothing is allocated, and the
+ * view is move-only so that exactly one owner refers to the buffer. The
+ * argument-less overload uses a fixed thread-local buffer (overwritten by
+ * the next call on the same thread) of `IFACER_HPP_DEFAULT_CAPACITY`
+ * entries.
+ *
+ * If the buffer is too small, the first entries that fit are kept and
+ * `view::truncated()` tells so.
+ *
+ * Link with `libifacer.a` (`make lib`).
+ */
+
+extern "C" {
+#include "./nl.h"
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#ifndef IFACER_HPP_DEFAULT_CAPACITY
+#define IFACER_HPP_DEFAULT_CAPACITY 1024
+#endif
+
+namespace ifacer
+{
+
+enum class Fields : unsigned {
+	Name  = 1 << 0,
+	Mtu   = 1 << 1,
+	Flags = 1 << 2,
+	Mac   = 1 << 3,
+	Ipv4  = 1 << 4,
+	Ipv6  = 1 << 5,
+};
+
+constexpr Fields
+operator|(Fields a, Fields b)
+{
+	return static_cast<Fields>(static_cast<unsigned>(a) |
+	                           static_cast<unsigned>(b));
+}
+
+constexpr bool
+has(Fields set, Fields field)
+{
+	return (static_cast<unsigned>(set) & static_cast<unsigned>(field)) != 0;
+}
+
+namespace detail
+{
+
+template<bool>
+struct name_field {
+};
+template<>
+struct name_field<true> {
+	char name[IFNAMSIZ];
+};
+
+template<bool>
+struct mtu_field {
+};
+template<>
+struct mtu_field<true> {
+	uint32_t mtu;
+};
+
+template<bool>
+struct flags_field {
+};
+template<>
+struct flags_field<true> {
+	uint32_t flags; /* IFF_* */
+};
+
+template<bool>
+struct mac_field {
+};
+template<>
+struct mac_field<true> {
+	uint8_t mac[6];
+};
+
+template<bool>
+struct ipv4_field {
+};
+template<>
+struct ipv4_field<true> {
+	struct in_addr ipv4;
+	uint8_t        ipv4_prefixlen;
+};
+
+template<bool>
+struct ipv6_field {
+};
+template<>
+struct ipv6_field<true> {
+	struct in6_addr ipv6;
+	uint8_t         ipv6_prefixlen;
+};
+
+} // namespace detail
+
+template<Fields F>
+struct iface
+  : detail::name_field<has(F, Fields::Name)>
+  , detail::mtu_field<has(F, Fields::Mtu)>
+  , detail::flags_field<has(F, Fields::Flags)>
+  , detail::mac_field<has(F, Fields::Mac)>
+  , detail::ipv4_field<has(F, Fields::Ipv4)>
+  , detail::ipv6_field<has(F, Fields::Ipv6)> {
+	uint32_t index;
+};
+
+/**
+ * The interfaces enumerated into a caller-owned buffer.
+ */
+template<Fields F>
+class view
+{
+      public:
+	view(iface<F>* entries, size_t count, bool truncated, int error)
+	  : entries_(entries)
+	  , count_(count)
+	  , truncated_(truncated)
+	  , error_(error)
+	{
+	}
+
+	view(const view&)            = delete;
+	view& operator=(const view&) = delete;
+
+	view(view&& other) noexcept
+	  : entries_(other.entries_)
+	  , count_(other.count_)
+	  , truncated_(other.truncated_)
+	  , error_(other.error_)
+	{
+		other.entries_ = nullptr;
+		other.count_   = 0;
+	}
+
+	view& operator=(view&& other) noexcept
+	{
+		std::swap(entries_, other.entries_);
+		std::swap(count_, other.count_);
+		std::swap(truncated_, other.truncated_);
+		std::swap(error_, other.error_);
+		return *this;
+	}
+
+	iface<F>* begin() const
+	{
+		return entries_;
+	}
+	iface<F>* end() const
+	{
+		return entries_ + count_;
+	}
+	size_t size() const
+	{
+		return count_;
+	}
+
+	/**
+	 * Whether there were more interfaces than room in the buffer.
+	 */
+	bool truncated() const
+	{
+		return truncated_;
+	}
+
+	/**
+	 * 0, or the errno that stopped the enumeration (whatever was
+	 * gathered before it is still there).
+	 */
+	int error() const
+	{
+		return error_;
+	}
+
+      private:
+	iface<F>* entries_;
+	size_t    count_;
+	bool      truncated_;
+	int       error_;
+};
+
+namespace detail
+{
+
+template<Fields F>
+struct enumeration {
+	iface<F>* entries;
+	size_t    capacity;
+	size_t    count;
+	bool      truncated;
+};
+
+template<Fields F>
+int
+on_link(const struct nlmsghdr* msg, void* data)
+{
+	auto*       e   = static_cast<enumeration<F>*>(data);
+	const auto* ifi = static_cast<const struct ifinfomsg*>(NLMSG_DATA(msg));
+
+	if (msg->nlmsg_type != RTM_NEWLINK) {
+		return 0;
+	}
+
+	if (e->count == e->capacity) {
+		e->truncated = true;
+		return 0;
+	}
+
+	iface<F>& entry = e->entries[e->count++];
+
+	std::memset(&entry, 0, sizeof(entry));
+	entry.index = ifi->ifi_index;
+
+	if constexpr (has(F, Fields::Flags)) {
+		entry.flags = ifi->ifi_flags;
+	}
+
+	if constexpr (has(F, Fields::Name) || has(F, Fields::Mtu) ||
+	              has(F, Fields::Mac)) {
+		const struct nlattr* tb[IFLA_MAX + 1];
+
+		nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+
+		if constexpr (has(F, Fields::Name)) {
+			if (tb[IFLA_IFNAME] != nullptr) {
+				std::memcpy(
+				  entry.name,
+				  nl_attr_data(tb[IFLA_IFNAME]),
+				  strnlen(nl_attr_str(tb[IFLA_IFNAME]),
+				          IFNAMSIZ - 1));
+			}
+		}
+
+		if constexpr (has(F, Fields::Mtu)) {
+			if (tb[IFLA_MTU] != nullptr) {
+				entry.mtu = nl_attr_u32(tb[IFLA_MTU]);
+			}
+		}
+
+		if constexpr (has(F, Fields::Mac)) {
+			if (tb[IFLA_ADDRESS] != nullptr) {
+				std::memcpy(
+				  entry.mac,
+				  nl_attr_data(tb[IFLA_ADDRESS]),
+				  std::min(nl_attr_len(tb[IFLA_ADDRESS]),
+				           sizeof(entry.mac)));
+			}
+		}
+	}
+
+	return 0;
+}
+
+template<Fields F>
+int
+on_addr(const struct nlmsghdr* msg, void* data)
+{
+	auto*       e   = static_cast<enumeration<F>*>(data);
+	const auto* ifa = static_cast<const struct ifaddrmsg*>(NLMSG_DATA(msg));
+	const struct nlattr* tb[IFA_MAX + 1];
+	const struct nlattr* local;
+
+	if (msg->nlmsg_type != RTM_NEWADDR) {
+		return 0;
+	}
+
+	auto* entry =
+	  std::lower_bound(e->entries,
+	                   e->entries + e->count,
+	                   ifa->ifa_index,
+	                   [](const iface<F>& entry, uint32_t index) {
+		                   return entry.index < index;
+	                   });
+	if (entry == e->entries + e->count || entry->index != ifa->ifa_index) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+	local = tb[IFA_LOCAL] != nullptr ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	if (local == nullptr) {
+		return 0;
+	}
+
+	if constexpr (has(F, Fields::Ipv4)) {
+		if (ifa->ifa_family == AF_INET && entry->ipv4.s_addr == 0 &&
+		    nl_attr_len(local) >= sizeof(entry->ipv4)) {
+			std::memcpy(&entry->ipv4,
+			            nl_attr_data(local),
+			            sizeof(entry->ipv4));
+			entry->ipv4_prefixlen = ifa->ifa_prefixlen;
+		}
+	}
+
+	if constexpr (has(F, Fields::Ipv6)) {
+		if (ifa->ifa_family == AF_INET6 &&
+		    IN6_IS_ADDR_UNSPECIFIED(&entry->ipv6) &&
+		    nl_attr_len(local) >= sizeof(entry->ipv6)) {
+			std::memcpy(&entry->ipv6,
+			            nl_attr_data(local),
+			            sizeof(entry->ipv6));
+			entry->ipv6_prefixlen = ifa->ifa_prefixlen;
+		}
+	}
+
+	return 0;
+}
+
+template<Fields F>
+int
+enumerate(int fd, enumeration<F>& e)
+{
+	struct {
+		struct nlmsghdr hdr;
+		union {
+			struct ifinfomsg ifi;
+			struct ifaddrmsg ifa;
+		};
+	} req{};
+	int err;
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifi));
+	req.hdr.nlmsg_type  = RTM_GETLINK;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	err = nl_transact(fd, &req.hdr, on_link<F>, &e);
+	if (err < 0) {
+		return -err;
+	}
+
+	/**
+	 * Links usually come in index order already; addresses are then
+	 * matched to them with a binary search.
+	 */
+	std::sort(e.entries,
+	          e.entries + e.count,
+	          [](const iface<F>& a, const iface<F>& b) {
+		          return a.index < b.index;
+	          });
+
+	if constexpr (has(F, Fields::Ipv4) || has(F, Fields::Ipv6)) {
+		std::memset(&req, 0, sizeof(req));
+		req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifa));
+		req.hdr.nlmsg_type  = RTM_GETADDR;
+		req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		if constexpr (!has(F, Fields::Ipv6)) {
+			req.ifa.ifa_family = AF_INET;
+		} else if constexpr (!has(F, Fields::Ipv4)) {
+			req.ifa.ifa_family = AF_INET6;
+		}
+
+		err = nl_transact(fd, &req.hdr, on_addr<F>, &e);
+		if (err < 0) {
+			return -err;
+		}
+	}
+
+	return 0;
+}
+
+} // namespace detail
+
+/**
+ * Enumerates the interfaces into `entries` (room for `capacity` of them).
+ */
+template<Fields F>
+view<F>
+interfaces(iface<F>* entries, size_t capacity)
+{
+	detail::enumeration<F> e{ entries, capacity, 0, false };
+	int                    err;
+	int                    fd;
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		return view<F>(entries, 0, false, errno);
+	}
+
+	err = detail::enumerate(fd, e);
+	close(fd);
+
+	return view<F>(entries, e.count, e.truncated, err);
+}
+
+template<Fields F, size_t N>
+view<F>
+interfaces(iface<F> (&entries)[N])
+{
+	return interfaces<F>(entries, N);
+}
+
+template<Fields F>
+view<F>
+interfaces()
+{
+	static thread_local iface<F> entries[IFACER_HPP_DEFAULT_CAPACITY];
+
+	return interfaces<F>(entries, IFACER_HPP_DEFAULT_CAPACITY);
+}
+
+} // namespace ifacer
+
+#endif
@@ -0,0 +1,93 @@
+#define _GNU_SOURCE
+#include "./interrupt.h"
+
+#include <signal.h>
+#include <stddef.h>
+#include <time.h>
+
+static volatile sig_atomic_t interrupt_caught = 0;
+
+/**
+ * The signal mask to wait with (the one blocking SIGINT and SIGTERM, minus
+ * them), or NULL if they aren't caught.
+ */
+static sigset_t  interrupt_wait_mask;
+static sigset_t* interrupt_mask = NULL;
+
+static void
+interrupt_handler(int sig)
+{
+	interrupt_caught = sig;
+}
+
+void
+interrupt_catch(void)
+{
+	struct sigaction action = { .sa_handler = interrupt_handler };
+	sigset_t         signals;
+
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &signals, &interrupt_wait_mask);
+	sigdelset(&interrupt_wait_mask, SIGINT);
+	sigdelset(&interrupt_wait_mask, SIGTERM);
+	interrupt_mask = &interrupt_wait_mask;
+}
+
+int
+interrupt_signal(void)
+{
+	return interrupt_caught;
+}
+
+int
+interrupt_poll(struct pollfd* fds, nfds_t n, int timeout_ms)
+{
+	struct timespec timeout = {
+		.tv_sec  = timeout_ms / 1000,
+		.tv_nsec = (long)(timeout_ms % 1000) * 1000000,
+	};
+
+	return ppoll(fds, n, timeout_ms < 0 ? NULL : &timeout, interrupt_mask);
+}
+
+int
+interrupt_epoll_wait(int                 epfd,
+                     struct epoll_event* events,
+                     int                 max,
+                     int                 timeout_ms)
+{
+	return epoll_pwait(epfd, events, max, timeout_ms, interrupt_mask);
+}
+
+int
+interrupt_sleep_until(int64_t deadline_ms)
+{
+	for (;;) {
+		struct timespec now;
+		int64_t         left;
+
+		clock_gettime(CLOCK_REALTIME, &now);
+		left = deadline_ms -
+		       ((int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+		if (left <= 0) {
+			return 0;
+		}
+
+		/**
+		 * Long sleeps are cut in pieces that fit the timeout.
+		 */
+		if (left > INT32_MAX) {
+			left = INT32_MAX;
+		}
+
+		if (interrupt_poll(NULL, 0, (int)left) == -1) {
+			return -1;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef IFACER__INTERRUPT_H
+#define IFACER__INTERRUPT_H
+
+/**
+ * interrupt - ends long-running modes on SIGINT and SIGTERM through the
+ *             normal exit path, so that exit handlers (the `--stats`
+ *             summary, the `--record` capture, the terminal `--top` took
+ *             over) still run.
+ *
+ * Once caught, the signals are blocked and only let through while a mode
+ * waits, in `interrupt_poll`, `interrupt_epoll_wait` or
+ * `interrupt_sleep_until` (ppoll(2) and epoll_pwait(2) swap the signal mask
+ * and wait atomically). A signal that comes while a mode is busy stays
+ * pending until its next wait, which then fails with EINTR right away, so
+ * none is lost between checking `interrupt_signal` and blocking. Modes
+ * return once it's set, and `main` exits with 128 + the signal number, as
+ * a shell would report it.
+ *
+ * Until `interrupt_catch` is called, the waits are plain poll(2),
+ * epoll_wait(2) and sleeps.
+ */
+
+#include <poll.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/**
+ * Installs the handler for SIGINT and SIGTERM, and blocks them outside of
+ * the waits below.
+ */
+void
+interrupt_catch(void);
+
+/**
+ * The signal that was caught, or 0 if none was.
+ */
+int
+interrupt_signal(void);
+
+/**
+ * poll(2), letting SIGINT and SIGTERM through while it waits.
+ */
+int
+interrupt_poll(struct pollfd* fds, nfds_t n, int timeout_ms);
+
+/**
+ * epoll_wait(2), letting SIGINT and SIGTERM through while it waits.
+ */
+int
+interrupt_epoll_wait(int                 epfd,
+                     struct epoll_event* events,
+                     int                 max,
+                     int                 timeout_ms);
+
+/**
+ * Sleeps until `deadline_ms` (milliseconds since the epoch, of
+ * CLOCK_REALTIME), letting SIGINT and SIGTERM through.
+ *
+ * Returns 0, or -1 with errno set to EINTR if a signal came first.
+ */
+int
+interrupt_sleep_until(int64_t deadline_ms);
+
+#endif
@@ -0,0 +1,307 @@
+#include "./inventory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Slots hold `index + 1` so that zeroed memory means empty.
+ */
+#define INVENTORY_EMPTY 0
+
+/**
+ * Makes room for `cap` elements of `size` bytes in the column `*column`.
+ */
+static int
+inventory_grow(void** column, size_t size, size_t cap)
+{
+	void* grown = realloc(*column, cap * size);
+
+	if (grown == NULL) {
+		return -1;
+	}
+
+	*column = grown;
+	return 0;
+}
+
+static uint32_t
+inventory_hash(uint32_t hash, const void* data, size_t len)
+{
+	const unsigned char* bytes = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+uint32_t
+inventory_intern(struct inventory* inventory, const char* str, size_t len)
+{
+	return strtab_intern(&inventory->strings, str, len);
+}
+
+static uint32_t
+inventory_record_hash(uint32_t name, const struct in_addr* addr)
+{
+	uint32_t hash = inventory_hash(2166136261u, &name, sizeof(name));
+
+	return inventory_hash(hash, addr, sizeof(*addr));
+}
+
+/**
+ * Returns the slot of the record (`name`, `addr`), or the empty slot it
+ * would go in.
+ */
+static uint32_t*
+inventory_record_slot(const struct inventory_v4* v4,
+                      uint32_t                   hash,
+                      uint32_t                   name,
+                      const struct in_addr*      addr)
+{
+	size_t mask = v4->n_slots - 1;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		uint32_t* slot = &v4->slots[i];
+
+		if (*slot == INVENTORY_EMPTY) {
+			return slot;
+		}
+
+		if (v4->name[*slot - 1] == name &&
+		    v4->addr[*slot - 1].s_addr == addr->s_addr) {
+			return slot;
+		}
+	}
+}
+
+static int
+inventory_record_rehash(struct inventory_v4* v4)
+{
+	size_t    n_slots = v4->n_slots ? v4->n_slots * 2 : 256;
+	uint32_t* slots   = calloc(n_slots, sizeof(*slots));
+
+	if (slots == NULL) {
+		return -1;
+	}
+
+	free(v4->slots);
+	v4->slots   = slots;
+	v4->n_slots = n_slots;
+
+	for (size_t r = 0; r < v4->count; r++) {
+		*inventory_record_slot(
+		  v4,
+		  inventory_record_hash(v4->name[r], &v4->addr[r]),
+		  v4->name[r],
+		  &v4->addr[r]) = r + 1;
+	}
+
+	return 0;
+}
+
+int
+inventory_netns_begin(struct inventory* inventory, uint32_t name)
+{
+	struct inventory_netns* netns;
+
+	if (inventory->n_netns == inventory->cap_netns) {
+		size_t cap =
+		  inventory->cap_netns ? inventory->cap_netns * 2 : 16;
+
+		if (inventory_grow((void**)&inventory->netns,
+		                   sizeof(*inventory->netns),
+		                   cap) < 0) {
+			return -1;
+		}
+
+		inventory->cap_netns = cap;
+	}
+
+	netns            = &inventory->netns[inventory->n_netns++];
+	*netns           = (struct inventory_netns){ 0 };
+	netns->name      = name;
+	netns->first_ref = inventory->n_refs;
+	netns->same_as   = INVENTORY_UNIQUE;
+
+	return 0;
+}
+
+/**
+ * Whether `a` and `b` refer to the same records.
+ */
+static int
+inventory_netns_equal(const struct inventory*       inventory,
+                      const struct inventory_netns* a,
+                      const struct inventory_netns* b)
+{
+	return a->hash == b->hash && a->count_refs == b->count_refs &&
+	       !memcmp(&inventory->refs[a->first_ref],
+	               &inventory->refs[b->first_ref],
+	               a->count_refs * sizeof(*inventory->refs));
+}
+
+/**
+ * Returns the slot of the namespace that `netns` is identical to, or the
+ * empty slot it would go in.
+ */
+static uint32_t*
+inventory_netns_slot(const struct inventory*       inventory,
+                     const struct inventory_netns* netns)
+{
+	size_t mask = inventory->n_netns_slots - 1;
+
+	for (size_t i = netns->hash & mask;; i = (i + 1) & mask) {
+		uint32_t* slot = &inventory->netns_slots[i];
+
+		if (*slot == INVENTORY_EMPTY ||
+		    inventory_netns_equal(
+		      inventory, netns, &inventory->netns[*slot - 1])) {
+			return slot;
+		}
+	}
+}
+
+/**
+ * Grows the table of namespaces, re-adding every earlier one that owns
+ * its references (the current one is looked up by the caller).
+ */
+static int
+inventory_netns_rehash(struct inventory* inventory)
+{
+	size_t n_slots =
+	  inventory->n_netns_slots ? inventory->n_netns_slots * 2 : 64;
+	uint32_t* slots = calloc(n_slots, sizeof(*slots));
+
+	if (slots == NULL) {
+		return -1;
+	}
+
+	free(inventory->netns_slots);
+	inventory->netns_slots   = slots;
+	inventory->n_netns_slots = n_slots;
+
+	for (size_t n = 0; n + 1 < inventory->n_netns; n++) {
+		const struct inventory_netns* netns = &inventory->netns[n];
+
+		if (netns->same_as == INVENTORY_UNIQUE &&
+		    netns->count_refs > 0) {
+			*inventory_netns_slot(inventory, netns) = n + 1;
+		}
+	}
+
+	return 0;
+}
+
+int
+inventory_netns_end(struct inventory* inventory)
+{
+	struct inventory_netns* netns =
+	  &inventory->netns[inventory->n_netns - 1];
+	uint32_t* slot;
+
+	netns->count_refs = inventory->n_refs - netns->first_ref;
+
+	/**
+	 * Empty namespaces have nothing worth sharing.
+	 */
+	if (netns->count_refs == 0) {
+		return 0;
+	}
+
+	netns->hash =
+	  inventory_hash(2166136261u,
+	                 &inventory->refs[netns->first_ref],
+	                 netns->count_refs * sizeof(*inventory->refs));
+
+	if ((inventory->n_owners + 1) * 2 > inventory->n_netns_slots &&
+	    inventory_netns_rehash(inventory) < 0) {
+		return -1;
+	}
+
+	slot = inventory_netns_slot(inventory, netns);
+	if (*slot == INVENTORY_EMPTY) {
+		*slot = inventory->n_netns;
+		inventory->n_owners++;
+		return 0;
+	}
+
+	/**
+	 * The references were appended last: dropping them is just
+	 * rewinding the array.
+	 */
+	inventory->n_refs = netns->first_ref;
+	netns->count_refs = 0;
+	netns->same_as    = *slot - 1;
+	return 0;
+}
+
+int
+inventory_add_v4(struct inventory*     inventory,
+                 const char*           name,
+                 size_t                len,
+                 const struct in_addr* addr)
+{
+	struct inventory_v4* v4 = &inventory->v4;
+	uint32_t             id = strtab_intern(&inventory->strings, name, len);
+	uint32_t*            slot;
+
+	if (id == STRTAB_NONE) {
+		return -1;
+	}
+
+	if (inventory->n_refs == inventory->cap_refs) {
+		size_t cap = inventory->cap_refs ? inventory->cap_refs * 2 : 64;
+
+		if (inventory_grow((void**)&inventory->refs,
+		                   sizeof(*inventory->refs),
+		                   cap) < 0) {
+			return -1;
+		}
+
+		inventory->cap_refs = cap;
+	}
+
+	if ((v4->count + 1) * 2 > v4->n_slots &&
+	    inventory_record_rehash(v4) < 0) {
+		return -1;
+	}
+
+	slot =
+	  inventory_record_slot(v4, inventory_record_hash(id, addr), id, addr);
+	if (*slot == INVENTORY_EMPTY) {
+		if (v4->count == v4->cap) {
+			size_t cap = v4->cap ? v4->cap * 2 : 64;
+
+			if (inventory_grow(
+			      (void**)&v4->name, sizeof(*v4->name), cap) < 0 ||
+			    inventory_grow(
+			      (void**)&v4->addr, sizeof(*v4->addr), cap) < 0) {
+				return -1;
+			}
+
+			v4->cap = cap;
+		}
+
+		v4->name[v4->count] = id;
+		v4->addr[v4->count] = *addr;
+		*slot               = ++v4->count;
+	}
+
+	inventory->refs[inventory->n_refs++] = *slot - 1;
+	return 0;
+}
+
+void
+inventory_free(struct inventory* inventory)
+{
+	strtab_free(&inventory->strings);
+	free(inventory->v4.name);
+	free(inventory->v4.addr);
+	free(inventory->v4.slots);
+	free(inventory->refs);
+	free(inventory->netns);
+	free(inventory->netns_slots);
+	*inventory = (struct inventory){ 0 };
+}
@@ -0,0 +1,137 @@
+#ifndef IFACER__INVENTORY_H
+#define IFACER__INVENTORY_H
+
+/**
+ * inventory - compact storage for the addresses of (possibly very many)
+ *             interfaces across (possibly very many) network namespaces.
+ *
+ * Instead of keeping one `struct ifreq` (40 bytes: a 16-byte name and a
+ * 24-byte union) per IPv4 address, addresses are kept in a structure of
+ * arrays:
+ *
+ *      v4.name[r]  v4.addr[r]         8 bytes per distinct record
+ *      refs[i]                        4 bytes per address
+ *
+ * where names (of interfaces and namespaces alike) are ids of an interned
+ * string table (see `strtab.h`), so each distinct name is stored once no
+ * matter how many namespaces have it. Scans that only look at one column
+ * (e.g., every address) walk contiguous memory.
+ *
+ * Records are added one namespace at a time, between
+ * `inventory_netns_begin` and `inventory_netns_end`; the first namespace
+ * is the one ifacer started in. On dense nodes most namespaces look alike
+ * (e.g., pods with the same `lo` and an `eth0` whose address differs), so
+ * records are deduplicated by content hash: a namespace is a run of
+ * references (`refs`) to records, and the shared `lo` is stored once.
+ * When a namespace is closed its references are hashed too and, if an
+ * earlier namespace has the very same ones, they're dropped and the
+ * namespace refers to that one instead (`same_as`).
+ */
+
+#include "./strtab.h"
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Distinct records, looked up through an open-addressing hash table of
+ * their indexes.
+ */
+struct inventory_v4 {
+	uint32_t*       name;
+	struct in_addr* addr;
+	size_t          count;
+	size_t          cap;
+	uint32_t*       slots;
+	size_t          n_slots;
+};
+
+#define INVENTORY_UNIQUE UINT32_MAX
+
+/**
+ * A namespace and the range of references (`refs`) it owns.
+ */
+struct inventory_netns {
+	uint32_t name;
+	uint32_t hash;
+	size_t   first_ref;
+	size_t   count_refs;
+
+	/**
+	 * Index of the namespace whose records are identical to this one's
+	 * (which then owns no references), or INVENTORY_UNIQUE.
+	 */
+	uint32_t same_as;
+};
+
+struct inventory {
+	struct strtab       strings;
+	struct inventory_v4 v4;
+
+	/**
+	 * Indexes into `v4`, a run per namespace.
+	 */
+	uint32_t* refs;
+	size_t    n_refs;
+	size_t    cap_refs;
+
+	struct inventory_netns* netns;
+	size_t                  n_netns;
+	size_t                  cap_netns;
+
+	/**
+	 * Hash table of the namespaces that own their references.
+	 */
+	uint32_t* netns_slots;
+	size_t    n_netns_slots;
+	size_t    n_owners;
+};
+
+/**
+ * Interns `str` (e.g., the name of a namespace) in the inventory's string
+ * table. Returns STRTAB_NONE if out of memory.
+ */
+uint32_t
+inventory_intern(struct inventory* inventory, const char* str, size_t len);
+
+/**
+ * Starts a namespace named `name` (an id from `inventory_intern`); the
+ * records added until `inventory_netns_end` belong to it.
+ *
+ * Returns 0 or -1 if out of memory.
+ */
+int
+inventory_netns_begin(struct inventory* inventory, uint32_t name);
+
+/**
+ * Closes the current namespace, sharing the references of an earlier,
+ * identical namespace if there's one.
+ *
+ * Returns 0 or -1 if out of memory.
+ */
+int
+inventory_netns_end(struct inventory* inventory);
+
+/**
+ * Adds an address of the interface `name` (`len` bytes) to the current
+ * namespace, referring to an existing record if there's an identical one.
+ *
+ * Returns 0 or -1 if out of memory.
+ */
+int
+inventory_add_v4(struct inventory*     inventory,
+                 const char*           name,
+                 size_t                len,
+                 const struct in_addr* addr);
+
+static inline const char*
+inventory_str(const struct inventory* inventory, uint32_t id)
+{
+	return strtab_get(&inventory->strings, id);
+}
+
+void
+inventory_free(struct inventory* inventory);
+
+#endif
@@ -0,0 +1,837 @@
+#define _GNU_SOURCE
+#include "./kio.h"
+#include "./stats.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KIO_MAGIC "IFACERC1"
+#define KIO_MAGIC_LEN 8
+#define KIO_MAX_FDS 4096
+#define KIO_KEY_MAX 64
+
+enum kio_mode {
+	KIO_MODE_LIVE = 0,
+	KIO_MODE_RECORD,
+	KIO_MODE_REPLAY,
+};
+
+/**
+ * What we know about the netlink sockets in use: enough to key their
+ * answers and to rewrite sequence numbers on replay.
+ */
+struct kio_fd {
+	int      netlink;
+	int      protocol;
+	uint32_t groups;
+	uint32_t seq;
+};
+
+/**
+ * A record of the capture being replayed. `key` and `payload` point into
+ * the mapped capture file.
+ */
+struct kio_entry {
+	struct kio_hdr    hdr;
+	const char*       key;
+	const char*       payload;
+	struct kio_entry* next;
+};
+
+/**
+ * The records that share the same kind, request and key, in the order
+ * they were captured; `head` is the next one to be handed out.
+ */
+struct kio_queue {
+	uint64_t          hash;
+	struct kio_entry* first;
+	struct kio_entry* head;
+	struct kio_entry* tail;
+};
+
+static struct {
+	enum kio_mode     mode;
+	pthread_mutex_t   lock;
+	FILE*             out;
+	struct kio_fd     fds[KIO_MAX_FDS];
+	char*             capture;
+	size_t            capture_len;
+	struct kio_entry* entries;
+	size_t            n_entries;
+	struct kio_queue* queues;
+	size_t            n_queues;
+} kio = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t
+kio_hash(uint32_t kind, uint64_t request, const char* key, size_t key_len)
+{
+	uint64_t hash = 1469598103934665603ULL;
+
+	hash = (hash ^ kind) * 1099511628211ULL;
+	hash = (hash ^ request) * 1099511628211ULL;
+	for (size_t i = 0; i < key_len; i++) {
+		hash = (hash ^ (unsigned char)key[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static int
+kio_entry_matches(const struct kio_entry* entry,
+                  uint32_t                kind,
+                  uint64_t                request,
+                  const char*             key,
+                  size_t                  key_len)
+{
+	return entry->hdr.kind == kind && entry->hdr.request == request &&
+	       entry->hdr.key_len == key_len &&
+	       !memcmp(entry->key, key, key_len);
+}
+
+/**
+ * Finds the queue of records for (kind, request, key), or the empty slot
+ * where it should go.
+ */
+static struct kio_queue*
+kio_queue_find(uint32_t kind, uint64_t request, const char* key, size_t key_len)
+{
+	uint64_t hash = kio_hash(kind, request, key, key_len);
+	size_t   mask = kio.n_queues - 1;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		struct kio_queue* queue = &kio.queues[i];
+
+		if (queue->first == NULL ||
+		    (queue->hash == hash &&
+		     kio_entry_matches(
+		       queue->first, kind, request, key, key_len))) {
+			queue->hash = hash;
+			return queue;
+		}
+	}
+}
+
+/**
+ * Hands out the next record for (kind, request, key), or NULL if there's
+ * none left. With `consume` unset the record is left in place (MSG_PEEK).
+ */
+static const struct kio_entry*
+kio_take(uint32_t    kind,
+         uint64_t    request,
+         const char* key,
+         size_t      key_len,
+         int         consume)
+{
+	struct kio_queue* queue;
+	struct kio_entry* entry;
+
+	pthread_mutex_lock(&kio.lock);
+	queue = kio_queue_find(kind, request, key, key_len);
+	entry = queue->head;
+	if (entry != NULL && consume) {
+		queue->head = entry->next;
+	}
+	pthread_mutex_unlock(&kio.lock);
+
+	return entry;
+}
+
+static void
+kio_write(FILE*       out,
+          uint32_t    kind,
+          uint64_t    request,
+          const char* key,
+          size_t      key_len,
+          int64_t     ret,
+          const void* payload,
+          size_t      len)
+{
+	struct kio_hdr hdr = {
+		.kind    = kind,
+		.key_len = key_len,
+		.request = request,
+		.ret     = ret,
+		.len     = len,
+	};
+
+	fwrite(&hdr, sizeof(hdr), 1, out);
+	fwrite(key, 1, key_len, out);
+	fwrite(payload, 1, len, out);
+}
+
+static void
+kio_record_entry(uint32_t    kind,
+                 uint64_t    request,
+                 const char* key,
+                 size_t      key_len,
+                 int64_t     ret,
+                 const void* payload,
+                 size_t      len)
+{
+	pthread_mutex_lock(&kio.lock);
+	kio_write(kio.out, kind, request, key, key_len, ret, payload, len);
+	pthread_mutex_unlock(&kio.lock);
+}
+
+static void
+kio_flush(void)
+{
+	if (kio.out != NULL) {
+		fclose(kio.out);
+		kio.out = NULL;
+	}
+}
+
+int
+kio_record(const char* path)
+{
+	kio.out = fopen(path, "w");
+	if (kio.out == NULL) {
+		return -1;
+	}
+
+	fwrite(KIO_MAGIC, 1, KIO_MAGIC_LEN, kio.out);
+	kio.mode = KIO_MODE_RECORD;
+	atexit(kio_flush);
+
+	return 0;
+}
+
+int
+kio_replay(const char* path)
+{
+	struct stat st;
+	size_t      off;
+	size_t      count = 0;
+	int         fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) == -1 || st.st_size < KIO_MAGIC_LEN) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	kio.capture_len = st.st_size;
+	kio.capture =
+	  mmap(NULL, kio.capture_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (kio.capture == MAP_FAILED ||
+	    memcmp(kio.capture, KIO_MAGIC, KIO_MAGIC_LEN)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/**
+	 * First pass: count the records (and validate their lengths) so that
+	 * everything can be allocated at once.
+	 */
+	for (off = KIO_MAGIC_LEN;
+	     off + sizeof(struct kio_hdr) <= kio.capture_len;) {
+		struct kio_hdr hdr;
+
+		memcpy(&hdr, kio.capture + off, sizeof(hdr));
+		off += sizeof(hdr);
+		if (hdr.key_len > kio.capture_len - off ||
+		    hdr.len > kio.capture_len - off - hdr.key_len) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		off += hdr.key_len + hdr.len;
+		count++;
+	}
+
+	kio.n_queues = 16;
+	while (kio.n_queues < count * 2) {
+		kio.n_queues *= 2;
+	}
+
+	kio.entries = calloc(count ? count : 1, sizeof(*kio.entries));
+	kio.queues  = calloc(kio.n_queues, sizeof(*kio.queues));
+	if (kio.entries == NULL || kio.queues == NULL) {
+		return -1;
+	}
+
+	for (off = KIO_MAGIC_LEN; kio.n_entries < count;) {
+		struct kio_entry* entry = &kio.entries[kio.n_entries++];
+		struct kio_queue* queue;
+
+		memcpy(&entry->hdr, kio.capture + off, sizeof(entry->hdr));
+		entry->key     = kio.capture + off + sizeof(entry->hdr);
+		entry->payload = entry->key + entry->hdr.key_len;
+		off += sizeof(entry->hdr) + entry->hdr.key_len + entry->hdr.len;
+
+		queue = kio_queue_find(entry->hdr.kind,
+		                       entry->hdr.request,
+		                       entry->key,
+		                       entry->hdr.key_len);
+		if (queue->first == NULL) {
+			queue->first = queue->head = entry;
+		} else {
+			queue->tail->next = entry;
+		}
+		queue->tail = entry;
+	}
+
+	kio.mode = KIO_MODE_REPLAY;
+	return 0;
+}
+
+int
+kio_synthesize(const char* path, size_t count)
+{
+	struct ifreq* ifreqs;
+	FILE*         out;
+	int           len = count * sizeof(*ifreqs);
+
+	ifreqs = calloc(count ? count : 1, sizeof(*ifreqs));
+	if (ifreqs == NULL) {
+		return -1;
+	}
+
+	out = fopen(path, "w");
+	if (out == NULL) {
+		free(ifreqs);
+		return -1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct sockaddr_in* addr =
+		  (struct sockaddr_in*)&ifreqs[i].ifr_addr;
+
+		snprintf(ifreqs[i].ifr_name, IFNAMSIZ, "syn%u", (unsigned)i);
+		addr->sin_family      = AF_INET;
+		addr->sin_addr.s_addr = htonl((10u << 24) | (uint32_t)(i + 1));
+	}
+
+	fwrite(KIO_MAGIC, 1, KIO_MAGIC_LEN, out);
+
+	/**
+	 * Same sequence as the listing does: size the answer, fill it and
+	 * then ask for the address of every interface.
+	 */
+	kio_write(out, KIO_IOCTL, SIOCGIFCONF, "", 0, 0, &len, sizeof(len));
+
+	{
+		char* payload = malloc(sizeof(len) + len);
+
+		if (payload == NULL) {
+			fclose(out);
+			free(ifreqs);
+			return -1;
+		}
+
+		memcpy(payload, &len, sizeof(len));
+		memcpy(payload + sizeof(len), ifreqs, len);
+		kio_write(out,
+		          KIO_IOCTL,
+		          SIOCGIFCONF,
+		          "",
+		          0,
+		          0,
+		          payload,
+		          sizeof(len) + len);
+		free(payload);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		kio_write(out,
+		          KIO_IOCTL,
+		          SIOCGIFADDR,
+		          ifreqs[i].ifr_name,
+		          strlen(ifreqs[i].ifr_name),
+		          0,
+		          &ifreqs[i],
+		          sizeof(ifreqs[i]));
+	}
+
+	free(ifreqs);
+	return fclose(out);
+}
+
+int
+kio_socket(int domain, int type, int protocol)
+{
+	int fd;
+
+	stats_syscall(0);
+	if (kio.mode == KIO_MODE_REPLAY) {
+		/**
+		 * Callers still need a descriptor to close; nothing is ever
+		 * read from or written to it.
+		 */
+		fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	} else {
+		fd = socket(domain, type, protocol);
+	}
+
+	if (fd >= 0 && fd < KIO_MAX_FDS) {
+		kio.fds[fd] = (struct kio_fd){
+			.netlink  = domain == AF_NETLINK,
+			.protocol = protocol,
+		};
+	}
+
+	return fd;
+}
+
+int
+kio_bind(int fd, const struct sockaddr* addr, socklen_t len)
+{
+	stats_syscall(0);
+
+	if (fd >= 0 && fd < KIO_MAX_FDS && kio.fds[fd].netlink &&
+	    len >= sizeof(struct sockaddr_nl)) {
+		kio.fds[fd].groups =
+		  ((const struct sockaddr_nl*)addr)->nl_groups;
+	}
+
+	if (kio.mode == KIO_MODE_REPLAY) {
+		return 0;
+	}
+
+	return bind(fd, addr, len);
+}
+
+ssize_t
+kio_sendto(int                    fd,
+           const void*            buf,
+           size_t                 len,
+           int                    flags,
+           const struct sockaddr* addr,
+           socklen_t              addr_len)
+{
+	stats_syscall(0);
+
+	if (fd >= 0 && fd < KIO_MAX_FDS && kio.fds[fd].netlink &&
+	    len >= sizeof(struct nlmsghdr)) {
+		kio.fds[fd].seq = ((const struct nlmsghdr*)buf)->nlmsg_seq;
+	}
+
+	if (kio.mode == KIO_MODE_REPLAY) {
+		return len;
+	}
+
+	return sendto(fd, buf, len, flags, addr, addr_len);
+}
+
+static size_t
+kio_netlink_key(int fd, char* key)
+{
+	const struct kio_fd* info = &kio.fds[fd < KIO_MAX_FDS ? fd : 0];
+
+	return snprintf(
+	  key, KIO_KEY_MAX, "nl:%d:%u", info->protocol, info->groups);
+}
+
+/**
+ * Points the answers being replayed to the request that is waiting for
+ * them (notifications, with a sequence number of 0, are left alone).
+ */
+static void
+kio_rewrite_seq(int fd, void* buf, size_t len)
+{
+	struct nlmsghdr* msg = buf;
+	int              n   = len;
+
+	if (fd < 0 || fd >= KIO_MAX_FDS) {
+		return;
+	}
+
+	for (; NLMSG_OK(msg, n); msg = NLMSG_NEXT(msg, n)) {
+		if (msg->nlmsg_seq != 0) {
+			msg->nlmsg_seq = kio.fds[fd].seq;
+		}
+	}
+}
+
+static ssize_t
+kio_recv_answer(int fd, void* buf, size_t len, int flags)
+{
+	const struct kio_entry* entry;
+	char                    key[KIO_KEY_MAX];
+	size_t                  key_len;
+	ssize_t                 n;
+
+	if (kio.mode == KIO_MODE_LIVE) {
+		return recv(fd, buf, len, flags);
+	}
+
+	key_len = kio_netlink_key(fd, key);
+
+	if (kio.mode == KIO_MODE_RECORD) {
+		n = recv(fd, buf, len, flags);
+
+		/**
+		 * Peeks are answered from the record of the actual read, and
+		 * "nothing yet" is what replay says when it runs out anyway.
+		 */
+		if ((flags & MSG_PEEK) ||
+		    (n == -1 && (errno == EAGAIN || errno == EINTR))) {
+			return n;
+		}
+
+		kio_record_entry(KIO_RECV,
+		                 0,
+		                 key,
+		                 key_len,
+		                 n == -1 ? -errno : n,
+		                 buf,
+		                 n > 0 ? ((size_t)n < len ? (size_t)n : len)
+		                       : 0);
+		return n;
+	}
+
+	entry = kio_take(KIO_RECV, 0, key, key_len, !(flags & MSG_PEEK));
+	if (entry == NULL) {
+		/**
+		 * "Nothing yet" is never recorded, so running out of records
+		 * means the capture is over, even for non-blocking reads
+		 * (which would otherwise spin on a descriptor that's always
+		 * readable).
+		 */
+		errno = ENODATA;
+		return -1;
+	}
+
+	if (entry->hdr.ret < 0) {
+		errno = -entry->hdr.ret;
+		return -1;
+	}
+
+	n = entry->hdr.len < len ? entry->hdr.len : len;
+	memcpy(buf, entry->payload, n);
+	kio_rewrite_seq(fd, buf, n);
+
+	return (flags & MSG_TRUNC) ? entry->hdr.ret : n;
+}
+
+static size_t
+kio_ioctl_key(unsigned long request, void* arg, void* out, char* key)
+{
+	const struct ifreq* ifr = arg;
+	size_t              len;
+
+	if (request == SIOCGIFCONF) {
+		return 0;
+	}
+
+	len = strnlen(ifr->ifr_name, IFNAMSIZ);
+	memcpy(key, ifr->ifr_name, len);
+
+	/**
+	 * Requests that carry a command structure (e.g., SIOCETHTOOL) are
+	 * told apart by the command number that starts it.
+	 */
+	if (out != arg && out != NULL) {
+		uint32_t cmd;
+
+		memcpy(&cmd, out, sizeof(cmd));
+		len += snprintf(key + len, KIO_KEY_MAX - len, ":%u", cmd);
+	}
+
+	return len;
+}
+
+static int
+kio_ioctl_record(int           fd,
+                 unsigned long request,
+                 void*         arg,
+                 void*         out,
+                 size_t        out_len)
+{
+	char   key[KIO_KEY_MAX];
+	size_t key_len = kio_ioctl_key(request, arg, out, key);
+	int    ret     = ioctl(fd, request, arg);
+	int    err     = errno;
+
+	if (ret == -1) {
+		kio_record_entry(
+		  KIO_IOCTL, request, key, key_len, -err, NULL, 0);
+	} else if (request == SIOCGIFCONF) {
+		struct ifconf* conf = arg;
+		size_t         len  = conf->ifc_buf != NULL ? conf->ifc_len : 0;
+		char*          payload = malloc(sizeof(conf->ifc_len) + len);
+
+		if (payload != NULL) {
+			memcpy(payload, &conf->ifc_len, sizeof(conf->ifc_len));
+			memcpy(
+			  payload + sizeof(conf->ifc_len), conf->ifc_buf, len);
+			kio_record_entry(KIO_IOCTL,
+			                 request,
+			                 key,
+			                 key_len,
+			                 ret,
+			                 payload,
+			                 sizeof(conf->ifc_len) + len);
+			free(payload);
+		}
+	} else {
+		kio_record_entry(
+		  KIO_IOCTL, request, key, key_len, ret, out, out_len);
+	}
+
+	errno = err;
+	return ret;
+}
+
+static int
+kio_ioctl_answer(int           fd,
+                 unsigned long request,
+                 void*         arg,
+                 void*         out,
+                 size_t        out_len)
+{
+	const struct kio_entry* entry;
+	char                    key[KIO_KEY_MAX];
+	size_t                  key_len;
+
+	if (kio.mode == KIO_MODE_LIVE) {
+		return ioctl(fd, request, arg);
+	}
+
+	if (kio.mode == KIO_MODE_RECORD) {
+		return kio_ioctl_record(fd, request, arg, out, out_len);
+	}
+
+	key_len = kio_ioctl_key(request, arg, out, key);
+	entry   = kio_take(KIO_IOCTL, request, key, key_len, 1);
+	if (entry == NULL) {
+		errno = ENODATA;
+		return -1;
+	}
+
+	if (entry->hdr.ret < 0) {
+		errno = -entry->hdr.ret;
+		return -1;
+	}
+
+	if (request == SIOCGIFCONF) {
+		struct ifconf* conf = arg;
+		int            len;
+
+		if (entry->hdr.len < sizeof(len)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		memcpy(&len, entry->payload, sizeof(len));
+
+		/**
+		 * Like the kernel, only hand out whole entries that fit.
+		 */
+		if (conf->ifc_buf != NULL) {
+			size_t fits = conf->ifc_len < len ? conf->ifc_len : len;
+
+			fits -= fits % sizeof(struct ifreq);
+			if (fits > entry->hdr.len - sizeof(len)) {
+				fits = entry->hdr.len - sizeof(len);
+			}
+			memcpy(
+			  conf->ifc_buf, entry->payload + sizeof(len), fits);
+			len = fits;
+		}
+
+		conf->ifc_len = len;
+	} else {
+		memcpy(out,
+		       entry->payload,
+		       entry->hdr.len < out_len ? entry->hdr.len : out_len);
+	}
+
+	return entry->hdr.ret;
+}
+
+ssize_t
+kio_recv(int fd, void* buf, size_t len, int flags)
+{
+	ssize_t n = kio_recv_answer(fd, buf, len, flags);
+
+	stats_syscall(n > 0 ? (size_t)n : 0);
+	return n;
+}
+
+int
+kio_ioctl(int fd, unsigned long request, void* arg, void* out, size_t out_len)
+{
+	int ret = kio_ioctl_answer(fd, request, arg, out, out_len);
+
+	if (ret != -1 && request == SIOCGIFCONF) {
+		out_len = ((struct ifconf*)arg)->ifc_buf != NULL
+		            ? ((struct ifconf*)arg)->ifc_len
+		            : 0;
+	}
+
+	stats_syscall(ret != -1 ? out_len : 0);
+	return ret;
+}
+
+struct if_nameindex*
+kio_if_nameindex(void)
+{
+	const struct kio_entry* entry;
+	struct if_nameindex*    ifaces;
+	size_t                  count = 0;
+	size_t                  off;
+
+	/**
+	 * A netlink dump under the hood, charged as a single request.
+	 */
+	stats_syscall(0);
+
+	if (kio.mode == KIO_MODE_LIVE) {
+		return if_nameindex();
+	}
+
+	if (kio.mode == KIO_MODE_RECORD) {
+		size_t len = 0;
+		char*  payload;
+
+		ifaces = if_nameindex();
+		if (ifaces == NULL) {
+			kio_record_entry(
+			  KIO_NAMEINDEX, 0, "", 0, -errno, NULL, 0);
+			return NULL;
+		}
+
+		/**
+		 * Serialized as { u32 index, u32 length, name[length] }*.
+		 */
+		for (size_t i = 0; ifaces[i].if_index != 0; i++) {
+			len += 2 * sizeof(uint32_t) + strlen(ifaces[i].if_name);
+		}
+
+		payload = malloc(len ? len : 1);
+		if (payload == NULL) {
+			return ifaces;
+		}
+
+		off = 0;
+		for (size_t i = 0; ifaces[i].if_index != 0; i++) {
+			uint32_t index    = ifaces[i].if_index;
+			uint32_t name_len = strlen(ifaces[i].if_name);
+
+			memcpy(payload + off, &index, sizeof(index));
+			memcpy(payload + off + 4, &name_len, sizeof(name_len));
+			memcpy(payload + off + 8, ifaces[i].if_name, name_len);
+			off += 8 + name_len;
+		}
+
+		kio_record_entry(KIO_NAMEINDEX, 0, "", 0, 0, payload, len);
+		free(payload);
+		return ifaces;
+	}
+
+	entry = kio_take(KIO_NAMEINDEX, 0, "", 0, 1);
+	if (entry == NULL) {
+		errno = ENODATA;
+		return NULL;
+	}
+
+	if (entry->hdr.ret < 0) {
+		errno = -entry->hdr.ret;
+		return NULL;
+	}
+
+	/**
+	 * A truncated or corrupt entry must not have names read past its
+	 * end.
+	 */
+	for (off = 0; off < entry->hdr.len; count++) {
+		uint32_t name_len;
+
+		if (off + 8 > entry->hdr.len) {
+			errno = EINVAL;
+			return NULL;
+		}
+
+		memcpy(&name_len, entry->payload + off + 4, sizeof(name_len));
+		if (off + 8 + name_len > entry->hdr.len) {
+			errno = EINVAL;
+			return NULL;
+		}
+
+		off += 8 + name_len;
+	}
+
+	/**
+	 * Allocated the way glibc does, so that `if_freenameindex` works.
+	 */
+	ifaces = calloc(count + 1, sizeof(*ifaces));
+	if (ifaces == NULL) {
+		return NULL;
+	}
+
+	off = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t index;
+		uint32_t name_len;
+
+		memcpy(&index, entry->payload + off, sizeof(index));
+		memcpy(&name_len, entry->payload + off + 4, sizeof(name_len));
+		ifaces[i].if_index = index;
+		ifaces[i].if_name = strndup(entry->payload + off + 8, name_len);
+		off += 8 + name_len;
+	}
+
+	return ifaces;
+}
+
+static int
+kio_compare_index(const void* a, const void* b)
+{
+	const struct if_nameindex* x = a;
+	const struct if_nameindex* y = b;
+
+	return x->if_index < y->if_index ? -1 : x->if_index > y->if_index;
+}
+
+struct if_nameindex*
+kio_if_nameindex_sorted(size_t* count)
+{
+	struct if_nameindex* ifaces = kio_if_nameindex();
+
+	*count = 0;
+	if (ifaces == NULL) {
+		return NULL;
+	}
+
+	while (ifaces[*count].if_index != 0) {
+		(*count)++;
+	}
+
+	qsort(ifaces, *count, sizeof(*ifaces), kio_compare_index);
+	return ifaces;
+}
+
+const char*
+kio_if_name(const struct if_nameindex* ifaces, size_t count, uint32_t ifindex)
+{
+	struct if_nameindex        key = { .if_index = ifindex };
+	const struct if_nameindex* found;
+
+	if (ifaces == NULL) {
+		return NULL;
+	}
+
+	found =
+	  bsearch(&key, ifaces, count, sizeof(*ifaces), kio_compare_index);
+	return found != NULL ? found->if_name : NULL;
+}
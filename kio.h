@@ -0,0 +1,138 @@
+#ifndef IFACER__KIO_H
+#define IFACER__KIO_H
+
+/**
+ * kio - the single place through which ifacer talks to the kernel
+ *       (`ioctl(2)`s and netlink sockets).
+ *
+ * Funnelling every request through here allows us to:
+ *
+ *   - record: every answer the kernel gives is appended to a capture file
+ *     (`--record=FILE`); and
+ *   - replay: answers are taken from a capture file instead of the kernel
+ *     (`--replay=FILE`), so that the parsing and output stages can be
+ *     exercised (and profiled) deterministically, without privileges and
+ *     without a host that has the interface layout of interest.
+ *
+ * A capture is a sequence of records, each holding the kind of call, the
+ * request code (or netlink protocol), a key that identifies what the call
+ * was about (the interface name for ioctls, the protocol and groups of the
+ * socket for netlink) and the raw bytes the kernel wrote back.
+ *
+ * Replay matches calls to records by kind, request and key, in the order
+ * they were recorded. This keeps working when requests for different keys
+ * are issued in a different order (e.g., by a thread pool), but requires
+ * requests with the same key to be issued in the same order.
+ *
+ * Netlink sequence numbers of replayed messages are rewritten to the ones
+ * of the requests being answered, so captures don't depend on how many
+ * requests were made before.
+ *
+ * Calls without a matching record fail with ENODATA. Reads from sysfs and
+ * procfs are not captured.
+ *
+ * ENODATA is never returned by the kernel for these calls, so only a
+ * replay runs out of data: long-running modes (watching, sampling) take
+ * it as the end of the capture and stop successfully.
+ *
+ * Capture file layout (host byte order):
+ *
+ *      "IFACERC1"
+ *      { struct kio_hdr, key[key_len], payload[len] }*
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+struct if_nameindex;
+
+enum kio_kind {
+	KIO_IOCTL = 1,
+	KIO_RECV,
+	KIO_NAMEINDEX,
+};
+
+struct kio_hdr {
+	uint32_t kind;
+	uint32_t key_len;
+	uint64_t request;
+	int64_t  ret;
+	uint64_t len;
+};
+
+/**
+ * Starts recording every answer from the kernel to `path`. The capture is
+ * flushed at exit.
+ */
+int
+kio_record(const char* path);
+
+/**
+ * Starts answering every request with the records in `path` instead of
+ * going to the kernel.
+ */
+int
+kio_replay(const char* path);
+
+/**
+ * Writes to `path` a synthetic capture of a host with `count` interfaces,
+ * each one with an IPv4 address, as seen by the default listing
+ * (SIOCGIFCONF + SIOCGIFADDR). Useful for profiling at scales that no dev
+ * machine has.
+ */
+int
+kio_synthesize(const char* path, size_t count);
+
+int
+kio_socket(int domain, int type, int protocol);
+
+int
+kio_bind(int fd, const struct sockaddr* addr, socklen_t len);
+
+ssize_t
+kio_sendto(int                    fd,
+           const void*            buf,
+           size_t                 len,
+           int                    flags,
+           const struct sockaddr* addr,
+           socklen_t              addr_len);
+
+ssize_t
+kio_recv(int fd, void* buf, size_t len, int flags);
+
+/**
+ * Issues `ioctl(fd, request, arg)`, where `out` (of `out_len` bytes) is the
+ * memory that the kernel writes the answer to: `arg` itself for plain
+ * `struct ifreq` requests, `ifr_data` for SIOCETHTOOL.
+ *
+ * SIOCGIFCONF is understood natively (`arg` is the `struct ifconf`; `out`
+ * is ignored).
+ */
+int
+kio_ioctl(int fd, unsigned long request, void* arg, void* out, size_t out_len);
+
+/**
+ * Same as `if_nameindex(3)` (which talks netlink behind our back); free
+ * with `if_freenameindex(3)`.
+ */
+struct if_nameindex*
+kio_if_nameindex(void);
+
+/**
+ * Same as `kio_if_nameindex`, with the interfaces sorted by index (and
+ * `*count` set to how many there are) so that `kio_if_name` can look them
+ * up. Returns NULL if they can't be retrieved.
+ */
+struct if_nameindex*
+kio_if_nameindex_sorted(size_t* count);
+
+/**
+ * The name of the interface `ifindex` among `ifaces` (from
+ * `kio_if_nameindex_sorted`, possibly NULL), or NULL if it isn't there.
+ */
+const char*
+kio_if_name(const struct if_nameindex* ifaces, size_t count, uint32_t ifindex);
+
+#endif
@@ -0,0 +1,648 @@
+#define _GNU_SOURCE
+#include "./locality.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct locality_irq {
+	unsigned irq;
+	char     name[64];
+};
+
+struct locality {
+	int                  net_fd;
+	int                  irq_fd;
+	struct locality_irq* irqs;
+	size_t               n_irqs;
+	int                  cpu_node[CPU_SETSIZE];
+};
+
+/**
+ * Reads the (small) file at `path` relative to `dirfd` into `buf`, stripping
+ * the trailing newline.
+ *
+ * Returns the number of bytes read or -1.
+ */
+static ssize_t
+read_at(int dirfd, const char* path, char* buf, size_t len)
+{
+	ssize_t n;
+	int     fd;
+
+	fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n == -1) {
+		return -1;
+	}
+
+	while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) {
+		n--;
+	}
+	buf[n] = '\0';
+
+	return n;
+}
+
+/**
+ * Reads a whole file of unknown size (e.g., `/proc/interrupts`, which grows
+ * with the number of CPUs and IRQs).
+ */
+static char*
+read_all(const char* path)
+{
+	size_t cap = 16384;
+	size_t len = 0;
+	char*  buf = malloc(cap);
+	int    fd;
+
+	if (buf == NULL) {
+		return NULL;
+	}
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		free(buf);
+		return NULL;
+	}
+
+	for (;;) {
+		ssize_t n;
+
+		if (len + 1 == cap) {
+			char* bigger = realloc(buf, cap * 2);
+
+			if (bigger == NULL) {
+				break;
+			}
+			buf = bigger;
+			cap *= 2;
+		}
+
+		n = read(fd, buf + len, cap - len - 1);
+		if (n <= 0) {
+			break;
+		}
+		len += n;
+	}
+
+	close(fd);
+	buf[len] = '\0';
+	return buf;
+}
+
+/**
+ * Parses a CPU list in the `0-3,8,10-11` format.
+ */
+static void
+parse_cpulist(const char* str, cpu_set_t* set)
+{
+	CPU_ZERO(set);
+
+	while (*str != '\0') {
+		char*         end;
+		unsigned long first = strtoul(str, &end, 10);
+		unsigned long last  = first;
+
+		if (end == str) {
+			break;
+		}
+
+		if (*end == '-') {
+			str  = end + 1;
+			last = strtoul(str, &end, 10);
+		}
+
+		for (unsigned long cpu = first;
+		     cpu <= last && cpu < CPU_SETSIZE;
+		     cpu++) {
+			CPU_SET(cpu, set);
+		}
+
+		str = *end == ',' ? end + 1 : end;
+		if (*end != ',') {
+			break;
+		}
+	}
+}
+
+/**
+ * Parses a CPU mask in the `00000000,0000000f` format (32-bit hex words
+ * separated by commas, most significant first).
+ */
+static void
+parse_cpumask(const char* str, cpu_set_t* set)
+{
+	size_t   len = strlen(str);
+	unsigned bit = 0;
+
+	CPU_ZERO(set);
+
+	while (len-- > 0) {
+		int digit;
+
+		if (str[len] == ',') {
+			continue;
+		}
+
+		if (!isxdigit((unsigned char)str[len])) {
+			break;
+		}
+
+		digit = isdigit((unsigned char)str[len])
+		          ? str[len] - '0'
+		          : tolower((unsigned char)str[len]) - 'a' + 10;
+
+		for (int i = 0; i < 4; i++, bit++) {
+			if ((digit & (1 << i)) && bit < CPU_SETSIZE) {
+				CPU_SET(bit, set);
+			}
+		}
+	}
+}
+
+/**
+ * Formats a set back into the list format, or `none` if empty.
+ */
+static const char*
+format_cpulist(const cpu_set_t* set, char* buf, size_t len)
+{
+	size_t off = 0;
+
+	buf[0] = '\0';
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		int last = cpu;
+
+		if (!CPU_ISSET(cpu, set)) {
+			continue;
+		}
+
+		while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) {
+			last++;
+		}
+
+		if (off < len) {
+			off += snprintf(buf + off,
+			                len - off,
+			                last == cpu ? "%s%d" : "%s%d-%d",
+			                off ? "," : "",
+			                cpu,
+			                last);
+		}
+
+		cpu = last;
+	}
+
+	if (off == 0) {
+		snprintf(buf, len, "none");
+	}
+
+	return buf;
+}
+
+static int
+locality_irq_cmp(const void* a, const void* b)
+{
+	const struct locality_irq* x = a;
+	const struct locality_irq* y = b;
+
+	return (x->irq > y->irq) - (x->irq < y->irq);
+}
+
+/**
+ * Parses `/proc/interrupts`, keeping only the IRQ number and the name of
+ * the action (the last column) of each numbered line.
+ */
+static void
+locality_load_interrupts(struct locality* locality)
+{
+	char* text = read_all("/proc/interrupts");
+	char* line;
+	char* saveptr = NULL;
+
+	if (text == NULL) {
+		return;
+	}
+
+	for (line = strtok_r(text, "\n", &saveptr); line != NULL;
+	     line = strtok_r(NULL, "\n", &saveptr)) {
+		struct locality_irq* irq;
+		char*                end;
+		char*                name;
+		unsigned long        number;
+
+		line += strspn(line, " ");
+		number = strtoul(line, &end, 10);
+		if (end == line || *end != ':') {
+			continue;
+		}
+
+		name = strrchr(end, ' ');
+		if (name == NULL) {
+			continue;
+		}
+
+		irq = realloc(locality->irqs,
+		              (locality->n_irqs + 1) * sizeof(*locality->irqs));
+		if (irq == NULL) {
+			break;
+		}
+
+		locality->irqs = irq;
+		irq            = &locality->irqs[locality->n_irqs++];
+		irq->irq       = number;
+		snprintf(irq->name, sizeof(irq->name), "%s", name + 1);
+	}
+
+	free(text);
+
+	qsort(locality->irqs,
+	      locality->n_irqs,
+	      sizeof(*locality->irqs),
+	      locality_irq_cmp);
+}
+
+/**
+ * Builds the CPU to NUMA node map out of `/sys/devices/system/node/node*`.
+ */
+static void
+locality_load_nodes(struct locality* locality)
+{
+	struct dirent* entry;
+	DIR*           dir;
+	int            fd;
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		locality->cpu_node[cpu] = -1;
+	}
+
+	fd =
+	  open("/sys/devices/system/node", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		return;
+	}
+
+	dir = fdopendir(fd);
+	if (dir == NULL) {
+		close(fd);
+		return;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		char      path[NAME_MAX + sizeof("/cpulist")];
+		char      list[4096];
+		cpu_set_t cpus;
+		int       node;
+
+		if (sscanf(entry->d_name, "node%d", &node) != 1) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/cpulist", entry->d_name);
+		if (read_at(dirfd(dir), path, list, sizeof(list)) == -1) {
+			continue;
+		}
+
+		parse_cpulist(list, &cpus);
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &cpus)) {
+				locality->cpu_node[cpu] = node;
+			}
+		}
+	}
+
+	closedir(dir);
+}
+
+struct locality*
+locality_load(void)
+{
+	struct locality* locality = calloc(1, sizeof(*locality));
+
+	if (locality == NULL) {
+		return NULL;
+	}
+
+	locality->net_fd =
+	  open("/sys/class/net", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (locality->net_fd == -1) {
+		free(locality);
+		return NULL;
+	}
+
+	locality->irq_fd =
+	  open("/proc/irq", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	locality_load_interrupts(locality);
+	locality_load_nodes(locality);
+
+	return locality;
+}
+
+void
+locality_free(struct locality* locality)
+{
+	if (locality == NULL) {
+		return;
+	}
+
+	close(locality->net_fd);
+	if (locality->irq_fd != -1) {
+		close(locality->irq_fd);
+	}
+	free(locality->irqs);
+	free(locality);
+}
+
+/**
+ * Infers the queue an IRQ serves from the number that ends its name
+ * (`eth0-TxRx-3`, `virtio3-input.0`, `mlx5_comp3@pci:...`).
+ *
+ * Returns -1 for IRQs that don't look like per-queue ones.
+ */
+static int
+irq_queue(const char* name)
+{
+	const char* end   = strchrnul(name, '@');
+	const char* start = end;
+
+	while (start > name && isdigit((unsigned char)start[-1])) {
+		start--;
+	}
+
+	if (start == end || start == name) {
+		return -1;
+	}
+
+	return atoi(start);
+}
+
+static int
+unsigned_cmp(const void* a, const void* b)
+{
+	unsigned x = *(const unsigned*)a;
+	unsigned y = *(const unsigned*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Collects the IRQs of the bus device: the MSI(-X) vectors, or the legacy
+ * line when the device doesn't use MSI.
+ */
+static size_t
+device_irqs(int bus_fd, unsigned** irqs)
+{
+	struct dirent* entry;
+	size_t         count = 0;
+	DIR*           dir;
+	int            fd;
+
+	*irqs = NULL;
+
+	fd = openat(bus_fd, "msi_irqs", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd != -1 && (dir = fdopendir(fd)) != NULL) {
+		while ((entry = readdir(dir)) != NULL) {
+			unsigned* more;
+
+			if (!isdigit((unsigned char)entry->d_name[0])) {
+				continue;
+			}
+
+			more = realloc(*irqs, (count + 1) * sizeof(**irqs));
+			if (more == NULL) {
+				break;
+			}
+
+			*irqs            = more;
+			(*irqs)[count++] = strtoul(entry->d_name, NULL, 10);
+		}
+		closedir(dir);
+	} else if (fd != -1) {
+		close(fd);
+	}
+
+	if (count == 0) {
+		char buf[32];
+
+		if (read_at(bus_fd, "irq", buf, sizeof(buf)) > 0 &&
+		    atoi(buf) > 0 && (*irqs = malloc(sizeof(**irqs))) != NULL) {
+			(*irqs)[count++] = strtoul(buf, NULL, 10);
+		}
+	}
+
+	qsort(*irqs, count, sizeof(**irqs), unsigned_cmp);
+	return count;
+}
+
+static void
+locality_print_irqs(struct locality* locality, int bus_fd, int numa_node)
+{
+	unsigned* irqs;
+	size_t    count = device_irqs(bus_fd, &irqs);
+
+	for (size_t i = 0; i < count; i++) {
+		struct locality_irq  key  = { .irq = irqs[i] };
+		struct locality_irq* irq  = NULL;
+		const char*          name = "?";
+		char                 path[64];
+		char                 list[4096];
+		char                 buf[4096];
+		cpu_set_t            cpus;
+		cpu_set_t            nodes;
+		int                  remote = 0;
+		int                  queue  = -1;
+
+		if (locality->n_irqs > 0) {
+			irq = bsearch(&key,
+			              locality->irqs,
+			              locality->n_irqs,
+			              sizeof(*locality->irqs),
+			              locality_irq_cmp);
+		}
+		if (irq != NULL) {
+			name  = irq->name;
+			queue = irq_queue(irq->name);
+		}
+
+		/**
+		 * The effective affinity tells where the IRQ is actually
+		 * delivered; smp_affinity only tells where it may be.
+		 */
+		snprintf(
+		  path, sizeof(path), "%u/effective_affinity_list", irqs[i]);
+		if (read_at(locality->irq_fd, path, list, sizeof(list)) <= 0) {
+			snprintf(
+			  path, sizeof(path), "%u/smp_affinity_list", irqs[i]);
+			if (read_at(
+			      locality->irq_fd, path, list, sizeof(list)) <=
+			    0) {
+				list[0] = '\0';
+			}
+		}
+
+		parse_cpulist(list, &cpus);
+		CPU_ZERO(&nodes);
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			int node = locality->cpu_node[cpu];
+
+			if (!CPU_ISSET(cpu, &cpus) || node < 0) {
+				continue;
+			}
+
+			CPU_SET(node, &nodes);
+			if (numa_node >= 0 && node != numa_node) {
+				remote = 1;
+			}
+		}
+
+		printf("irq: %u name=%s", irqs[i], name);
+		if (queue >= 0) {
+			printf(" queue=%d", queue);
+		}
+		printf(" cpus=%s", format_cpulist(&cpus, buf, sizeof(buf)));
+		printf(" nodes=%s", format_cpulist(&nodes, buf, sizeof(buf)));
+		printf("%s\n", remote ? " remote" : "");
+	}
+
+	free(irqs);
+}
+
+/**
+ * Orders queues as `rx-0, rx-1, ..., rx-10, tx-0, ...`.
+ */
+static int
+queue_cmp(const void* a, const void* b)
+{
+	const char* x   = *(char* const*)a;
+	const char* y   = *(char* const*)b;
+	int         dir = strncmp(x, y, 3);
+
+	if (dir != 0) {
+		return dir;
+	}
+
+	return atoi(x + 3) - atoi(y + 3);
+}
+
+static void
+locality_print_queues(int dev_fd)
+{
+	struct dirent* entry;
+	char**         queues = NULL;
+	size_t         count  = 0;
+	DIR*           dir;
+	int            fd;
+
+	fd = openat(dev_fd, "queues", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		return;
+	}
+
+	dir = fdopendir(fd);
+	if (dir == NULL) {
+		close(fd);
+		return;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		char** more;
+
+		if (strncmp(entry->d_name, "rx-", 3) &&
+		    strncmp(entry->d_name, "tx-", 3)) {
+			continue;
+		}
+
+		more = realloc(queues, (count + 1) * sizeof(*queues));
+		if (more == NULL) {
+			break;
+		}
+
+		queues = more;
+		if ((queues[count] = strdup(entry->d_name)) != NULL) {
+			count++;
+		}
+	}
+
+	qsort(queues, count, sizeof(*queues), queue_cmp);
+
+	for (size_t i = 0; i < count; i++) {
+		const char* file =
+		  queues[i][0] == 'r' ? "rps_cpus" : "xps_cpus";
+		char      path[NAME_MAX + 16];
+		char      mask[1024];
+		char      list[4096];
+		cpu_set_t cpus;
+
+		snprintf(path, sizeof(path), "queues/%s/%s", queues[i], file);
+		if (read_at(dev_fd, path, mask, sizeof(mask)) == -1) {
+			continue;
+		}
+
+		parse_cpumask(mask, &cpus);
+		printf("queue: %s %s=%s\n",
+		       queues[i],
+		       file,
+		       format_cpulist(&cpus, list, sizeof(list)));
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		free(queues[i]);
+	}
+	free(queues);
+	closedir(dir);
+}
+
+void
+locality_print(struct locality* locality, const char* name)
+{
+	char numa[16];
+	int  numa_node = -1;
+	int  dev_fd;
+	int  bus_fd;
+
+	dev_fd =
+	  openat(locality->net_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dev_fd == -1) {
+		return;
+	}
+
+	/**
+	 * For most NICs `device` is the PCI function itself, but some
+	 * buses (e.g., virtio) put a device of their own in between, in
+	 * which case the IRQs and the NUMA node belong to its parent.
+	 */
+	if (faccessat(dev_fd, "device/msi_irqs", F_OK, 0) == 0 ||
+	    faccessat(dev_fd, "device/numa_node", F_OK, 0) == 0) {
+		bus_fd =
+		  openat(dev_fd, "device", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	} else {
+		bus_fd = openat(
+		  dev_fd, "device/..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	}
+
+	if (bus_fd != -1) {
+		if (read_at(bus_fd, "numa_node", numa, sizeof(numa)) > 0) {
+			numa_node = atoi(numa);
+		}
+
+		printf("numa_node: %d\n", numa_node);
+		locality_print_irqs(locality, bus_fd, numa_node);
+		close(bus_fd);
+	}
+
+	locality_print_queues(dev_fd);
+	close(dev_fd);
+}
@@ -0,0 +1,49 @@
+#ifndef IFACER__LOCALITY_H
+#define IFACER__LOCALITY_H
+
+/**
+ * locality - tells where (in terms of CPUs and NUMA nodes) the work of each
+ *            interface happens.
+ *
+ * For each interface we gather:
+ *
+ *   - the NUMA node of the device backing it (`device/numa_node`);
+ *   - the IRQs of the device (`msi_irqs/`, or the legacy `irq`), their
+ *     names (from `/proc/interrupts`), the queue each one serves (inferred
+ *     from the trailing number in the name, e.g. `eth0-TxRx-3`) and the
+ *     CPUs they're delivered to (`/proc/irq/<n>/effective_affinity_list`,
+ *     falling back to `smp_affinity_list`); and
+ *   - the RPS (`queues/rx-N/rps_cpus`) and XPS (`queues/tx-N/xps_cpus`)
+ *     masks of each queue.
+ *
+ * IRQs delivered to CPUs outside of the device's NUMA node are flagged as
+ * `remote`, as every packet they handle crosses the interconnect.
+ *
+ * `/proc/interrupts` is parsed once per run, and every other file is read
+ * relative to directory descriptors opened once (`/sys/class/net`,
+ * `/proc/irq`, ...) so that we don't pay for resolving the same path
+ * prefixes over and over.
+ */
+
+struct locality;
+
+/**
+ * Opens the directories and parses `/proc/interrupts` and the CPU to NUMA
+ * node mapping.
+ *
+ * Returns NULL (with errno set) if `/sys/class/net` can't be opened;
+ * missing `/proc` entries only make the report less complete.
+ */
+struct locality*
+locality_load(void);
+
+/**
+ * Prints the locality information of the interface `name` to stdout.
+ */
+void
+locality_print(struct locality* locality, const char* name);
+
+void
+locality_free(struct locality* locality);
+
+#endif
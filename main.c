@@ -31,58 +31,244 @@
  * devices configuration (here you can know more about the structs mentioned and
  * the request codes used).
  *
+ * The list can hold any number of interfaces: we first ask the kernel how big
+ * the answer is going to be (SIOCGIFCONF with a NULL buffer) and size the
+ * buffer accordingly.
+ *
+ * With `--locality`, the listing also tells the NUMA node, IRQs and RPS/XPS
+ * masks of each interface (see `locality.h`).
+ *
+ * With `--all-netns`, interfaces of every named network namespace are
+ * listed too (see `netns.h`). Addresses are gathered in a compact
+ * inventory (interned names, one array per field, identical records
+ * stored once, see `inventory.h`) before being printed, so that
+ * fleet-scale listings stay small; namespaces identical to an earlier one
+ * are printed as `same-as` it.
+ *
+ * Besides the listing above (the default mode), ifacer can be asked to
+ * retrieve other kinds of information about the interfaces, each living in
+ * its own module:
+ *
+ *   - --ethtool-stats          : driver statistics via SIOCETHTOOL (see
+ *                                `ethtool.h`);
+ *   - --audit                  : NIC tuning (offloads, rings, channels,
+ *                                coalescing, speed) checked against a
+ *                                baseline (see `audit.h`);
+ *   - --exporter               : Prometheus `/metrics` endpoint with the
+ *                                inventory and counters (see `exporter.h`);
+ *   - --watch                  : links and addresses, then every change to
+ *                                them (see `watch.h`, built on the
+ *                                non-blocking library API in `ifacer.h`);
+ *   - --watch-netns            : the same, for every network namespace as
+ *                                they come and go (see `nswatch.h`);
+ *   - --top                    : the busiest interfaces, refreshed live
+ *                                (see `top.h`);
+ *   - --has-addr               : whether an address is assigned, as an exit
+ *                                status (see `hasaddr.h`);
+ *   - --sockets                : TCP/UDP socket counts per local address
+ *                                and state (see `sockdiag.h`);
+ *   - --qdiscs                 : qdisc and class counters (backlog, drops,
+ *                                ...), once or sampled (see `qdisc.h`);
+ *   - --vfs                    : SR-IOV virtual functions, their settings
+ *                                and counters (see `sriov.h`);
+ *   - --fdb / --lookup-mac     : bridge forwarding entries per port, or
+ *                                where MAC addresses are (see `fdb.h`); and
+ *   - --series / --query       : a compressed on-disk history of the
+ *                                interface counters (see `series.h`).
+ *
+ * With `--splice`, when stdout is a pipe, the listing and `--query` hand
+ * their output over to it with `vmsplice(2)` instead of copying it (see
+ * `output.h`).
+ *
+ * Any mode can be run with `--stats` to learn where its time goes (see
+ * `stats.h`).
+ *
  * To compile the code:
  *
- *      gcc -O2 ./main.c -o ifacer
+ *      make
  *
  *
  * To run:
  *
- *      ./ifacer
+ *      ./main.out [options]
  */
 
+#include "./audit.h"
+#include "./ethtool.h"
+#include "./exporter.h"
+#include "./fdb.h"
+#include "./hasaddr.h"
+#include "./interrupt.h"
+#include "./inventory.h"
+#include "./kio.h"
+#include "./locality.h"
+#include "./netns.h"
+#include "./nswatch.h"
+#include "./output.h"
+#include "./probes.h"
+#include "./qdisc.h"
+#include "./series.h"
+#include "./sockdiag.h"
+#include "./sriov.h"
+#include "./stats.h"
+#include "./top.h"
+#include "./watch.h"
+
 #include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
 #include <linux/if.h>
 #include <netinet/in.h>
 #include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
-#define MAX_INTERFACES 128
+static const char* usage =
+  "Usage: ifacer [options]\n"
+  "\n"
+  "Lists the interfaces that have an IPv4 address assigned.\n"
+  "\n"
+  "Options:\n"
+  "  --locality            include NUMA, IRQ and RPS/XPS placement\n"
+  "  --all-netns           also list every named network namespace\n"
+  "  --ethtool-stats       print driver statistics of every interface\n"
+  "  --timeout=MS          per-interface deadline for ethtool queries\n"
+  "  --jobs=N              number of concurrent ethtool queries\n"
+  "  --audit[=BASELINE]    audit the tuning of physical NICs\n"
+  "  --exporter[=ADDR]     serve Prometheus metrics on ADDR\n"
+  "  --watch               print links and addresses, then their changes\n"
+  "  --watch-netns         the same, for every network namespace\n"
+  "  --max-netns=N         with --watch-netns, watch up to N namespaces\n"
+  "                        (default 1024)\n"
+  "  --top[=ROWS]          show the busiest interfaces, refreshed every\n"
+  "                        interval\n"
+  "  --sort=KEY            order of --top: rx, tx, drops or errors\n"
+  "  --has-addr=ADDR       exit with 0 if ADDR is assigned locally, 3 if not\n"
+  "  --wait[=MS]           with --has-addr, wait for ADDR (for up to MS)\n"
+  "  --sockets             count TCP/UDP sockets per local address\n"
+  "  --states=LIST         with --sockets, only these states (e.g.,\n"
+  "                        established,time-wait)\n"
+  "  --qdiscs              print qdisc and class counters; with\n"
+  "                        --interval, every interval the ones that\n"
+  "                        queued or dropped\n"
+  "  --vfs                 print the SR-IOV virtual functions of every\n"
+  "                        physical function\n"
+  "  --fdb                 count bridge forwarding entries per port\n"
+  "  --lookup-mac=LIST     print the forwarding entries of the MAC\n"
+  "                        addresses in LIST (comma-separated, or one\n"
+  "                        per line on stdin if -); exit with 3 if one\n"
+  "                        is missing\n"
+  "  --series=FILE         sample counters into FILE until interrupted\n"
+  "  --interval=MS         time between samples or refreshes (default\n"
+  "                        1000)\n"
+  "  --query=FILE          print the samples stored in FILE\n"
+  "  --from=SEC, --to=SEC  only samples within that span (epoch seconds)\n"
+  "  --iface=NAME          only samples of interface NAME\n"
+  "  --splice              splice pages into a pipe instead of writing\n"
+  "                        to it (the reader must consume what it reads)\n"
+  "  --record=FILE         record every kernel answer to FILE\n"
+  "  --replay=FILE         answer requests from FILE instead of the kernel\n"
+  "  --synthesize=N        with --record, write a synthetic capture of N\n"
+  "                        interfaces and exit\n"
+  "  --stats[=json]        report time, syscalls and bytes per phase to\n"
+  "                        stderr at exit\n"
+  "  -h, --help            show this help\n";
 
-int
-main()
-{
-	/**
-	 * A zero-initialized structure that holds the configuration
-	 * parameters for the SIOCGIFCONF IOCTL that we issue against
-	 * a socket to retrieve the list of network interfaces that have
-	 * an underlying IP associated with it.
-	 */
-	struct ifconf config = { 0 };
+static const struct option long_options[] = {
+	{ "locality", no_argument, NULL, 'L' },
+	{ "all-netns", no_argument, NULL, 'N' },
+	{ "ethtool-stats", no_argument, NULL, 'E' },
+	{ "timeout", required_argument, NULL, 't' },
+	{ "jobs", required_argument, NULL, 'j' },
+	{ "audit", optional_argument, NULL, 'A' },
+	{ "exporter", optional_argument, NULL, 'X' },
+	{ "watch", no_argument, NULL, 'W' },
+	{ "watch-netns", no_argument, NULL, 'n' },
+	{ "max-netns", required_argument, NULL, 'M' },
+	{ "top", optional_argument, NULL, 'O' },
+	{ "sort", required_argument, NULL, 'o' },
+	{ "has-addr", required_argument, NULL, 'H' },
+	{ "wait", optional_argument, NULL, 'w' },
+	{ "sockets", no_argument, NULL, 'K' },
+	{ "states", required_argument, NULL, 'k' },
+	{ "qdiscs", no_argument, NULL, 'q' },
+	{ "vfs", no_argument, NULL, 'V' },
+	{ "fdb", no_argument, NULL, 'B' },
+	{ "lookup-mac", required_argument, NULL, 'm' },
+	{ "series", required_argument, NULL, 'T' },
+	{ "interval", required_argument, NULL, 'i' },
+	{ "query", required_argument, NULL, 'Q' },
+	{ "from", required_argument, NULL, 'F' },
+	{ "to", required_argument, NULL, 'U' },
+	{ "iface", required_argument, NULL, 'I' },
+	{ "splice", no_argument, NULL, 'Z' },
+	{ "record", required_argument, NULL, 'R' },
+	{ "replay", required_argument, NULL, 'P' },
+	{ "synthesize", required_argument, NULL, 'S' },
+	{ "stats", optional_argument, NULL, 's' },
+	{ "help", no_argument, NULL, 'h' },
+	{ 0 },
+};
+
+enum mode {
+	MODE_LIST = 0,
+	MODE_ETHTOOL_STATS,
+	MODE_AUDIT,
+	MODE_EXPORTER,
+	MODE_WATCH,
+	MODE_WATCH_NETNS,
+	MODE_TOP,
+	MODE_HAS_ADDR,
+	MODE_SOCKETS,
+	MODE_QDISCS,
+	MODE_VFS,
+	MODE_FDB,
+	MODE_SERIES,
+	MODE_QUERY,
+};
+
+/**
+ * The addresses being listed (possibly across namespaces) and the
+ * SIOCGIFCONF buffer, which is reused from one namespace to the next.
+ */
+struct listing {
+	struct inventory inventory;
 
 	/**
 	 * A list that will be filled by Linux to give us back information
 	 * about the interfaces.
 	 */
-	struct ifreq ifreq[MAX_INTERFACES];
+	struct ifreq* ifreq;
+	int           capacity;
 
-	/**
-	 * A temporary buffer for holding the humanized string that
-	 * represents the address assigned to that interface.
-	 */
-	char ip_buffer[16] = { 0 };
+	int err;
+};
 
+/**
+ * Adds the interfaces of the current namespace that have an IPv4 address
+ * assigned to them to the listing using SIOCGIFCONF and SIOCGIFADDR.
+ *
+ * Returns 0, 1 if we ran out of resources or 2 if the kernel refused to
+ * answer.
+ */
+static int
+collect_interfaces(struct listing* listing)
+{
 	/**
-	 * A `sockaddr` address structure casted to the internet form
-	 * `sockaddr_in` as retrieved from `ioctl`.
+	 * A zero-initialized structure that holds the configuration
+	 * parameters for the SIOCGIFCONF IOCTL that we issue against
+	 * a socket to retrieve the list of network interfaces that have
+	 * an underlying IP associated with it.
 	 */
-	struct sockaddr_in* iface_addr;
+	struct ifconf config = { 0 };
 
-	int devices_fd;
-	int number_of_ifaces;
-	int err;
+	struct ifreq* ifreq = listing->ifreq;
+	int           devices_fd;
+	int           number_of_ifaces;
+	int           err;
 
 	/**
 	 * Open a generic stream-based socket to issue the ioctl
@@ -93,22 +279,29 @@ main()
 	 * one that is just like one you'd create for tcp, i.e.,
 	 * AF_INET, SOCK_STREAM (but it doesn't really matter).
 	 */
-	err = (devices_fd = socket(AF_INET, SOCK_STREAM, 0));
+	stats_phase(STATS_PHASE_SOCKET);
+	err = (devices_fd = kio_socket(AF_INET, SOCK_STREAM, 0));
 	if (err == -1) {
 		perror("cannot open socket");
 		return 1;
 	}
 
 	/**
-	 * Fill-in the config request structure, including a buffer to hold
-	 * the answer that's going to be filled by the kernel.
+	 * Without a buffer (`ifc_buf` set to NULL), SIOCGIFCONF tells us in
+	 * `ifc_len` how many bytes the full answer takes.
 	 */
-	config.ifc_buf = (char*)ifreq;
-	config.ifc_len = MAX_INTERFACES * sizeof(struct ifreq);
+	stats_phase(STATS_PHASE_IFCONF);
+	PROBE0(enumerate__start);
+	err = kio_ioctl(devices_fd, SIOCGIFCONF, (char*)&config, NULL, 0);
+	if (err == -1) {
+		perror("ioctl SIOCGIFCONF failed\n");
+		close(devices_fd);
+		return 2;
+	}
 
 	/**
 	 * Issue the actual syscall using the request configuration that we
-	 * filled above (giving an address to a buffer that will hold the
+	 * fill below (giving an address to a buffer that will hold the
 	 * answer and a hint of how big that buffer is).
 	 *
 	 * SIOCGIFCONF returns a list  of interface (transport layer) addresses.
@@ -116,20 +309,47 @@ main()
 	 * There are two problems with using this:
 	 *      1. we can only retrieve IPv4 stuff;
 	 *      2. we can't retrieve non-ip assigned interfaces.
+	 *
+	 * Addresses may be added between the two calls, in which case the
+	 * answer fills the whole buffer and we retry with a bigger one.
 	 */
-	err = ioctl(devices_fd, SIOCGIFCONF, (char*)&config);
-	if (err == -1) {
-		perror("ioctl SIOCGIFCONF failed\n");
-		close(devices_fd);
-		return 2;
+	for (int capacity = config.ifc_len + 4 * sizeof(struct ifreq);;
+	     capacity *= 2) {
+		if (capacity > listing->capacity) {
+			struct ifreq* bigger = realloc(ifreq, capacity);
+
+			if (bigger == NULL) {
+				perror("realloc failed");
+				close(devices_fd);
+				return 1;
+			}
+
+			ifreq = listing->ifreq = bigger;
+			listing->capacity      = capacity;
+		}
+
+		config.ifc_buf = (char*)ifreq;
+		config.ifc_len = capacity;
+
+		err =
+		  kio_ioctl(devices_fd, SIOCGIFCONF, (char*)&config, NULL, 0);
+		if (err == -1) {
+			perror("ioctl SIOCGIFCONF failed\n");
+			close(devices_fd);
+			return 2;
+		}
+
+		if (config.ifc_len < capacity) {
+			break;
+		}
 	}
 
-	/**
-	 * Parse the results and then print the interfaces names.
-	 */
 	number_of_ifaces = config.ifc_len / (sizeof(struct ifreq));
+	PROBE2(enumerate__end, number_of_ifaces, config.ifc_len);
+
+	stats_phase(STATS_PHASE_IFADDR);
 	for (int i = 0; i < number_of_ifaces; i++) {
-		printf("iface: %s\n", ifreq[i].ifr_name);
+		PROBE2(iface__start, i, ifreq[i].ifr_name);
 
 		/**
 		 * Retrieve the address of the specified interface
@@ -138,19 +358,473 @@ main()
 		 * for the call such that we can retrieve the address for
 		 * the right interface.
 		 */
-		err = ioctl(devices_fd, SIOCGIFADDR, (char*)&ifreq[i]);
+		err = kio_ioctl(devices_fd,
+		                SIOCGIFADDR,
+		                (char*)&ifreq[i],
+		                &ifreq[i],
+		                sizeof(ifreq[i]));
 		if (err == -1) {
+			PROBE3(iface__end, i, ifreq[i].ifr_name, errno);
 			perror("ioctl failed\n");
 			close(devices_fd);
 			return 2;
 		}
 
-		iface_addr = (struct sockaddr_in*)(&ifreq[i].ifr_addr);
-		inet_ntop(AF_INET, &iface_addr->sin_addr, ip_buffer, 16);
+		/**
+		 * Only the name (interned) and the address are kept: the
+		 * ifreq buffer is overwritten by the next namespace.
+		 */
+		if (inventory_add_v4(
+		      &listing->inventory,
+		      ifreq[i].ifr_name,
+		      strnlen(ifreq[i].ifr_name, sizeof(ifreq[i].ifr_name)),
+		      &((struct sockaddr_in*)&ifreq[i].ifr_addr)->sin_addr) <
+		    0) {
+			perror("cannot grow inventory");
+			close(devices_fd);
+			return 1;
+		}
 
-		printf("ip: %s\n", ip_buffer);
-		printf("\n");
+		PROBE3(iface__end, i, ifreq[i].ifr_name, 0);
 	}
 
 	close(devices_fd);
+	return 0;
+}
+
+/**
+ * Collects the interfaces of the namespace `name` (we're in it already).
+ */
+static int
+collect_netns(const char* name, void* data)
+{
+	struct listing* listing = data;
+	uint32_t        netns =
+	  inventory_intern(&listing->inventory, name, strlen(name));
+	int err;
+
+	if (netns == STRTAB_NONE ||
+	    inventory_netns_begin(&listing->inventory, netns) < 0) {
+		errno = ENOMEM;
+		perror("cannot grow inventory");
+		return 1;
+	}
+
+	err = collect_interfaces(listing);
+	if (inventory_netns_end(&listing->inventory) < 0) {
+		errno = ENOMEM;
+		perror("cannot grow inventory");
+		return 1;
+	}
+
+	if (err == 1) {
+		return 1;
+	}
+
+	if (err != 0) {
+		listing->err = err;
+	}
+
+	return 0;
+}
+
+/**
+ * Prints every address of the listing. A namespace whose records are
+ * identical to an earlier one's is printed as a reference to it.
+ *
+ * When `locality` is non-NULL, each interface of the namespace we started
+ * in (always the first one) also gets its NUMA, IRQ and RPS/XPS placement
+ * printed (sysfs only describes that namespace's devices).
+ */
+static void
+print_interfaces(const struct listing* listing,
+                 struct locality*      locality,
+                 int                   all_netns)
+{
+	const struct inventory*    inventory = &listing->inventory;
+	const struct inventory_v4* v4        = &inventory->v4;
+
+	/**
+	 * A temporary buffer for holding the humanized string that
+	 * represents the address assigned to that interface.
+	 */
+	char ip_buffer[16] = { 0 };
+
+	stats_phase(STATS_PHASE_OUTPUT);
+	for (size_t n = 0; n < inventory->n_netns; n++) {
+		const struct inventory_netns* netns = &inventory->netns[n];
+		const char* netns_name = inventory_str(inventory, netns->name);
+
+		if (netns->same_as != INVENTORY_UNIQUE) {
+			const struct inventory_netns* same =
+			  &inventory->netns[netns->same_as];
+
+			printf("netns: %s\n", netns_name);
+			printf("same-as: %s\n",
+			       inventory_str(inventory, same->name));
+			printf("\n");
+			continue;
+		}
+
+		for (size_t i = netns->first_ref;
+		     i < netns->first_ref + netns->count_refs;
+		     i++) {
+			uint32_t    r = inventory->refs[i];
+			const char* name =
+			  inventory_str(inventory, v4->name[r]);
+
+			printf("iface: %s\n", name);
+
+			if (all_netns) {
+				printf("netns: %s\n", netns_name);
+			}
+
+			inet_ntop(AF_INET, &v4->addr[r], ip_buffer, 16);
+			printf("ip: %s\n", ip_buffer);
+
+			if (locality != NULL && n == 0) {
+				stats_phase(STATS_PHASE_LOCALITY);
+				locality_print(locality, name);
+				stats_phase(STATS_PHASE_OUTPUT);
+			}
+
+			printf("\n");
+		}
+	}
+}
+
+/**
+ * Lists the interfaces that have an IPv4 address assigned to them, in the
+ * current namespace and, with `all_netns`, in every named one.
+ */
+static int
+list_interfaces(struct locality* locality, int all_netns)
+{
+	struct listing listing = { 0 };
+	int            err;
+
+	err = collect_netns("default", &listing);
+	if (err == 0 && all_netns) {
+		err = netns_for_each(collect_netns, &listing);
+		if (err == -1) {
+			perror("cannot switch network namespace");
+			err = 1;
+		}
+	}
+
+	/**
+	 * Whatever was collected before a failure is still printed.
+	 */
+	print_interfaces(&listing, locality, all_netns);
+
+	if (err == 0) {
+		err = listing.err;
+	}
+
+	free(listing.ifreq);
+	inventory_free(&listing.inventory);
+	return err;
+}
+
+/**
+ * Writes out whatever output is still buffered, between probes that tell
+ * how much of it there was.
+ */
+static void
+flush_output(void)
+{
+	size_t pending = __fpending(stdout) + output_pending();
+
+	stats_phase(STATS_PHASE_OUTPUT);
+	PROBE1(flush__start, pending);
+	fflush(stdout);
+	if (output_close() != 0) {
+		perror("cannot write output");
+	}
+	PROBE1(flush__end, pending);
+}
+
+/**
+ * Whether `mode` runs until interrupted.
+ */
+static int
+long_running(enum mode mode, int interval_ms)
+{
+	switch (mode) {
+		case MODE_EXPORTER:
+		case MODE_WATCH:
+		case MODE_WATCH_NETNS:
+		case MODE_TOP:
+		case MODE_HAS_ADDR:
+		case MODE_SERIES:
+			return 1;
+		case MODE_QDISCS:
+			return interval_ms > 0;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Exit code of a long-running mode that returned `err`: the one a shell
+ * reports for the signal that interrupted it, if one did.
+ */
+static int
+exit_code(int err)
+{
+	int sig = interrupt_signal();
+
+	return sig != 0 ? 128 + sig : err;
+}
+
+int
+main(int argc, char** argv)
+{
+	enum mode   mode          = MODE_LIST;
+	int         timeout_ms    = 0;
+	int         jobs          = 0;
+	const char* baseline      = NULL;
+	const char* address       = NULL;
+	int         top_rows      = 0;
+	const char* sort          = NULL;
+	const char* has_addr      = NULL;
+	int         wait_ms       = 0;
+	int         max_netns     = 0;
+	const char* states        = NULL;
+	const char* macs          = NULL;
+	const char* series        = NULL;
+	int         interval_ms   = 0;
+	const char* iface         = NULL;
+	int64_t     from          = INT64_MIN;
+	int64_t     to            = INT64_MAX;
+	const char* record        = NULL;
+	const char* replay        = NULL;
+	long        synthesize    = -1;
+	int         with_stats    = 0;
+	const char* stats_format  = NULL;
+	int         with_locality = 0;
+	int         all_netns     = 0;
+	int         with_splice   = 0;
+	int         opt;
+	int         err;
+
+	struct locality* locality = NULL;
+
+	while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+		switch (opt) {
+			case 'L':
+				with_locality = 1;
+				break;
+			case 'N':
+				all_netns = 1;
+				break;
+			case 'E':
+				mode = MODE_ETHTOOL_STATS;
+				break;
+			case 't':
+				timeout_ms = atoi(optarg);
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			case 'A':
+				mode     = MODE_AUDIT;
+				baseline = optarg;
+				break;
+			case 'X':
+				mode    = MODE_EXPORTER;
+				address = optarg;
+				break;
+			case 'W':
+				mode = MODE_WATCH;
+				break;
+			case 'n':
+				mode = MODE_WATCH_NETNS;
+				break;
+			case 'M':
+				max_netns = atoi(optarg);
+				break;
+			case 'O':
+				mode     = MODE_TOP;
+				top_rows = optarg != NULL ? atoi(optarg) : 0;
+				break;
+			case 'o':
+				sort = optarg;
+				break;
+			case 'H':
+				mode     = MODE_HAS_ADDR;
+				has_addr = optarg;
+				break;
+			case 'w':
+				wait_ms = optarg != NULL ? atoi(optarg) : -1;
+				break;
+			case 'K':
+				mode = MODE_SOCKETS;
+				break;
+			case 'k':
+				states = optarg;
+				break;
+			case 'q':
+				mode = MODE_QDISCS;
+				break;
+			case 'V':
+				mode = MODE_VFS;
+				break;
+			case 'B':
+				mode = MODE_FDB;
+				break;
+			case 'm':
+				mode = MODE_FDB;
+				macs = optarg;
+				break;
+			case 'T':
+				mode   = MODE_SERIES;
+				series = optarg;
+				break;
+			case 'i':
+				interval_ms = atoi(optarg);
+				break;
+			case 'Q':
+				mode   = MODE_QUERY;
+				series = optarg;
+				break;
+			case 'F':
+				from = atoll(optarg) * 1000;
+				break;
+			case 'U':
+				to = atoll(optarg) * 1000 + 999;
+				break;
+			case 'I':
+				iface = optarg;
+				break;
+			case 'Z':
+				with_splice = 1;
+				break;
+			case 'R':
+				record = optarg;
+				break;
+			case 'P':
+				replay = optarg;
+				break;
+			case 'S':
+				synthesize = atol(optarg);
+				break;
+			case 's':
+				with_stats   = 1;
+				stats_format = optarg;
+				break;
+			case 'h':
+				fprintf(stdout, "%s", usage);
+				return 0;
+			default:
+				fprintf(stderr, "%s", usage);
+				return 1;
+		}
+	}
+
+	if (with_stats && stats_enable(stats_format) != 0) {
+		fprintf(stderr, "unknown stats format: %s\n", stats_format);
+		return 1;
+	}
+
+	if (synthesize >= 0) {
+		if (record == NULL) {
+			fprintf(stderr, "--synthesize requires --record\n");
+			return 1;
+		}
+
+		if (kio_synthesize(record, synthesize) != 0) {
+			perror("cannot write synthetic capture");
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if (record != NULL && kio_record(record) != 0) {
+		perror("cannot open capture for recording");
+		return 1;
+	}
+
+	if (replay != NULL && kio_replay(replay) != 0) {
+		perror("cannot load capture for replay");
+		return 1;
+	}
+
+	/**
+	 * Long-running modes only end when interrupted; returning (instead of
+	 * being killed) lets the `--stats` summary and the `--record` capture
+	 * be written out, and `--top` give the terminal back, by their exit
+	 * handlers. One-shot modes are left to be killed.
+	 */
+	if ((with_stats || record != NULL || mode == MODE_TOP) &&
+	    long_running(mode, interval_ms)) {
+		interrupt_catch();
+	}
+
+	if (mode != MODE_LIST) {
+		stats_phase(STATS_PHASE_QUERY);
+	}
+
+	/**
+	 * Only for the modes that dump their output once; the others write
+	 * as they go and flush stdout themselves.
+	 */
+	if ((mode == MODE_LIST || mode == MODE_QUERY) && with_splice) {
+		output_open();
+	}
+
+	switch (mode) {
+		case MODE_ETHTOOL_STATS:
+			err = ethtool_stats_run(timeout_ms, jobs);
+			break;
+		case MODE_AUDIT:
+			err = audit_run(baseline);
+			break;
+		case MODE_EXPORTER:
+			return exit_code(exporter_run(address));
+		case MODE_WATCH:
+			return exit_code(watch_run());
+		case MODE_WATCH_NETNS:
+			return exit_code(nswatch_run(max_netns));
+		case MODE_TOP:
+			return exit_code(top_run(interval_ms, top_rows, sort));
+		case MODE_HAS_ADDR:
+			return exit_code(has_addr_run(has_addr, wait_ms));
+		case MODE_SOCKETS:
+			err = sockdiag_run(states);
+			break;
+		case MODE_QDISCS:
+			err = exit_code(qdisc_run(interval_ms));
+			break;
+		case MODE_VFS:
+			err = sriov_run();
+			break;
+		case MODE_FDB:
+			err = fdb_run(macs);
+			break;
+		case MODE_SERIES:
+			return exit_code(series_run(series, interval_ms));
+		case MODE_QUERY:
+			err = series_query_run(series, iface, from, to);
+			break;
+		default:
+			if (with_locality) {
+				stats_phase(STATS_PHASE_LOCALITY);
+				locality = locality_load();
+				if (locality == NULL) {
+					perror(
+					  "cannot load locality information");
+					flush_output();
+					return 1;
+				}
+			}
+
+			err = list_interfaces(locality, all_netns);
+			locality_free(locality);
+			break;
+	}
+
+	flush_output();
+	return err;
 }
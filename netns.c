@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include "./netns.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int
+netns_filter(const struct dirent* entry)
+{
+	return entry->d_name[0] != '.';
+}
+
+/**
+ * Enters the namespace bind-mounted at `path` and calls `fn` from within
+ * it. Returns what `fn` returned, or 0 if the namespace was skipped.
+ */
+static int
+netns_enter(const char*        path,
+            const char*        name,
+            const struct stat* self,
+            int (*fn)(const char* name, void* data),
+            void* data)
+{
+	struct stat st;
+	int         fd;
+	int         ret;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1 || fstat(fd, &st) == -1) {
+		fprintf(stderr, "cannot open netns %s: %m\n", name);
+		if (fd != -1) {
+			close(fd);
+		}
+		return 0;
+	}
+
+	if (st.st_dev == self->st_dev && st.st_ino == self->st_ino) {
+		close(fd);
+		return 0;
+	}
+
+	if (setns(fd, CLONE_NEWNET) == -1) {
+		fprintf(stderr, "cannot enter netns %s: %m\n", name);
+		close(fd);
+		return 0;
+	}
+
+	close(fd);
+	ret = fn(name, data);
+
+	return ret;
+}
+
+int
+netns_for_each(int (*fn)(const char* name, void* data), void* data)
+{
+	struct dirent** entries;
+	struct stat     self;
+	int             n_entries;
+	int             origin;
+	int             ret = 0;
+
+	origin = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+	if (origin == -1) {
+		return -1;
+	}
+
+	if (fstat(origin, &self) == -1) {
+		close(origin);
+		return -1;
+	}
+
+	n_entries = scandir(NETNS_RUN_DIR, &entries, netns_filter, alphasort);
+	if (n_entries == -1) {
+		close(origin);
+
+		/**
+		 * No namespace was ever added.
+		 */
+		return errno == ENOENT ? 0 : -1;
+	}
+
+	for (int i = 0; i < n_entries; i++) {
+		char path[PATH_MAX];
+
+		if (ret == 0) {
+			snprintf(path,
+			         sizeof(path),
+			         NETNS_RUN_DIR "/%s",
+			         entries[i]->d_name);
+			ret = netns_enter(
+			  path, entries[i]->d_name, &self, fn, data);
+		}
+
+		free(entries[i]);
+	}
+	free(entries);
+
+	if (setns(origin, CLONE_NEWNET) == -1) {
+		ret = -1;
+	}
+
+	close(origin);
+	return ret;
+}
+
+int
+netns_call(int fd, int (*fn)(void* data), void* data)
+{
+	int origin;
+	int ret;
+
+	origin = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+	if (origin == -1) {
+		return -1;
+	}
+
+	if (setns(fd, CLONE_NEWNET) == -1) {
+		close(origin);
+		return -1;
+	}
+
+	ret = fn(data);
+
+	if (setns(origin, CLONE_NEWNET) == -1) {
+		ret = -1;
+	}
+
+	close(origin);
+	return ret;
+}
@@ -0,0 +1,40 @@
+#ifndef IFACER__NETNS_H
+#define IFACER__NETNS_H
+
+/**
+ * netns - runs code inside each named network namespace (the ones
+ *         `ip netns add` creates, bind-mounted under /var/run/netns).
+ *
+ * Sockets belong to the namespace they were created in, so entering a
+ * namespace (setns(2)) before enumerating is enough for every ioctl and
+ * netlink dump made from then on to see that namespace's interfaces.
+ * Requires CAP_SYS_ADMIN.
+ */
+
+#define NETNS_RUN_DIR "/var/run/netns"
+
+/**
+ * Calls `fn` from within each named namespace (in alphabetical order),
+ * skipping the one we're already in, then goes back to the original
+ * namespace. A namespace that can't be entered is reported to stderr and
+ * skipped.
+ *
+ * Returns 0, the first non-zero value returned by `fn` (which stops the
+ * iteration) or -1 (with errno set) if the original namespace can't be
+ * saved or restored.
+ */
+int
+netns_for_each(int (*fn)(const char* name, void* data), void* data);
+
+/**
+ * Calls `fn` from within the namespace `fd` refers to (an open
+ * /proc/PID/ns/net or a file under NETNS_RUN_DIR), then goes back to the
+ * namespace of the calling thread.
+ *
+ * Returns what `fn` returned, or -1 (with errno set) if the namespace
+ * can't be entered or the original one restored.
+ */
+int
+netns_call(int fd, int (*fn)(void* data), void* data);
+
+#endif
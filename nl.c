@@ -0,0 +1,368 @@
+#include "./nl.h"
+#include "./kio.h"
+
+#include <errno.h>
+#include <linux/rtnetlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Sequence numbers only need to be unique among the requests in flight on
+ * a given socket, so a process-wide counter is more than enough.
+ */
+static uint32_t nl_seq = 0;
+
+int
+nl_open(int protocol, uint32_t groups)
+{
+	struct sockaddr_nl addr = { .nl_family = AF_NETLINK,
+		                    .nl_groups = groups };
+	int                one  = 1;
+	int                fd;
+
+	fd = kio_socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+	if (fd == -1) {
+		return -1;
+	}
+
+	if (kio_bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	/**
+	 * Ask the kernel to validate the requests strictly (so that
+	 * filters we set in dump requests are honored instead of silently
+	 * ignored); older kernels don't know the option, which is fine.
+	 */
+	setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one, sizeof(one));
+
+	return fd;
+}
+
+int
+nl_send(int fd, struct nlmsghdr* msg)
+{
+	struct sockaddr_nl addr = { .nl_family = AF_NETLINK };
+	ssize_t            n;
+
+	msg->nlmsg_seq = __atomic_add_fetch(&nl_seq, 1, __ATOMIC_RELAXED);
+	msg->nlmsg_pid = 0;
+
+	n = kio_sendto(
+	  fd, msg, msg->nlmsg_len, 0, (struct sockaddr*)&addr, sizeof(addr));
+	if (n == -1) {
+		return -1;
+	}
+
+	return (int)msg->nlmsg_seq;
+}
+
+/**
+ * Hands the messages of a datagram that answer `seq` to `cb`.
+ *
+ * Returns 1 if the answer goes on in the next datagram, or what `nl_recv`
+ * returns.
+ */
+static inline int
+nl_dispatch(const char* buf, ssize_t n, uint32_t seq, nl_msg_cb cb, void* data)
+{
+	const struct nlmsghdr* msg;
+
+	for (msg = (const struct nlmsghdr*)buf; NLMSG_OK(msg, n);
+	     msg = NLMSG_NEXT(msg, n)) {
+		int ret;
+
+		/**
+		 * Multicast notifications may be interleaved with the answer
+		 * if the socket is subscribed to groups.
+		 */
+		if (msg->nlmsg_seq != seq) {
+			continue;
+		}
+
+		if (msg->nlmsg_type == NLMSG_DONE) {
+			return 0;
+		}
+
+		if (msg->nlmsg_type == NLMSG_ERROR) {
+			const struct nlmsgerr* err = NLMSG_DATA(msg);
+
+			return err->error;
+		}
+
+		ret = cb(msg, data);
+		if (ret != 0) {
+			return ret;
+		}
+
+		if (!(msg->nlmsg_flags & NLM_F_MULTI)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int
+nl_recv(int fd, uint32_t seq, nl_msg_cb cb, void* data)
+{
+	/**
+	 * Aligned such that the headers can be accessed in place.
+	 */
+	char buf[NL_BUFSIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+	for (;;) {
+		ssize_t n;
+		int     ret;
+
+		n = kio_recv(fd, buf, sizeof(buf), 0);
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+
+		ret = nl_dispatch(buf, n, seq, cb, data);
+		if (ret != 1) {
+			return ret;
+		}
+	}
+}
+
+int
+nl_recv_sized(int fd, uint32_t seq, nl_msg_cb cb, void* data)
+{
+	char*  buf = NULL;
+	size_t cap = 0;
+	int    ret = 1;
+
+	while (ret == 1) {
+		ssize_t n;
+
+		/**
+		 * MSG_TRUNC makes a peek return the full size of the datagram
+		 * rather than what fits (nothing, here).
+		 */
+		n = kio_recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+		if (n >= 0 && (size_t)n > cap) {
+			char* grown = realloc(buf, n);
+
+			if (grown == NULL) {
+				ret = -ENOMEM;
+				break;
+			}
+
+			buf = grown;
+			cap = n;
+		}
+
+		if (n >= 0) {
+			n = kio_recv(fd, buf, cap, 0);
+		}
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ret = -errno;
+			break;
+		}
+
+		ret = nl_dispatch(buf, n, seq, cb, data);
+	}
+
+	free(buf);
+	return ret;
+}
+
+int
+nl_transact(int fd, struct nlmsghdr* msg, nl_msg_cb cb, void* data)
+{
+	int seq = nl_send(fd, msg);
+
+	if (seq == -1) {
+		return -errno;
+	}
+
+	return nl_recv(fd, (uint32_t)seq, cb, data);
+}
+
+int
+nl_transact_sized(int fd, struct nlmsghdr* msg, nl_msg_cb cb, void* data)
+{
+	int seq = nl_send(fd, msg);
+
+	if (seq == -1) {
+		return -errno;
+	}
+
+	return nl_recv_sized(fd, (uint32_t)seq, cb, data);
+}
+
+struct nlattr*
+nl_attr_put(struct nlmsghdr* msg,
+            size_t           cap,
+            uint16_t         type,
+            const void*      data,
+            size_t           len)
+{
+	struct nlattr* attr;
+	size_t         total =
+	  NLMSG_ALIGN(msg->nlmsg_len) + NLA_ALIGN(NLA_HDRLEN + len);
+
+	if (total > cap) {
+		return NULL;
+	}
+
+	attr = (struct nlattr*)((char*)msg + NLMSG_ALIGN(msg->nlmsg_len));
+	attr->nla_type = type;
+	attr->nla_len  = NLA_HDRLEN + len;
+	if (len > 0) {
+		memcpy((char*)attr + NLA_HDRLEN, data, len);
+	}
+
+	msg->nlmsg_len = total;
+	return attr;
+}
+
+struct nlattr*
+nl_nest_start(struct nlmsghdr* msg, size_t cap, uint16_t type)
+{
+	return nl_attr_put(msg, cap, type | NLA_F_NESTED, NULL, 0);
+}
+
+void
+nl_nest_end(struct nlmsghdr* msg, struct nlattr* nest)
+{
+	nest->nla_len = (char*)msg + msg->nlmsg_len - (char*)nest;
+}
+
+void
+nl_attr_parse(const void* start, size_t len, const struct nlattr** tb, int max)
+{
+	const struct nlattr* attr = start;
+
+	memset(tb, 0, sizeof(*tb) * (max + 1));
+
+	while (len >= NLA_HDRLEN && attr->nla_len >= NLA_HDRLEN &&
+	       attr->nla_len <= len) {
+		uint16_t type = attr->nla_type & NLA_TYPE_MASK;
+
+		if (type <= max) {
+			tb[type] = attr;
+		}
+
+		if (NLA_ALIGN(attr->nla_len) >= len) {
+			break;
+		}
+
+		len -= NLA_ALIGN(attr->nla_len);
+		attr = (const struct nlattr*)((const char*)attr +
+		                              NLA_ALIGN(attr->nla_len));
+	}
+}
+
+void
+nl_attr_parse_nested(const struct nlattr*  nest,
+                     const struct nlattr** tb,
+                     int                   max)
+{
+	nl_attr_parse(nl_attr_data(nest), nl_attr_len(nest), tb, max);
+}
+
+void
+nl_msg_parse(const struct nlmsghdr* msg,
+             size_t                 hdrlen,
+             const struct nlattr**  tb,
+             int                    max)
+{
+	const char* start = (const char*)NLMSG_DATA(msg) + NLMSG_ALIGN(hdrlen);
+	const char* end   = (const char*)msg + msg->nlmsg_len;
+
+	if (start > end) {
+		memset(tb, 0, sizeof(*tb) * (max + 1));
+		return;
+	}
+
+	nl_attr_parse(start, end - start, tb, max);
+}
+
+int
+nl_msg_ifindex(const struct nlmsghdr* msg)
+{
+	switch (msg->nlmsg_type) {
+		case RTM_NEWLINK:
+		case RTM_DELLINK:
+			if (msg->nlmsg_len >=
+			    NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+				return ((const struct ifinfomsg*)NLMSG_DATA(
+				          msg))
+				  ->ifi_index;
+			}
+			break;
+		case RTM_NEWADDR:
+		case RTM_DELADDR:
+			if (msg->nlmsg_len >=
+			    NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+				return ((const struct ifaddrmsg*)NLMSG_DATA(
+				          msg))
+				  ->ifa_index;
+			}
+			break;
+	}
+
+	return 0;
+}
+
+static int
+genl_family_cb(const struct nlmsghdr* msg, void* data)
+{
+	const struct nlattr* tb[CTRL_ATTR_MAX + 1];
+
+	nl_msg_parse(msg, GENL_HDRLEN, tb, CTRL_ATTR_MAX);
+	if (tb[CTRL_ATTR_FAMILY_ID] == NULL) {
+		return -ENOENT;
+	}
+
+	*(int*)data = nl_attr_u16(tb[CTRL_ATTR_FAMILY_ID]);
+	return 0;
+}
+
+int
+genl_family_id(int fd, const char* name)
+{
+	struct {
+		struct nlmsghdr   hdr;
+		struct genlmsghdr genl;
+		char              attrs[64];
+	} req  = { 0 };
+	int id = -1;
+	int err;
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(GENL_HDRLEN);
+	req.hdr.nlmsg_type  = GENL_ID_CTRL;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST;
+	req.genl.cmd        = CTRL_CMD_GETFAMILY;
+	req.genl.version    = 1;
+
+	if (nl_attr_put(&req.hdr,
+	                sizeof(req),
+	                CTRL_ATTR_FAMILY_NAME,
+	                name,
+	                strlen(name) + 1) == NULL) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	err = nl_transact(fd, &req.hdr, genl_family_cb, &id);
+	if (err < 0) {
+		errno = -err;
+		return -1;
+	}
+
+	return id;
+}
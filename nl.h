@@ -0,0 +1,213 @@
+#ifndef IFACER__NL_H
+#define IFACER__NL_H
+
+/**
+ * nl - a tiny set of helpers for talking netlink (`man 7 netlink`).
+ *
+ * Differently from the `ioctl(2)` interface used by the default listing,
+ * netlink is message-based: we send a request (usually a "dump" request,
+ * i.e., one with NLM_F_DUMP set) and the kernel answers with a stream of
+ * messages, possibly spread across many datagrams, finished by a message
+ * of type NLMSG_DONE.
+ *
+ * Each message carries a family-specific header (e.g., `struct ifinfomsg`
+ * for rtnetlink links or `struct genlmsghdr` for generic netlink) followed
+ * by a list of type-length-value attributes. `struct rtattr` (rtnetlink)
+ * and `struct nlattr` (everything else) share the same layout, so the
+ * attribute helpers below work for both.
+ */
+
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Size of the buffer used to receive dump responses.
+ *
+ * The kernel sizes each dump datagram based on the page size (capped at
+ * 32KiB), so anything smaller than that risks truncated messages.
+ */
+#define NL_BUFSIZE 32768
+
+/**
+ * Callback invoked for each message of a dump.
+ *
+ * Returning 0 continues the dump, a positive value stops it early (the
+ * remaining messages are drained from the socket only if the caller keeps
+ * using it) and a negative value aborts it with that value as the error.
+ */
+typedef int (*nl_msg_cb)(const struct nlmsghdr* msg, void* data);
+
+/**
+ * Opens a netlink socket of the given protocol (e.g., NETLINK_ROUTE),
+ * subscribed to the multicast `groups` bitmask (0 for none).
+ *
+ * Returns the file descriptor or -1 with errno set.
+ */
+int
+nl_open(int protocol, uint32_t groups);
+
+/**
+ * Sends the request `msg`, filling its sequence number.
+ *
+ * Returns the sequence number used or -1 with errno set.
+ */
+int
+nl_send(int fd, struct nlmsghdr* msg);
+
+/**
+ * Receives the answer to the request identified by `seq`, calling `cb` for
+ * each message until NLMSG_DONE (for dumps) or the first non-multipart
+ * message (for plain requests).
+ *
+ * Returns 0 when the answer has been fully consumed, the positive value
+ * returned by `cb` if it stopped early or a negative errno on failure
+ * (including errors reported by the kernel via NLMSG_ERROR).
+ */
+int
+nl_recv(int fd, uint32_t seq, nl_msg_cb cb, void* data);
+
+/**
+ * Convenience for `nl_send` followed by `nl_recv`.
+ */
+int
+nl_transact(int fd, struct nlmsghdr* msg, nl_msg_cb cb, void* data);
+
+/**
+ * Same as `nl_recv`, for answers whose datagrams may not fit NL_BUFSIZE
+ * (e.g., a link with RTEXT_FILTER_VF, which holds every virtual function
+ * and their stats in one message): each datagram is peeked at for its
+ * size first, and read into a buffer grown to fit.
+ */
+int
+nl_recv_sized(int fd, uint32_t seq, nl_msg_cb cb, void* data);
+
+/**
+ * Convenience for `nl_send` followed by `nl_recv_sized`.
+ */
+int
+nl_transact_sized(int fd, struct nlmsghdr* msg, nl_msg_cb cb, void* data);
+
+/**
+ * Appends an attribute to the message `msg` whose buffer has `cap` bytes.
+ *
+ * Returns the attribute or NULL if it doesn't fit.
+ */
+struct nlattr*
+nl_attr_put(struct nlmsghdr* msg,
+            size_t           cap,
+            uint16_t         type,
+            const void*      data,
+            size_t           len);
+
+/**
+ * Starts a nested attribute; every attribute appended until the matching
+ * `nl_nest_end` ends up inside of it.
+ */
+struct nlattr*
+nl_nest_start(struct nlmsghdr* msg, size_t cap, uint16_t type);
+
+void
+nl_nest_end(struct nlmsghdr* msg, struct nlattr* nest);
+
+/**
+ * Indexes the attributes found in [start, start+len) by type into `tb`,
+ * which must have room for `max + 1` entries. Attributes with a type
+ * greater than `max` are ignored.
+ */
+void
+nl_attr_parse(const void* start, size_t len, const struct nlattr** tb, int max);
+
+/**
+ * Same as `nl_attr_parse` but for the attributes nested in `nest`.
+ */
+void
+nl_attr_parse_nested(const struct nlattr*  nest,
+                     const struct nlattr** tb,
+                     int                   max);
+
+/**
+ * Indexes the attributes that follow a family header of `hdrlen` bytes in
+ * the message `msg`.
+ */
+void
+nl_msg_parse(const struct nlmsghdr* msg,
+             size_t                 hdrlen,
+             const struct nlattr**  tb,
+             int                    max);
+
+/**
+ * Tells which interface a link or address message (RTM_NEWLINK, ...) is
+ * about, or 0 if it's about something else.
+ */
+int
+nl_msg_ifindex(const struct nlmsghdr* msg);
+
+static inline const void*
+nl_attr_data(const struct nlattr* attr)
+{
+	return (const char*)attr + NLA_HDRLEN;
+}
+
+static inline size_t
+nl_attr_len(const struct nlattr* attr)
+{
+	return attr->nla_len - NLA_HDRLEN;
+}
+
+static inline uint8_t
+nl_attr_u8(const struct nlattr* attr)
+{
+	return *(const uint8_t*)nl_attr_data(attr);
+}
+
+static inline uint16_t
+nl_attr_u16(const struct nlattr* attr)
+{
+	return *(const uint16_t*)nl_attr_data(attr);
+}
+
+static inline uint32_t
+nl_attr_u32(const struct nlattr* attr)
+{
+	return *(const uint32_t*)nl_attr_data(attr);
+}
+
+static inline uint64_t
+nl_attr_u64(const struct nlattr* attr)
+{
+	uint64_t value;
+
+	__builtin_memcpy(&value, nl_attr_data(attr), sizeof(value));
+	return value;
+}
+
+static inline const char*
+nl_attr_str(const struct nlattr* attr)
+{
+	return (const char*)nl_attr_data(attr);
+}
+
+/**
+ * Iterates over the attributes nested in `nest`.
+ */
+#define nl_attr_for_each_nested(pos, nest)                                     \
+	for (pos = (const struct nlattr*)nl_attr_data(nest);                   \
+	     (const char*)pos + NLA_HDRLEN <=                                  \
+	       (const char*)(nest) + (nest)->nla_len &&                        \
+	     pos->nla_len >= NLA_HDRLEN;                                       \
+	     pos = (const struct nlattr*)((const char*)pos +                   \
+	                                  NLA_ALIGN(pos->nla_len)))
+
+/**
+ * Resolves the id of the generic netlink family `name` (e.g., "ethtool")
+ * using a NETLINK_GENERIC socket.
+ *
+ * Returns the id or -1 with errno set (ENOENT if the family is not
+ * registered in the running kernel).
+ */
+int
+genl_family_id(int fd, const char* name);
+
+#endif
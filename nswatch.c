@@ -0,0 +1,1002 @@
+#define _GNU_SOURCE
+#include "./nswatch.h"
+#include "./ifacer.h"
+#include "./interrupt.h"
+#include "./netns.h"
+#include "./watch.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/magic.h>
+#include <linux/netlink.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#define NSWATCH_PARENT_DIR "/var/run"
+#define NSWATCH_PENDING UINT32_MAX
+
+/**
+ * epoll tags of the fds that aren't a namespace's (those are tagged with
+ * the namespace's slot).
+ */
+#define NSWATCH_TAG_INOTIFY ((uint64_t)1 << 32)
+#define NSWATCH_TAG_CONNECTOR ((uint64_t)2 << 32)
+#define NSWATCH_TAG_MOUNTS ((uint64_t)3 << 32)
+
+struct nswatch_ns {
+	ino_t          ino;
+	char*          label; /* NULL for a free slot */
+	struct ifacer* ifacer;
+
+	/**
+	 * What keeps the namespace watched: tracked processes in it, names
+	 * bound to it and, for ours, being ours.
+	 */
+	uint32_t members;
+	uint32_t names;
+	int      pinned;
+};
+
+struct nswatch_name {
+	char*    name;
+	uint32_t slot; /* NSWATCH_PENDING until mounted */
+};
+
+struct nswatch_pid {
+	pid_t    pid; /* 0 for an empty bucket */
+	uint32_t slot;
+};
+
+struct nswatch {
+	int   epfd;
+	int   inotify;
+	int   dir_wd;
+	int   parent_wd;
+	int   connector;
+	int   mounts;
+	ino_t self;
+
+	/**
+	 * Namespaces are watched by instances of a pool, so memory is set
+	 * by `max_netns` up front rather than by how many come and go.
+	 */
+	struct ifacer_pool* pool;
+	struct nswatch_ns*  nss;
+	size_t              n_nss;
+	size_t              max_netns;
+
+	struct nswatch_name* names;
+	size_t               n_names;
+	size_t               cap_names;
+
+	/**
+	 * Open-addressing table (linear probing) of the processes living
+	 * outside our namespace.
+	 */
+	struct nswatch_pid* pids;
+	size_t              n_pids;
+	size_t              cap_pids; /* a power of 2 */
+};
+
+struct nswatch_open {
+	struct ifacer_pool* pool;
+	char*               label;
+	struct ifacer*      ifacer;
+};
+
+static int
+nswatch_open(void* data)
+{
+	struct nswatch_open* open = data;
+
+	open->ifacer = ifacer_pool_open(
+	  open->pool, &watch_callbacks, open->label, IFACER_WATCH);
+
+	return open->ifacer == NULL ? -1 : 0;
+}
+
+static int
+nswatch_find(const struct nswatch* w, ino_t ino)
+{
+	for (size_t i = 0; i < w->n_nss; i++) {
+		if (w->nss[i].label != NULL && w->nss[i].ino == ino) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Starts watching the namespace `fd` refers to (ours if -1).
+ *
+ * Returns its slot, or -1 if it can't be watched.
+ */
+static int
+nswatch_attach(struct nswatch* w, int fd, ino_t ino, const char* label)
+{
+	struct nswatch_open open = { .pool = w->pool };
+	struct nswatch_ns*  ns;
+	size_t              slot;
+	int                 err;
+
+	for (slot = 0; slot < w->n_nss; slot++) {
+		if (w->nss[slot].label == NULL) {
+			break;
+		}
+	}
+
+	if (slot == w->max_netns) {
+		fprintf(stderr,
+		        "cannot watch netns %s: more than %zu namespaces\n",
+		        label,
+		        w->max_netns);
+		return -1;
+	}
+
+	if (slot == w->n_nss) {
+		w->n_nss++;
+	}
+
+	open.label = strdup(label);
+	if (open.label == NULL) {
+		return -1;
+	}
+
+	err =
+	  fd == -1 ? nswatch_open(&open) : netns_call(fd, nswatch_open, &open);
+	if (err != 0) {
+		fprintf(stderr, "cannot watch netns %s: %m\n", label);
+		if (open.ifacer != NULL) {
+			ifacer_close(open.ifacer);
+		}
+		free(open.label);
+		return -1;
+	}
+
+	if (epoll_ctl(w->epfd,
+	              EPOLL_CTL_ADD,
+	              ifacer_fd(open.ifacer),
+	              &(struct epoll_event){ .events   = EPOLLIN,
+	                                     .data.u64 = slot }) == -1) {
+		fprintf(stderr, "cannot watch netns %s: %m\n", label);
+		ifacer_close(open.ifacer);
+		free(open.label);
+		return -1;
+	}
+
+	ns  = &w->nss[slot];
+	*ns = (struct nswatch_ns){
+		.ino    = ino,
+		.label  = open.label,
+		.ifacer = open.ifacer,
+	};
+
+	printf("event: new-netns\nnetns: %s\ninode: %lu\n\n",
+	       ns->label,
+	       (unsigned long)ns->ino);
+
+	return slot;
+}
+
+static void
+nswatch_detach(struct nswatch* w, uint32_t slot)
+{
+	struct nswatch_ns* ns = &w->nss[slot];
+
+	printf("event: del-netns\nnetns: %s\ninode: %lu\n\n",
+	       ns->label,
+	       (unsigned long)ns->ino);
+
+	/**
+	 * Closing the socket is what lets go of the namespace.
+	 */
+	epoll_ctl(w->epfd, EPOLL_CTL_DEL, ifacer_fd(ns->ifacer), NULL);
+	ifacer_close(ns->ifacer);
+	free(ns->label);
+
+	ns->label  = NULL;
+	ns->ifacer = NULL;
+}
+
+static void
+nswatch_release(struct nswatch* w, uint32_t slot)
+{
+	const struct nswatch_ns* ns = &w->nss[slot];
+
+	if (ns->label != NULL && ns->members == 0 && ns->names == 0 &&
+	    !ns->pinned) {
+		nswatch_detach(w, slot);
+	}
+}
+
+static size_t
+nswatch_pid_hash(pid_t pid)
+{
+	return (uint32_t)pid * 2654435761u;
+}
+
+static struct nswatch_pid*
+nswatch_pid_find(const struct nswatch* w, pid_t pid)
+{
+	size_t mask = w->cap_pids - 1;
+
+	for (size_t i = nswatch_pid_hash(pid) & mask;; i = (i + 1) & mask) {
+		if (w->pids[i].pid == pid) {
+			return &w->pids[i];
+		}
+		if (w->pids[i].pid == 0) {
+			return NULL;
+		}
+	}
+}
+
+static void
+nswatch_pid_put(struct nswatch_pid* pids, size_t cap, pid_t pid, uint32_t slot)
+{
+	size_t i = nswatch_pid_hash(pid) & (cap - 1);
+
+	while (pids[i].pid != 0) {
+		i = (i + 1) & (cap - 1);
+	}
+
+	pids[i] = (struct nswatch_pid){ .pid = pid, .slot = slot };
+}
+
+static int
+nswatch_pid_insert(struct nswatch* w, pid_t pid, uint32_t slot)
+{
+	if ((w->n_pids + 1) * 2 > w->cap_pids) {
+		size_t              cap  = w->cap_pids * 2;
+		struct nswatch_pid* pids = calloc(cap, sizeof(*pids));
+
+		if (pids == NULL) {
+			return -1;
+		}
+
+		for (size_t i = 0; i < w->cap_pids; i++) {
+			if (w->pids[i].pid != 0) {
+				nswatch_pid_put(
+				  pids, cap, w->pids[i].pid, w->pids[i].slot);
+			}
+		}
+
+		free(w->pids);
+		w->pids     = pids;
+		w->cap_pids = cap;
+	}
+
+	nswatch_pid_put(w->pids, w->cap_pids, pid, slot);
+	w->n_pids++;
+
+	return 0;
+}
+
+/**
+ * Removes `entry` by shifting back the entries of its probe sequence, so
+ * that lookups never need tombstones.
+ */
+static void
+nswatch_pid_remove(struct nswatch* w, struct nswatch_pid* entry)
+{
+	size_t mask = w->cap_pids - 1;
+	size_t hole = entry - w->pids;
+
+	for (size_t i = (hole + 1) & mask; w->pids[i].pid != 0;
+	     i        = (i + 1) & mask) {
+		size_t home = nswatch_pid_hash(w->pids[i].pid) & mask;
+
+		/**
+		 * The entry can fill the hole unless its home bucket lies
+		 * (cyclically) after the hole.
+		 */
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			w->pids[hole] = w->pids[i];
+			hole          = i;
+		}
+	}
+
+	w->pids[hole].pid = 0;
+	w->n_pids--;
+}
+
+/**
+ * Records that `pid` now lives in the namespace at `slot`.
+ */
+static void
+nswatch_join(struct nswatch* w, pid_t pid, uint32_t slot)
+{
+	struct nswatch_pid* entry = nswatch_pid_find(w, pid);
+
+	if (entry != NULL) {
+		uint32_t old = entry->slot;
+
+		if (old == slot) {
+			return;
+		}
+
+		entry->slot = slot;
+		w->nss[slot].members++;
+		w->nss[old].members--;
+		nswatch_release(w, old);
+		return;
+	}
+
+	if (nswatch_pid_insert(w, pid, slot) == 0) {
+		w->nss[slot].members++;
+	}
+}
+
+/**
+ * Records that `pid` is gone from whatever namespace it was tracked in.
+ */
+static void
+nswatch_leave(struct nswatch* w, pid_t pid)
+{
+	struct nswatch_pid* entry = nswatch_pid_find(w, pid);
+	uint32_t            slot;
+
+	if (entry == NULL) {
+		return;
+	}
+
+	slot = entry->slot;
+	nswatch_pid_remove(w, entry);
+	w->nss[slot].members--;
+	nswatch_release(w, slot);
+}
+
+/**
+ * Looks up the namespace `pid` lives in, attaching it if it's new.
+ */
+static void
+nswatch_track(struct nswatch* w, pid_t pid)
+{
+	char        path[64];
+	char        label[32];
+	struct stat st;
+	int         slot;
+	int         fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/ns/net", pid);
+
+	/**
+	 * The process may be gone already: its exit is on its way.
+	 */
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return;
+	}
+
+	if (fstat(fd, &st) == -1 || st.st_ino == w->self) {
+		close(fd);
+		nswatch_leave(w, pid);
+		return;
+	}
+
+	slot = nswatch_find(w, st.st_ino);
+	if (slot == -1) {
+		snprintf(label, sizeof(label), "pid/%d", pid);
+		slot = nswatch_attach(w, fd, st.st_ino, label);
+	}
+
+	close(fd);
+
+	if (slot != -1) {
+		nswatch_join(w, pid, slot);
+	}
+}
+
+/**
+ * Rebuilds the process table from /proc.
+ */
+static int
+nswatch_scan_procs(struct nswatch* w)
+{
+	struct dirent* entry;
+	DIR*           dir;
+
+	dir = opendir("/proc");
+	if (dir == NULL) {
+		return -1;
+	}
+
+	memset(w->pids, 0, w->cap_pids * sizeof(*w->pids));
+	w->n_pids = 0;
+
+	for (size_t i = 0; i < w->n_nss; i++) {
+		w->nss[i].members = 0;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		char* end;
+		long  pid = strtol(entry->d_name, &end, 10);
+
+		if (*end == '\0' && pid > 0) {
+			nswatch_track(w, pid);
+		}
+	}
+
+	closedir(dir);
+
+	for (size_t i = 0; i < w->n_nss; i++) {
+		nswatch_release(w, i);
+	}
+
+	return 0;
+}
+
+static struct nswatch_name*
+nswatch_name_find(const struct nswatch* w, const char* name)
+{
+	for (size_t i = 0; i < w->n_names; i++) {
+		if (strcmp(w->names[i].name, name) == 0) {
+			return &w->names[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Binds a pending name to its namespace once something is mounted on it.
+ */
+static void
+nswatch_name_check(struct nswatch* w, struct nswatch_name* entry)
+{
+	char          path[PATH_MAX];
+	struct statfs fs;
+	struct stat   st;
+	int           slot;
+	int           fd;
+
+	snprintf(path, sizeof(path), NETNS_RUN_DIR "/%s", entry->name);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return;
+	}
+
+	if (fstatfs(fd, &fs) == -1 || fs.f_type != NSFS_MAGIC ||
+	    fstat(fd, &st) == -1) {
+		close(fd);
+		return;
+	}
+
+	slot = nswatch_find(w, st.st_ino);
+	if (slot == -1) {
+		slot = nswatch_attach(w, fd, st.st_ino, entry->name);
+	}
+
+	close(fd);
+
+	if (slot != -1) {
+		entry->slot = slot;
+		w->nss[slot].names++;
+	}
+}
+
+static void
+nswatch_name_add(struct nswatch* w, const char* name)
+{
+	struct nswatch_name* entry = nswatch_name_find(w, name);
+
+	if (entry == NULL) {
+		if (w->n_names == w->cap_names) {
+			size_t cap = w->cap_names ? w->cap_names * 2 : 16;
+			struct nswatch_name* names =
+			  realloc(w->names, cap * sizeof(*names));
+
+			if (names == NULL) {
+				return;
+			}
+
+			w->names     = names;
+			w->cap_names = cap;
+		}
+
+		entry  = &w->names[w->n_names];
+		*entry = (struct nswatch_name){ .name = strdup(name),
+			                        .slot = NSWATCH_PENDING };
+		if (entry->name == NULL) {
+			return;
+		}
+
+		w->n_names++;
+	}
+
+	if (entry->slot == NSWATCH_PENDING) {
+		nswatch_name_check(w, entry);
+	}
+}
+
+static void
+nswatch_name_remove(struct nswatch* w, struct nswatch_name* entry)
+{
+	uint32_t slot = entry->slot;
+
+	free(entry->name);
+	*entry = w->names[--w->n_names];
+
+	if (slot != NSWATCH_PENDING) {
+		w->nss[slot].names--;
+		nswatch_release(w, slot);
+	}
+}
+
+static int
+nswatch_filter(const struct dirent* entry)
+{
+	return entry->d_name[0] != '.';
+}
+
+/**
+ * Reconciles the names we know with the ones in NETNS_RUN_DIR (after
+ * inotify lost track, or when the directory appears or goes away).
+ */
+static int
+nswatch_scan_names(struct nswatch* w)
+{
+	struct dirent** entries   = NULL;
+	int             n_entries = 0;
+
+	n_entries = scandir(NETNS_RUN_DIR, &entries, nswatch_filter, alphasort);
+	if (n_entries == -1) {
+		if (errno != ENOENT) {
+			return -1;
+		}
+		n_entries = 0;
+	}
+
+	for (size_t i = 0; i < w->n_names;) {
+		int found = 0;
+
+		for (int j = 0; j < n_entries && !found; j++) {
+			found =
+			  strcmp(w->names[i].name, entries[j]->d_name) == 0;
+		}
+
+		if (found) {
+			i++;
+		} else {
+			nswatch_name_remove(w, &w->names[i]);
+		}
+	}
+
+	for (int j = 0; j < n_entries; j++) {
+		nswatch_name_add(w, entries[j]->d_name);
+		free(entries[j]);
+	}
+	free(entries);
+
+	return 0;
+}
+
+/**
+ * Watches NETNS_RUN_DIR, or its parent for it to be created.
+ */
+static int
+nswatch_watch_dir(struct nswatch* w)
+{
+	w->dir_wd = inotify_add_watch(w->inotify,
+	                              NETNS_RUN_DIR,
+	                              IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+	                                IN_MOVED_TO | IN_ONLYDIR);
+	if (w->dir_wd == -1) {
+		if (errno != ENOENT || w->parent_wd != -1) {
+			return errno == ENOENT ? 0 : -1;
+		}
+
+		w->parent_wd =
+		  inotify_add_watch(w->inotify,
+		                    NSWATCH_PARENT_DIR,
+		                    IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+		if (w->parent_wd == -1) {
+			return -1;
+		}
+
+		/**
+		 * It may have been created in between.
+		 */
+		w->dir_wd =
+		  inotify_add_watch(w->inotify,
+		                    NETNS_RUN_DIR,
+		                    IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+		                      IN_MOVED_TO | IN_ONLYDIR);
+		if (w->dir_wd == -1) {
+			return errno == ENOENT ? 0 : -1;
+		}
+	}
+
+	if (w->parent_wd != -1) {
+		inotify_rm_watch(w->inotify, w->parent_wd);
+		w->parent_wd = -1;
+	}
+
+	return nswatch_scan_names(w);
+}
+
+static int
+nswatch_on_inotify(struct nswatch* w)
+{
+	char buf[4096]
+	  __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for (;;) {
+		const struct inotify_event* event;
+		ssize_t n = read(w->inotify, buf, sizeof(buf));
+
+		if (n == -1) {
+			return errno == EAGAIN ? 0 : -errno;
+		}
+
+		for (char* p = buf; p < buf + n;
+		     p += sizeof(*event) + event->len) {
+			event = (const struct inotify_event*)p;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				if (nswatch_scan_names(w) != 0) {
+					return -errno;
+				}
+			} else if (event->wd == w->dir_wd) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					nswatch_name_add(w, event->name);
+				} else if (event->mask &
+				           (IN_DELETE | IN_MOVED_FROM)) {
+					struct nswatch_name* entry =
+					  nswatch_name_find(w, event->name);
+
+					if (entry != NULL) {
+						nswatch_name_remove(w, entry);
+					}
+				} else if (event->mask & IN_IGNORED) {
+					/**
+					 * The directory itself is gone.
+					 */
+					w->dir_wd = -1;
+					if (nswatch_scan_names(w) != 0 ||
+					    nswatch_watch_dir(w) != 0) {
+						return -errno;
+					}
+				}
+			} else if (event->wd == w->parent_wd &&
+			           event->len > 0 &&
+			           strcmp(event->name, "netns") == 0) {
+				if (nswatch_watch_dir(w) != 0) {
+					return -errno;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Subscribes to the proc connector's fork/exec/exit feed.
+ */
+static int
+nswatch_connect(void)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = CN_IDX_PROC,
+	};
+	struct {
+		struct nlmsghdr hdr;
+		struct cn_msg   cn;
+		uint32_t        op;
+	} __attribute__((packed)) req = { 0 };
+	int fd;
+
+	fd = socket(AF_NETLINK,
+	            SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+	            NETLINK_CONNECTOR);
+	if (fd == -1) {
+		return -1;
+	}
+
+	req.hdr.nlmsg_len  = sizeof(req);
+	req.hdr.nlmsg_type = NLMSG_DONE;
+	req.cn.id.idx      = CN_IDX_PROC;
+	req.cn.id.val      = CN_VAL_PROC;
+	req.cn.len         = sizeof(req.op);
+	req.op             = PROC_CN_MCAST_LISTEN;
+
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+	    send(fd, &req, sizeof(req), 0) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void
+nswatch_on_proc_event(struct nswatch* w, const struct proc_event* event)
+{
+	switch (event->what) {
+		case PROC_EVENT_FORK: {
+			struct nswatch_pid* parent;
+
+			/**
+			 * Threads share the namespace of their process.
+			 */
+			if (event->event_data.fork.child_pid !=
+			    event->event_data.fork.child_tgid) {
+				break;
+			}
+
+			parent = nswatch_pid_find(
+			  w, event->event_data.fork.parent_tgid);
+			if (parent != NULL) {
+				nswatch_join(w,
+				             event->event_data.fork.child_tgid,
+				             parent->slot);
+			} else {
+				/**
+				 * A stale entry, if the pid was reused.
+				 */
+				nswatch_leave(
+				  w, event->event_data.fork.child_tgid);
+			}
+			break;
+		}
+		case PROC_EVENT_EXEC:
+			nswatch_track(w, event->event_data.exec.process_tgid);
+			break;
+		case PROC_EVENT_EXIT:
+			if (event->event_data.exit.process_pid ==
+			    event->event_data.exit.process_tgid) {
+				nswatch_leave(
+				  w, event->event_data.exit.process_tgid);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+static int
+nswatch_on_connector(struct nswatch* w)
+{
+	char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+	for (;;) {
+		const struct nlmsghdr* msg = (const struct nlmsghdr*)buf;
+		ssize_t n = recv(w->connector, buf, sizeof(buf), 0);
+
+		if (n == -1) {
+			if (errno == EAGAIN) {
+				return 0;
+			}
+
+			/**
+			 * Events were dropped: start over from /proc.
+			 */
+			if (errno == ENOBUFS) {
+				if (nswatch_scan_procs(w) != 0) {
+					return -errno;
+				}
+				continue;
+			}
+
+			return -errno;
+		}
+
+		for (size_t len = n; NLMSG_OK(msg, len);
+		     msg        = NLMSG_NEXT(msg, len)) {
+			const struct cn_msg* cn = NLMSG_DATA(msg);
+
+			if (msg->nlmsg_len < NLMSG_LENGTH(sizeof(*cn)) ||
+			    cn->id.idx != CN_IDX_PROC ||
+			    cn->id.val != CN_VAL_PROC ||
+			    cn->len < sizeof(struct proc_event)) {
+				continue;
+			}
+
+			nswatch_on_proc_event(
+			  w, (const struct proc_event*)cn->data);
+		}
+	}
+}
+
+static int
+nswatch_init(struct nswatch* w, size_t max_netns)
+{
+	struct stat st;
+	int         slot;
+
+	if (stat("/proc/self/ns/net", &st) == -1) {
+		perror("cannot stat our netns");
+		return 1;
+	}
+	w->self = st.st_ino;
+
+	w->max_netns = max_netns;
+	w->nss       = calloc(max_netns, sizeof(*w->nss));
+	w->pool      = ifacer_pool_new(max_netns);
+	w->cap_pids  = 256;
+	w->pids      = calloc(w->cap_pids, sizeof(*w->pids));
+	w->epfd      = epoll_create1(EPOLL_CLOEXEC);
+	w->inotify   = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	w->mounts    = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+	if (w->nss == NULL || w->pool == NULL || w->pids == NULL ||
+	    w->epfd == -1 || w->inotify == -1 || w->mounts == -1) {
+		perror("cannot set up netns watch");
+		return 1;
+	}
+
+	slot = nswatch_attach(w, -1, w->self, "default");
+	if (slot == -1) {
+		return 1;
+	}
+	w->nss[slot].pinned = 1;
+
+	/**
+	 * Subscribe before looking, so that nothing happens unnoticed in
+	 * between.
+	 */
+	w->connector = nswatch_connect();
+	if (w->connector == -1) {
+		perror(
+		  "cannot follow processes, only named namespaces are watched");
+	}
+
+	if (epoll_ctl(w->epfd,
+	              EPOLL_CTL_ADD,
+	              w->inotify,
+	              &(struct epoll_event){
+	                .events = EPOLLIN, .data.u64 = NSWATCH_TAG_INOTIFY }) ==
+	      -1 ||
+	    epoll_ctl(w->epfd,
+	              EPOLL_CTL_ADD,
+	              w->mounts,
+	              &(struct epoll_event){
+	                .events = EPOLLPRI, .data.u64 = NSWATCH_TAG_MOUNTS }) ==
+	      -1 ||
+	    (w->connector != -1 &&
+	     epoll_ctl(w->epfd,
+	               EPOLL_CTL_ADD,
+	               w->connector,
+	               &(struct epoll_event){
+	                 .events   = EPOLLIN,
+	                 .data.u64 = NSWATCH_TAG_CONNECTOR }) == -1)) {
+		perror("cannot set up netns watch");
+		return 1;
+	}
+
+	if (nswatch_watch_dir(w) != 0) {
+		perror("cannot watch " NETNS_RUN_DIR);
+		return 1;
+	}
+
+	if (w->connector != -1 && nswatch_scan_procs(w) != 0) {
+		perror("cannot scan /proc");
+		return 1;
+	}
+
+	return 0;
+}
+
+static void
+nswatch_free(struct nswatch* w)
+{
+	for (size_t i = 0; i < w->n_nss; i++) {
+		if (w->nss[i].label != NULL) {
+			ifacer_close(w->nss[i].ifacer);
+			free(w->nss[i].label);
+		}
+	}
+
+	for (size_t i = 0; i < w->n_names; i++) {
+		free(w->names[i].name);
+	}
+
+	ifacer_pool_free(w->pool);
+	free(w->nss);
+	free(w->names);
+	free(w->pids);
+
+	if (w->connector != -1) {
+		close(w->connector);
+	}
+	if (w->mounts != -1) {
+		close(w->mounts);
+	}
+	if (w->inotify != -1) {
+		close(w->inotify);
+	}
+	if (w->epfd != -1) {
+		close(w->epfd);
+	}
+}
+
+int
+nswatch_run(int max_netns)
+{
+	struct nswatch w = {
+		.epfd      = -1,
+		.inotify   = -1,
+		.dir_wd    = -1,
+		.parent_wd = -1,
+		.connector = -1,
+		.mounts    = -1,
+	};
+	int ret =
+	  nswatch_init(&w, max_netns > 0 ? max_netns : NSWATCH_MAX_NETNS);
+	int done = 0;
+
+	while (ret == 0 && !done && interrupt_signal() == 0) {
+		struct epoll_event events[64];
+		int                n_events;
+
+		fflush(stdout);
+
+		n_events = interrupt_epoll_wait(w.epfd, events, 64, -1);
+		if (n_events == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("epoll_wait failed");
+			ret = 1;
+			break;
+		}
+
+		for (int i = 0; i < n_events && ret == 0 && !done; i++) {
+			uint64_t tag = events[i].data.u64;
+			int      err = 0;
+
+			if (tag == NSWATCH_TAG_INOTIFY) {
+				err = nswatch_on_inotify(&w);
+			} else if (tag == NSWATCH_TAG_CONNECTOR) {
+				err = nswatch_on_connector(&w);
+			} else if (tag == NSWATCH_TAG_MOUNTS) {
+				for (size_t j = 0; j < w.n_names; j++) {
+					if (w.names[j].slot ==
+					    NSWATCH_PENDING) {
+						nswatch_name_check(&w,
+						                   &w.names[j]);
+					}
+				}
+			} else if (tag < w.n_nss && w.nss[tag].label != NULL) {
+				err = ifacer_step(w.nss[tag].ifacer);
+
+				if (err == -ENODATA) {
+					done = 1;
+				} else if (err < 0) {
+					fprintf(
+					  stderr,
+					  "watch of netns %s failed: %s\n",
+					  w.nss[tag].label,
+					  strerror(-err));
+					ret = 2;
+				}
+			}
+
+			if (err < 0 && (tag == NSWATCH_TAG_INOTIFY ||
+			                tag == NSWATCH_TAG_CONNECTOR)) {
+				fprintf(stderr,
+				        "netns discovery failed: %s\n",
+				        strerror(-err));
+				ret = 2;
+			}
+		}
+	}
+
+	fflush(stdout);
+	nswatch_free(&w);
+
+	return ret;
+}
@@ -0,0 +1,64 @@
+#ifndef IFACER__NSWATCH_H
+#define IFACER__NSWATCH_H
+
+/**
+ * nswatch - links and addresses of every network namespace, followed as
+ *           namespaces come and go (`--watch-netns`).
+ *
+ * Each namespace gets its own rtnetlink socket (an `ifacer` instance
+ * opened from within it, see `netns_call`), all of them polled from a
+ * single epoll set. Records are the ones of `--watch` (see `watch.h`) with
+ * a `netns:` line naming the namespace, plus:
+ *
+ *      event: new-netns            event: del-netns
+ *      netns: <label>              netns: <label>
+ *      inode: <nsfs inode>         inode: <nsfs inode>
+ *
+ * Namespaces are labelled `default` (ours), by their name under
+ * NETNS_RUN_DIR, or `pid/<pid>` after the first process seen in them.
+ *
+ * Discovery is driven by events, so that its cost follows the changes
+ * rather than the number of processes:
+ *
+ *   - named namespaces: NETNS_RUN_DIR is watched with inotify (or its
+ *     parent, until it exists). `ip netns add` creates the file before
+ *     bind-mounting the namespace on it, so a new name is kept pending
+ *     until a change to the mount table (/proc/self/mountinfo polls as
+ *     such) turns it into an nsfs mount; and
+ *   - process namespaces: the proc connector (NETLINK_CONNECTOR) reports
+ *     every fork, exec and exit. Only processes outside our namespace are
+ *     tracked, in a pid -> namespace table: an exec looks up the namespace
+ *     of the process, a fork copies the parent's, and a namespace goes
+ *     away with its last process (unless it's named).
+ *
+ * /proc is only walked once at start, and again if the kernel drops
+ * connector messages (ENOBUFS). A process that changes namespace without
+ * exec'ing (unshare(2), setns(2)) is noticed at its next exec.
+ *
+ * The whole watch is a single thread and a single epoll loop, whose memory
+ * is set up front: the namespace table and the ifacer instances (from a
+ * pool, see `ifacer_pool_new`) are preallocated for `max_netns`
+ * namespaces and all instances read into one shared buffer, so a
+ * namespace costs about 100 bytes plus its socket. Namespaces beyond
+ * that are reported to stderr and left out. Only the pid table grows,
+ * with the number of processes outside our namespace.
+ *
+ * Requires CAP_SYS_ADMIN (to enter namespaces) and CAP_NET_ADMIN (for the
+ * proc connector; without it, only named namespaces are followed).
+ */
+
+/**
+ * Default number of namespaces that can be watched at once.
+ */
+#define NSWATCH_MAX_NETNS 1024
+
+/**
+ * Runs until interrupted, watching up to `max_netns` namespaces at once
+ * (NSWATCH_MAX_NETNS if 0).
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+nswatch_run(int max_netns);
+
+#endif
@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+#include "./output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * Size asked for the pipe (and so for each buffer). The kernel may round it
+ * up, or refuse it above /proc/sys/fs/pipe-max-size, in which case the pipe
+ * keeps its size and the buffers follow.
+ */
+#define OUTPUT_PIPE_SIZE (1024 * 1024)
+#define OUTPUT_STDIO_SIZE 16384
+
+struct output {
+	FILE*  file;
+	int    fd;
+	int    splice; /* 0 once the pipe refused spliced pages */
+	char*  bufs[2];
+	int    current;
+	size_t len;
+	size_t size;
+};
+
+static struct output output = { .fd = -1 };
+
+/**
+ * Writes out the current buffer, then switches to the other one.
+ */
+static int
+output_push(void)
+{
+	struct iovec iov = {
+		.iov_base = output.bufs[output.current],
+		.iov_len  = output.len,
+	};
+
+	while (iov.iov_len > 0) {
+		ssize_t n;
+
+		if (output.splice) {
+			n = vmsplice(output.fd, &iov, 1, 0);
+			if (n == -1 && (errno == EINVAL || errno == ENOSYS)) {
+				output.splice = 0;
+				continue;
+			}
+		} else {
+			n = write(output.fd, iov.iov_base, iov.iov_len);
+		}
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		iov.iov_base = (char*)iov.iov_base + n;
+		iov.iov_len -= n;
+	}
+
+	output.current ^= 1;
+	output.len = 0;
+
+	return 0;
+}
+
+static ssize_t
+output_write(void* cookie, const char* data, size_t len)
+{
+	size_t done = 0;
+
+	(void)cookie;
+
+	while (done < len) {
+		size_t n = output.size - output.len;
+
+		if (n > len - done) {
+			n = len - done;
+		}
+
+		memcpy(
+		  output.bufs[output.current] + output.len, data + done, n);
+		output.len += n;
+		done += n;
+
+		if (output.len == output.size && output_push() != 0) {
+			return -1;
+		}
+	}
+
+	return len;
+}
+
+int
+output_open(void)
+{
+	struct stat st;
+	int         size;
+	char*       bufs;
+	FILE*       file;
+
+	if (fstat(STDOUT_FILENO, &st) == -1 || !S_ISFIFO(st.st_mode)) {
+		return 0;
+	}
+
+	size = fcntl(STDOUT_FILENO, F_SETPIPE_SZ, OUTPUT_PIPE_SIZE);
+	if (size == -1) {
+		size = fcntl(STDOUT_FILENO, F_GETPIPE_SZ);
+		if (size == -1) {
+			return 0;
+		}
+	}
+
+	bufs = mmap(NULL,
+	            2 * (size_t)size,
+	            PROT_READ | PROT_WRITE,
+	            MAP_PRIVATE | MAP_ANONYMOUS,
+	            -1,
+	            0);
+	if (bufs == MAP_FAILED) {
+		return 0;
+	}
+
+	file = fopencookie(
+	  NULL, "w", (cookie_io_functions_t){ .write = output_write });
+	if (file == NULL) {
+		munmap(bufs, 2 * (size_t)size);
+		return 0;
+	}
+
+	/**
+	 * stdio still formats into a small buffer of its own (printing
+	 * unbuffered costs more than the copy out of it, which stays in
+	 * cache).
+	 */
+	setvbuf(file, NULL, _IOFBF, OUTPUT_STDIO_SIZE);
+
+	fflush(stdout);
+
+	output = (struct output){
+		.file   = file,
+		.fd     = STDOUT_FILENO,
+		.splice = 1,
+		.bufs   = { bufs, bufs + size },
+		.size   = size,
+	};
+	stdout = file;
+
+	return 1;
+}
+
+size_t
+output_pending(void)
+{
+	return output.len;
+}
+
+int
+output_close(void)
+{
+	if (output.file == NULL) {
+		return 0;
+	}
+
+	return output_push();
+}
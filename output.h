@@ -0,0 +1,54 @@
+#ifndef IFACER__OUTPUT_H
+#define IFACER__OUTPUT_H
+
+/**
+ * output - zero-copy stdout for large dumps piped into another program
+ *          (e.g., `ifacer --all-netns | zstd`).
+ *
+ * `write(2)` to a pipe copies every byte into pipe pages. When stdout is a
+ * pipe, `output_open` instead points `stdout` to a stream (fopencookie(3))
+ * that fills page-aligned buffers and hands their pages over to the pipe
+ * with `vmsplice(2)`, so the only copy left is the reader's.
+ *
+ * The pages then belong to the pipe until read, so they can't be written
+ * again right away. The pipe is resized (F_SETPIPE_SZ) to the size of a
+ * buffer, and two buffers are used in turn: once a full buffer is in the
+ * pipe, the pipe holds nothing else, so the other buffer has been read and
+ * can be refilled.
+ *
+ * That only holds for readers that consume what they read (`read(2)`): a
+ * reader that splices the pages onward (e.g., to a socket) may still
+ * reference them once they're refilled, and what it sends out gets
+ * corrupted. Since nothing tells us what the reader does, splicing is
+ * opt-in (`--splice`), and plain writes are the default.
+ *
+ * If the pipe can't take spliced pages, writes are used instead.
+ */
+
+#include <stddef.h>
+
+/**
+ * Switches `stdout` to the zero-copy stream if it's a pipe. Only for
+ * readers that consume what they read (see above).
+ *
+ * Returns 1 if it did, 0 if stdout is left alone.
+ */
+int
+output_open(void);
+
+/**
+ * Bytes written to the zero-copy stream that aren't in the pipe yet.
+ */
+size_t
+output_pending(void);
+
+/**
+ * Hands whatever is buffered over to the pipe. Must only be called once
+ * nothing else is going to be written.
+ *
+ * Returns 0 or -1 with errno set.
+ */
+int
+output_close(void);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef IFACER__PROBES_H
+#define IFACER__PROBES_H
+
+/**
+ * probes - USDT (user-level statically defined tracing) probes, so that
+ *          ifacer can be traced in the field with bpftrace, perf or
+ *          SystemTap without rebuilding it, e.g.:
+ *
+ *      bpftrace -e 'usdt:./main.out:ifacer:iface__end
+ *                   { @[str(arg1)] = count(); }'
+ *
+ * Each probe is a single `nop` plus a note in `.note.stapsdt` telling the
+ * tracer where the `nop` is and where to find the arguments; nothing else
+ * happens unless a tracer is attached. Arguments must therefore be cheap to
+ * compute (they are, regardless of anyone listening).
+ *
+ * Probes (provider `ifacer`):
+ *
+ *   - enumerate__start()                   : about to ask for the list of
+ *                                            interfaces;
+ *   - enumerate__end(count, bytes)         : got `count` records (`bytes`
+ *                                            long) back;
+ *   - iface__start(position, name)         : about to query / parse the
+ *                                            interface at `position` of the
+ *                                            listing;
+ *   - iface__end(position, name, err)      : done with it (`err` is 0 or an
+ *                                            errno);
+ *   - event__start(type, ifindex)          : about to dispatch a netlink
+ *                                            notification (RTM_*) about
+ *                                            `ifindex` in a long-running
+ *                                            mode;
+ *   - event__end(type, ifindex)            : done dispatching it;
+ *   - scrape__start()                      : about to answer a `/metrics`
+ *                                            scrape;
+ *   - scrape__end(bytes)                   : answered it with `bytes`;
+ *   - flush__start(bytes)                  : about to write `bytes` of
+ *                                            buffered output; and
+ *   - flush__end(bytes)                    : done writing them.
+ *
+ * Without `<sys/sdt.h>` (systemtap-sdt-dev) at build time the probes
+ * compile to nothing.
+ */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define IFACER_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef IFACER_HAVE_SDT
+#define PROBE0(name) DTRACE_PROBE(ifacer, name)
+#define PROBE1(name, a) DTRACE_PROBE1(ifacer, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(ifacer, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(ifacer, name, a, b, c)
+#else
+#define PROBE0(name)                                                           \
+	do {                                                                   \
+	} while (0)
+#define PROBE1(name, a) ((void)(a))
+#define PROBE2(name, a, b) ((void)(a), (void)(b))
+#define PROBE3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#endif
+
+#endif
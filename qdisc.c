@@ -0,0 +1,507 @@
+#define _GNU_SOURCE
+#include "./qdisc.h"
+#include "./arena.h"
+#include "./interrupt.h"
+#include "./kio.h"
+#include "./nl.h"
+
+#include <errno.h>
+#include <linux/gen_stats.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Qdiscs that have no classes to dump. Any other kind is asked for its
+ * classes, so that a classful qdisc this list doesn't know about is never
+ * missed.
+ */
+static const char* const qdisc_classless[] = {
+	"noqueue",  "noop", "pfifo_fast", "pfifo", "bfifo",   "pfifo_head_drop",
+	"fq_codel", "fq",   "sfq",        "codel", "pie",     "fq_pie",
+	"cake",     "red",  "choke",      "sfb",   "ingress", "clsact",
+};
+
+struct qdisc_entry {
+	uint32_t ifindex;
+	uint32_t is_class;
+	uint32_t handle;
+	uint32_t parent;
+	char     kind[IFNAMSIZ];
+	uint64_t bytes;
+	uint64_t packets;
+	uint32_t qlen;
+	uint32_t backlog;
+	uint32_t drops;
+	uint32_t overlimits;
+	uint32_t requeues;
+};
+
+/**
+ * The qdiscs and classes of one sample, allocated from the list's own
+ * arena: `qdisc_run` alternates between two lists, so the previous
+ * sample stays readable while the next one is taken.
+ */
+struct qdisc_list {
+	struct arena        arena;
+	struct qdisc_entry* entries;
+	size_t              count;
+	size_t              cap;
+};
+
+/**
+ * Adds a qdisc or class of a dump to the list.
+ */
+static int
+qdisc_collect(const struct nlmsghdr* msg, void* data)
+{
+	struct qdisc_list*   list = data;
+	const struct tcmsg*  tcm  = NLMSG_DATA(msg);
+	const struct nlattr* tb[TCA_MAX + 1];
+	struct qdisc_entry*  entry;
+
+	if ((msg->nlmsg_type != RTM_NEWQDISC &&
+	     msg->nlmsg_type != RTM_NEWTCLASS) ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*tcm))) {
+		return 0;
+	}
+
+	if (list->count == list->cap) {
+		size_t              cap = list->cap ? list->cap * 2 : 64;
+		struct qdisc_entry* entries =
+		  arena_extend(&list->arena,
+		               list->entries,
+		               list->count * sizeof(*entries),
+		               cap * sizeof(*entries));
+
+		if (entries == NULL) {
+			return -ENOMEM;
+		}
+
+		list->entries = entries;
+		list->cap     = cap;
+	}
+
+	nl_msg_parse(msg, sizeof(*tcm), tb, TCA_MAX);
+
+	entry  = &list->entries[list->count++];
+	*entry = (struct qdisc_entry){
+		.ifindex  = tcm->tcm_ifindex,
+		.is_class = msg->nlmsg_type == RTM_NEWTCLASS,
+		.handle   = tcm->tcm_handle,
+		.parent   = tcm->tcm_parent,
+	};
+
+	if (tb[TCA_KIND] != NULL) {
+		size_t len = nl_attr_len(tb[TCA_KIND]);
+
+		if (len > sizeof(entry->kind) - 1) {
+			len = sizeof(entry->kind) - 1;
+		}
+		memcpy(entry->kind, nl_attr_data(tb[TCA_KIND]), len);
+		entry->kind[len] = '\0';
+	}
+
+	if (tb[TCA_STATS2] != NULL) {
+		const struct nlattr*    st[TCA_STATS_MAX + 1];
+		struct gnet_stats_basic basic = { 0 };
+		struct gnet_stats_queue queue = { 0 };
+
+		nl_attr_parse_nested(tb[TCA_STATS2], st, TCA_STATS_MAX);
+
+		/**
+		 * The kernel may send less than the structures hold (and
+		 * `gnet_stats_basic` has trailing padding), so only what's
+		 * there is copied.
+		 */
+		if (st[TCA_STATS_BASIC] != NULL) {
+			size_t len = nl_attr_len(st[TCA_STATS_BASIC]);
+
+			memcpy(&basic,
+			       nl_attr_data(st[TCA_STATS_BASIC]),
+			       len < sizeof(basic) ? len : sizeof(basic));
+		}
+
+		if (st[TCA_STATS_QUEUE] != NULL) {
+			size_t len = nl_attr_len(st[TCA_STATS_QUEUE]);
+
+			memcpy(&queue,
+			       nl_attr_data(st[TCA_STATS_QUEUE]),
+			       len < sizeof(queue) ? len : sizeof(queue));
+		}
+
+		entry->bytes      = basic.bytes;
+		entry->packets    = basic.packets;
+		entry->qlen       = queue.qlen;
+		entry->backlog    = queue.backlog;
+		entry->drops      = queue.drops;
+		entry->overlimits = queue.overlimits;
+		entry->requeues   = queue.requeues;
+
+		/**
+		 * `packets` is 32-bit in `gnet_stats_basic`; newer kernels
+		 * send the full count alongside.
+		 */
+		if (st[TCA_STATS_PKT64] != NULL &&
+		    nl_attr_len(st[TCA_STATS_PKT64]) >= sizeof(uint64_t)) {
+			entry->packets = nl_attr_u64(st[TCA_STATS_PKT64]);
+		}
+	} else if (tb[TCA_STATS] != NULL) {
+		struct tc_stats stats = { 0 };
+		size_t          len   = nl_attr_len(tb[TCA_STATS]);
+
+		memcpy(&stats,
+		       nl_attr_data(tb[TCA_STATS]),
+		       len < sizeof(stats) ? len : sizeof(stats));
+
+		entry->bytes      = stats.bytes;
+		entry->packets    = stats.packets;
+		entry->qlen       = stats.qlen;
+		entry->backlog    = stats.backlog;
+		entry->drops      = stats.drops;
+		entry->overlimits = stats.overlimits;
+	}
+
+	return 0;
+}
+
+static int
+qdisc_compare(const void* a, const void* b)
+{
+	const struct qdisc_entry* x = a;
+	const struct qdisc_entry* y = b;
+
+	if (x->ifindex != y->ifindex) {
+		return x->ifindex < y->ifindex ? -1 : 1;
+	}
+	if (x->is_class != y->is_class) {
+		return x->is_class < y->is_class ? -1 : 1;
+	}
+	if (x->handle != y->handle) {
+		return x->handle < y->handle ? -1 : 1;
+	}
+	if (x->parent != y->parent) {
+		return x->parent < y->parent ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static int
+qdisc_is_classful(const char* kind)
+{
+	for (size_t i = 0;
+	     i < sizeof(qdisc_classless) / sizeof(*qdisc_classless);
+	     i++) {
+		if (strcmp(kind, qdisc_classless[i]) == 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * Dumps the qdiscs, then the classes of the interfaces that have a
+ * classful qdisc, into `list` (reset first), sorted.
+ */
+static int
+qdisc_sample(int fd, struct qdisc_list* list)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct tcmsg    tcm;
+	} req           = { 0 };
+	uint32_t dumped = 0;
+	size_t   qdiscs;
+	int      err;
+
+	arena_reset(&list->arena);
+	list->entries = NULL;
+	list->count   = 0;
+	list->cap     = 0;
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.tcm));
+	req.hdr.nlmsg_type  = RTM_GETQDISC;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	err = nl_transact(fd, &req.hdr, qdisc_collect, list);
+	if (err < 0) {
+		return err;
+	}
+
+	/**
+	 * Sorted by interface, so that each interface is asked for its
+	 * classes once, however many classful qdiscs it has.
+	 */
+	qsort(
+	  list->entries, list->count, sizeof(*list->entries), qdisc_compare);
+	qdiscs = list->count;
+
+	for (size_t i = 0; i < qdiscs; i++) {
+		uint32_t ifindex = list->entries[i].ifindex;
+
+		if (ifindex == dumped ||
+		    !qdisc_is_classful(list->entries[i].kind)) {
+			continue;
+		}
+		dumped = ifindex;
+
+		memset(&req, 0, sizeof(req));
+		req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.tcm));
+		req.hdr.nlmsg_type  = RTM_GETTCLASS;
+		req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		req.tcm.tcm_ifindex = ifindex;
+
+		err = nl_transact(fd, &req.hdr, qdisc_collect, list);
+
+		/**
+		 * The interface may have gone away since the qdisc dump.
+		 */
+		if (err < 0 && err != -ENODEV) {
+			return err;
+		}
+	}
+
+	qsort(
+	  list->entries, list->count, sizeof(*list->entries), qdisc_compare);
+
+	return 0;
+}
+
+/**
+ * Formats a handle the way tc(8) does: `major:minor`, in hex, with the
+ * minor left out when 0.
+ */
+static void
+qdisc_print_handle(const char* key, uint32_t handle)
+{
+	switch (handle) {
+		case TC_H_ROOT:
+			printf("%s: root\n", key);
+			return;
+		case TC_H_INGRESS:
+			printf("%s: ingress\n", key);
+			return;
+	}
+
+	if (TC_H_MIN(handle) == 0) {
+		printf("%s: %x:\n", key, TC_H_MAJ(handle) >> 16);
+	} else {
+		printf(
+		  "%s: %x:%x\n", key, TC_H_MAJ(handle) >> 16, TC_H_MIN(handle));
+	}
+}
+
+/**
+ * Prints a qdisc or class, with its counters relative to `prev` if any.
+ */
+static void
+qdisc_print(const struct qdisc_entry* entry,
+            const struct qdisc_entry* prev,
+            const char*               iface)
+{
+	printf("%s: %s\n", entry->is_class ? "class" : "qdisc", entry->kind);
+	if (iface != NULL) {
+		printf("iface: %s\n", iface);
+	} else {
+		printf("ifindex: %u\n", entry->ifindex);
+	}
+	qdisc_print_handle("handle", entry->handle);
+	qdisc_print_handle("parent", entry->parent);
+
+	printf("bytes: %llu\n",
+	       (unsigned long long)(entry->bytes - (prev ? prev->bytes : 0)));
+	printf(
+	  "packets: %llu\n",
+	  (unsigned long long)(entry->packets - (prev ? prev->packets : 0)));
+	printf("qlen: %u\n", entry->qlen);
+	printf("backlog: %u\n", entry->backlog);
+
+	/**
+	 * 32-bit counters: unsigned subtraction gets the delta right across a
+	 * wrap.
+	 */
+	printf("drops: %u\n", entry->drops - (prev ? prev->drops : 0));
+	printf("overlimits: %u\n",
+	       entry->overlimits - (prev ? prev->overlimits : 0));
+	printf("requeues: %u\n\n",
+	       entry->requeues - (prev ? prev->requeues : 0));
+}
+
+/**
+ * Whether a qdisc or class queued or dropped since `prev` (or, if it's
+ * new, ever).
+ */
+static int
+qdisc_is_busy(const struct qdisc_entry* entry, const struct qdisc_entry* prev)
+{
+	if (entry->qlen > 0 || entry->backlog > 0) {
+		return 1;
+	}
+
+	if (prev == NULL) {
+		return entry->drops > 0 || entry->overlimits > 0 ||
+		       entry->requeues > 0;
+	}
+
+	return entry->drops != prev->drops ||
+	       entry->overlimits != prev->overlimits ||
+	       entry->requeues != prev->requeues;
+}
+
+static int64_t
+qdisc_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Prints the qdiscs and classes of `cur` that are busy since `prev`.
+ */
+static void
+qdisc_print_busy(const struct qdisc_list* cur,
+                 const struct qdisc_list* prev,
+                 int64_t                  time)
+{
+	struct if_nameindex* ifaces = NULL;
+	size_t               count  = 0;
+	int                  loaded = 0;
+
+	for (size_t i = 0; i < cur->count; i++) {
+		const struct qdisc_entry* entry = &cur->entries[i];
+		const struct qdisc_entry* last  = bsearch(entry,
+                                                         prev->entries,
+                                                         prev->count,
+                                                         sizeof(*entry),
+                                                         qdisc_compare);
+
+		/**
+		 * A qdisc replaced under the same handle starts over.
+		 */
+		if (last != NULL && strcmp(last->kind, entry->kind) != 0) {
+			last = NULL;
+		}
+
+		if (!qdisc_is_busy(entry, last)) {
+			continue;
+		}
+
+		/**
+		 * Names are only needed (and so retrieved) when something is
+		 * printed.
+		 */
+		if (!loaded) {
+			ifaces = kio_if_nameindex_sorted(&count);
+			loaded = 1;
+		}
+
+		printf("time: %lld.%03lld\n",
+		       (long long)(time / 1000),
+		       (long long)(time % 1000));
+		qdisc_print(
+		  entry, last, kio_if_name(ifaces, count, entry->ifindex));
+	}
+
+	if (ifaces != NULL) {
+		if_freenameindex(ifaces);
+	}
+
+	fflush(stdout);
+}
+
+int
+qdisc_run(int interval_ms)
+{
+	struct qdisc_list lists[2] = { 0 };
+	int64_t           tick;
+	int               current = 0;
+	int               fd;
+	int               err;
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	err = qdisc_sample(fd, &lists[current]);
+	if (err < 0) {
+		fprintf(stderr, "cannot dump qdiscs: %s\n", strerror(-err));
+		close(fd);
+		arena_free(&lists[current].arena);
+		return 2;
+	}
+
+	if (interval_ms <= 0) {
+		struct if_nameindex* ifaces;
+		size_t               count;
+
+		close(fd);
+
+		ifaces = kio_if_nameindex_sorted(&count);
+		for (size_t i = 0; i < lists[current].count; i++) {
+			const struct qdisc_entry* entry =
+			  &lists[current].entries[i];
+
+			qdisc_print(entry,
+			            NULL,
+			            kio_if_name(ifaces, count, entry->ifindex));
+		}
+
+		if (ifaces != NULL) {
+			if_freenameindex(ifaces);
+		}
+		arena_free(&lists[current].arena);
+
+		return 0;
+	}
+
+	/**
+	 * Ticks are aligned on multiples of the interval, as with `--series`.
+	 */
+	tick = (qdisc_now_ms() / interval_ms + 1) * interval_ms;
+
+	while (interrupt_signal() == 0) {
+		if (interrupt_sleep_until(tick) == -1) {
+			continue;
+		}
+
+		current ^= 1;
+		err = qdisc_sample(fd, &lists[current]);
+
+		if (err == -ENODATA) {
+			err = 0;
+			break;
+		}
+
+		if (err < 0) {
+			fprintf(
+			  stderr, "cannot dump qdiscs: %s\n", strerror(-err));
+			err = 2;
+			break;
+		}
+
+		qdisc_print_busy(&lists[current], &lists[current ^ 1], tick);
+
+		tick += interval_ms;
+		if (tick <= qdisc_now_ms()) {
+			tick = (qdisc_now_ms() / interval_ms + 1) * interval_ms;
+		}
+	}
+
+	close(fd);
+	arena_free(&lists[0].arena);
+	arena_free(&lists[1].arena);
+
+	return err;
+}
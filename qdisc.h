@@ -0,0 +1,51 @@
+#ifndef IFACER__QDISC_H
+#define IFACER__QDISC_H
+
+/**
+ * qdisc - queueing disciplines and classes of every interface, with their
+ *         backlog, drops, overlimits and requeues (`--qdiscs`), the way
+ *         `tc -s qdisc` and `tc -s class` show them.
+ *
+ * Qdiscs of every interface come from a single RTM_GETQDISC dump. Classes
+ * can only be dumped one interface at a time (RTM_GETTCLASS), so they are
+ * only asked for on the interfaces that have a classful qdisc (htb, hfsc,
+ * prio, mq, ...): a host of veths with their default qdisc costs one
+ * request, not one per interface.
+ *
+ * Counters are read from TCA_STATS2 (TCA_STATS_BASIC and TCA_STATS_QUEUE),
+ * or the older TCA_STATS if a qdisc doesn't report them. Interfaces are
+ * joined by index. Output, one record per qdisc or class:
+ *
+ *      qdisc: fq_codel             class: htb
+ *      iface: eth0                 iface: eth0
+ *      handle: 8001:               handle: 1:10
+ *      parent: root                parent: 1:
+ *      bytes: 81263                ...
+ *      packets: 764
+ *      qlen: 0
+ *      backlog: 0
+ *      drops: 0
+ *      overlimits: 0
+ *      requeues: 0
+ *
+ * with `backlog` in bytes.
+ *
+ * Sampled (`--interval`), both dumps are taken every interval and only the
+ * qdiscs and classes that have something queued or that dropped, went
+ * over limit or requeued since the previous sample are printed, with a
+ * `time:` line and their counters (but `qlen` and `backlog`) as deltas:
+ * busy egress links stand out, idle ones stay quiet. Samples are matched
+ * by interface, handle and parent.
+ */
+
+/**
+ * Prints the qdiscs and classes once, or if `interval_ms` isn't 0, those
+ * that queued or dropped every `interval_ms` milliseconds until
+ * interrupted.
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+qdisc_run(int interval_ms);
+
+#endif
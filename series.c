@@ -0,0 +1,1158 @@
+#define _GNU_SOURCE
+#include "./series.h"
+#include "./interrupt.h"
+#include "./nl.h"
+#include "./strtab.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERIES_MAGIC 0x53544649 /* "IFTS" */
+#define SERIES_VERSION 1
+#define SERIES_NONE UINT32_MAX
+#define SERIES_DEFAULT_INTERVAL_MS 1000
+
+/**
+ * The biggest record there is: a sample whose timestamp is stored raw and
+ * whose counters all open a new window of meaningful bits.
+ */
+#define SERIES_MAX_RECORD_BITS                                                 \
+	(1 + 4 + 64 + SERIES_N_COUNTERS * (2 + 6 + 6 + 64))
+
+static const struct {
+	const char* name;
+	size_t      offset;
+} series_counters[SERIES_N_COUNTERS] = {
+	[SERIES_RX_BYTES]   = { "rx_bytes",
+	                        offsetof(struct rtnl_link_stats64, rx_bytes) },
+	[SERIES_TX_BYTES]   = { "tx_bytes",
+	                        offsetof(struct rtnl_link_stats64, tx_bytes) },
+	[SERIES_RX_PACKETS] = { "rx_packets",
+	                        offsetof(struct rtnl_link_stats64,
+	                                 rx_packets) },
+	[SERIES_TX_PACKETS] = { "tx_packets",
+	                        offsetof(struct rtnl_link_stats64,
+	                                 tx_packets) },
+	[SERIES_RX_ERRORS]  = { "rx_errors",
+	                        offsetof(struct rtnl_link_stats64, rx_errors) },
+	[SERIES_TX_ERRORS]  = { "tx_errors",
+	                        offsetof(struct rtnl_link_stats64, tx_errors) },
+	[SERIES_RX_DROPPED] = { "rx_dropped",
+	                        offsetof(struct rtnl_link_stats64,
+	                                 rx_dropped) },
+	[SERIES_TX_DROPPED] = { "tx_dropped",
+	                        offsetof(struct rtnl_link_stats64,
+	                                 tx_dropped) },
+};
+
+/**
+ * What a chunk holds so far. Only the fields before `checksum` are
+ * covered by it.
+ */
+struct series_commit {
+	uint32_t seq;
+	uint32_t n_samples;
+	uint32_t n_bits;
+	uint32_t checksum;
+	int64_t  last_time;
+};
+
+struct series_chunk {
+	uint32_t             magic;
+	uint32_t             version;
+	char                 name[IFNAMSIZ];
+	int64_t              first_time;
+	struct series_commit commits[2];
+	uint8_t              payload[];
+};
+
+#define SERIES_PAYLOAD_BITS                                                    \
+	((uint32_t)(SERIES_CHUNK_SIZE - sizeof(struct series_chunk)) * 8)
+
+/**
+ * The last sample decoded (or encoded) and what the next one is predicted
+ * to be: same interval, same deltas.
+ */
+struct series_state {
+	int64_t  time;
+	int64_t  delta;
+	uint64_t values[SERIES_N_COUNTERS];
+	uint64_t deltas[SERIES_N_COUNTERS];
+
+	/**
+	 * Window of meaningful bits of the last XOR of each counter (a
+	 * `lead` of 64 meaning there's none yet).
+	 */
+	uint8_t lead[SERIES_N_COUNTERS];
+	uint8_t trail[SERIES_N_COUNTERS];
+};
+
+/**
+ * A position in the payload of a chunk. Readers move it forward sample
+ * by sample; writers keep it at the end of what's been written.
+ */
+struct series_cursor {
+	uint8_t* payload;
+	uint32_t pos;
+	uint32_t n_bits;
+	uint32_t remaining;
+	uint32_t n_samples;
+
+	/**
+	 * Samples left in the run being decoded, and, if the last record is
+	 * a run, the offset of its count and the samples of it seen so far.
+	 */
+	uint32_t run;
+	uint32_t run_pos;
+	uint32_t run_len;
+
+	struct series_state state;
+};
+
+/**
+ * The chunk an interface is filling.
+ */
+struct series_writer {
+	uint32_t             name;
+	off_t                offset;
+	uint32_t             seq;
+	int                  pending; /* samples not committed yet */
+	struct series_chunk* chunk;
+	struct series_cursor cursor;
+};
+
+struct series {
+	int                   fd;
+	off_t                 size;
+	struct strtab         names;
+	struct series_writer* writers;
+	size_t                n_writers;
+	size_t                cap_writers;
+
+	/**
+	 * Index in `writers` of the writer of each name, by the name's id
+	 * (an offset in `names`), or SERIES_NONE.
+	 */
+	uint32_t* by_name;
+	size_t    n_by_name;
+};
+
+static void
+series_put(uint8_t* payload, uint32_t* pos, uint64_t value, unsigned n)
+{
+	while (n > 0) {
+		unsigned room  = 8 - (*pos & 7);
+		unsigned take  = n < room ? n : room;
+		unsigned shift = room - take;
+		unsigned mask  = ((1u << take) - 1) << shift;
+		uint8_t* byte  = &payload[*pos >> 3];
+
+		*byte =
+		  (*byte & ~mask) | (((value >> (n - take)) << shift) & mask);
+		*pos += take;
+		n -= take;
+	}
+}
+
+static int
+series_get(struct series_cursor* cursor, unsigned n, uint64_t* value)
+{
+	uint64_t bits = 0;
+
+	if (cursor->pos + n > cursor->n_bits) {
+		return -1;
+	}
+
+	while (n > 0) {
+		unsigned room = 8 - (cursor->pos & 7);
+		unsigned take = n < room ? n : room;
+		uint8_t  byte = cursor->payload[cursor->pos >> 3];
+
+		bits = (bits << take) |
+		       ((byte >> (room - take)) & ((1u << take) - 1));
+		cursor->pos += take;
+		n -= take;
+	}
+
+	*value = bits;
+	return 0;
+}
+
+/**
+ * Delta-of-delta buckets: a 0 bit for no change, then 2, 3 or 4 bits of
+ * prefix followed by 7, 9 or 12 bits of (biased) value, or 64 raw bits.
+ */
+static void
+series_put_dod(uint8_t* payload, uint32_t* pos, int64_t dod)
+{
+	if (dod == 0) {
+		series_put(payload, pos, 0, 1);
+	} else if (dod >= -63 && dod <= 64) {
+		series_put(payload, pos, 0x2, 2);
+		series_put(payload, pos, dod + 63, 7);
+	} else if (dod >= -255 && dod <= 256) {
+		series_put(payload, pos, 0x6, 3);
+		series_put(payload, pos, dod + 255, 9);
+	} else if (dod >= -2047 && dod <= 2048) {
+		series_put(payload, pos, 0xe, 4);
+		series_put(payload, pos, dod + 2047, 12);
+	} else {
+		series_put(payload, pos, 0xf, 4);
+		series_put(payload, pos, (uint64_t)dod, 64);
+	}
+}
+
+static int
+series_get_dod(struct series_cursor* cursor, int64_t* dod)
+{
+	static const struct {
+		unsigned width;
+		int64_t  bias;
+	} buckets[] = { { 7, 63 }, { 9, 255 }, { 12, 2047 } };
+	uint64_t bit;
+	uint64_t value;
+	unsigned ones = 0;
+
+	while (ones < 4) {
+		if (series_get(cursor, 1, &bit) < 0) {
+			return -1;
+		}
+		if (!bit) {
+			break;
+		}
+		ones++;
+	}
+
+	if (ones == 0) {
+		*dod = 0;
+		return 0;
+	}
+
+	if (ones == 4) {
+		if (series_get(cursor, 64, &value) < 0) {
+			return -1;
+		}
+		*dod = (int64_t)value;
+		return 0;
+	}
+
+	if (series_get(cursor, buckets[ones - 1].width, &value) < 0) {
+		return -1;
+	}
+
+	*dod = (int64_t)value - buckets[ones - 1].bias;
+	return 0;
+}
+
+/**
+ * A 0 bit for no change, `10` and the meaningful bits if they fit in the
+ * previous window, `11`, the new window (6 bits of leading zeroes, 6 of
+ * length) and the meaningful bits otherwise.
+ */
+static void
+series_put_xor(uint8_t*  payload,
+               uint32_t* pos,
+               uint64_t  x,
+               uint8_t*  lead,
+               uint8_t*  trail)
+{
+	unsigned l;
+	unsigned t;
+
+	if (x == 0) {
+		series_put(payload, pos, 0, 1);
+		return;
+	}
+
+	l = __builtin_clzll(x);
+	t = __builtin_ctzll(x);
+
+	if (l >= *lead && t >= *trail) {
+		series_put(payload, pos, 0x2, 2);
+		series_put(payload, pos, x >> *trail, 64 - *lead - *trail);
+		return;
+	}
+
+	series_put(payload, pos, 0x3, 2);
+	series_put(payload, pos, l, 6);
+	series_put(payload, pos, 64 - l - t - 1, 6);
+	series_put(payload, pos, x >> t, 64 - l - t);
+	*lead  = l;
+	*trail = t;
+}
+
+static int
+series_get_xor(struct series_cursor* cursor,
+               uint64_t*             x,
+               uint8_t*              lead,
+               uint8_t*              trail)
+{
+	uint64_t bit;
+	uint64_t l;
+	uint64_t len;
+	uint64_t value;
+
+	if (series_get(cursor, 1, &bit) < 0) {
+		return -1;
+	}
+
+	if (!bit) {
+		*x = 0;
+		return 0;
+	}
+
+	if (series_get(cursor, 1, &bit) < 0) {
+		return -1;
+	}
+
+	if (!bit) {
+		if (*lead >= 64 ||
+		    series_get(cursor, 64 - *lead - *trail, &value) < 0) {
+			return -1;
+		}
+		*x = value << *trail;
+		return 0;
+	}
+
+	if (series_get(cursor, 6, &l) < 0 || series_get(cursor, 6, &len) < 0) {
+		return -1;
+	}
+
+	len++;
+	if (l + len > 64 || series_get(cursor, len, &value) < 0) {
+		return -1;
+	}
+
+	*lead  = l;
+	*trail = 64 - l - len;
+	*x     = value << *trail;
+	return 0;
+}
+
+static void
+series_state_first(struct series_state*        state,
+                   const struct series_sample* sample)
+{
+	*state      = (struct series_state){ 0 };
+	state->time = sample->time;
+	memcpy(state->values, sample->values, sizeof(state->values));
+	memset(state->lead, 64, sizeof(state->lead));
+}
+
+static void
+series_state_next(struct series_state*        state,
+                  const struct series_sample* sample)
+{
+	state->delta = sample->time - state->time;
+	state->time  = sample->time;
+
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		state->deltas[c] = sample->values[c] - state->values[c];
+		state->values[c] = sample->values[c];
+	}
+}
+
+static void
+series_state_predict(struct series_state* state)
+{
+	state->time += state->delta;
+
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		state->values[c] += state->deltas[c];
+	}
+}
+
+static void
+series_cursor_init(struct series_cursor* cursor,
+                   uint8_t*              payload,
+                   uint32_t              n_bits,
+                   uint32_t              n_samples)
+{
+	*cursor           = (struct series_cursor){ 0 };
+	cursor->payload   = payload;
+	cursor->n_bits    = n_bits;
+	cursor->remaining = n_samples;
+	cursor->run_pos   = SERIES_NONE;
+}
+
+/**
+ * Decodes the next sample into `sample`.
+ *
+ * Returns 1, 0 when every committed sample has been decoded or -1 if the
+ * payload is corrupt.
+ */
+static int
+series_next(struct series_cursor* cursor, struct series_sample* sample)
+{
+	struct series_state* state = &cursor->state;
+	uint64_t             value;
+
+	if (cursor->remaining == 0) {
+		return 0;
+	}
+
+	if (cursor->n_samples == 0) {
+		if (series_get(cursor, 64, &value) < 0) {
+			return -1;
+		}
+		sample->time = (int64_t)value;
+
+		for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+			if (series_get(cursor, 64, &sample->values[c]) < 0) {
+				return -1;
+			}
+		}
+
+		series_state_first(state, sample);
+	} else if (cursor->run > 0) {
+		cursor->run--;
+		cursor->run_len++;
+		series_state_predict(state);
+	} else {
+		if (series_get(cursor, 1, &value) < 0) {
+			return -1;
+		}
+
+		if (!value) {
+			cursor->run_pos = cursor->pos;
+			if (series_get(cursor, 32, &value) < 0 || value == 0) {
+				return -1;
+			}
+
+			cursor->run     = value - 1;
+			cursor->run_len = 1;
+			series_state_predict(state);
+		} else {
+			int64_t dod;
+
+			cursor->run_pos = SERIES_NONE;
+			if (series_get_dod(cursor, &dod) < 0) {
+				return -1;
+			}
+
+			state->delta += dod;
+			state->time += state->delta;
+
+			for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+				uint64_t x;
+
+				if (series_get_xor(cursor,
+				                   &x,
+				                   &state->lead[c],
+				                   &state->trail[c]) < 0) {
+					return -1;
+				}
+
+				state->deltas[c] ^= x;
+				state->values[c] += state->deltas[c];
+			}
+		}
+	}
+
+	cursor->remaining--;
+	cursor->n_samples++;
+
+	sample->time = state->time;
+	memcpy(sample->values, state->values, sizeof(sample->values));
+	return 1;
+}
+
+static uint32_t
+series_checksum(const struct series_commit* commit)
+{
+	const unsigned char* bytes = (const unsigned char*)commit;
+	uint32_t             hash  = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(*commit); i++) {
+		if (i >= offsetof(struct series_commit, checksum) &&
+		    i < offsetof(struct series_commit, checksum) +
+		          sizeof(commit->checksum)) {
+			continue;
+		}
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * The most recent valid commit of `chunk` (NULL if none is).
+ */
+static const struct series_commit*
+series_latest(const struct series_chunk* chunk)
+{
+	const struct series_commit* latest = NULL;
+
+	for (int i = 0; i < 2; i++) {
+		const struct series_commit* commit = &chunk->commits[i];
+
+		if (commit->seq == 0 ||
+		    commit->checksum != series_checksum(commit) ||
+		    commit->n_bits > SERIES_PAYLOAD_BITS) {
+			continue;
+		}
+
+		if (latest == NULL || commit->seq > latest->seq) {
+			latest = commit;
+		}
+	}
+
+	return latest;
+}
+
+/**
+ * Publishes what the writer's cursor covers, in the slot of the older
+ * commit. The payload is written before the commit that covers it.
+ */
+static void
+series_commit(struct series_writer* writer)
+{
+	struct series_commit commit = {
+		.seq       = ++writer->seq,
+		.n_samples = writer->cursor.n_samples,
+		.n_bits    = writer->cursor.pos,
+		.last_time = writer->cursor.state.time,
+	};
+
+	commit.checksum = series_checksum(&commit);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	writer->chunk->commits[commit.seq & 1] = commit;
+	writer->pending                        = 0;
+}
+
+int
+series_sync(struct series* series)
+{
+	int pending = 0;
+
+	for (size_t i = 0; i < series->n_writers && !pending; i++) {
+		pending = series->writers[i].pending;
+	}
+
+	if (!pending) {
+		return 0;
+	}
+
+	if (fdatasync(series->fd) == -1) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < series->n_writers; i++) {
+		if (series->writers[i].pending) {
+			series_commit(&series->writers[i]);
+		}
+	}
+
+	return fdatasync(series->fd);
+}
+
+static struct series_writer*
+series_writer(struct series* series, const char* name)
+{
+	struct series_writer* writer;
+	uint32_t              id;
+
+	id = strtab_intern(&series->names, name, strnlen(name, IFNAMSIZ - 1));
+	if (id == STRTAB_NONE) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (id >= series->n_by_name) {
+		size_t    n = series->names.len;
+		uint32_t* by_name =
+		  realloc(series->by_name, n * sizeof(*by_name));
+
+		if (by_name == NULL) {
+			return NULL;
+		}
+
+		for (size_t i = series->n_by_name; i < n; i++) {
+			by_name[i] = SERIES_NONE;
+		}
+
+		series->by_name   = by_name;
+		series->n_by_name = n;
+	}
+
+	if (series->by_name[id] != SERIES_NONE) {
+		return &series->writers[series->by_name[id]];
+	}
+
+	if (series->n_writers == series->cap_writers) {
+		size_t cap = series->cap_writers ? series->cap_writers * 2 : 64;
+
+		writer = realloc(series->writers, cap * sizeof(*writer));
+		if (writer == NULL) {
+			return NULL;
+		}
+
+		series->writers     = writer;
+		series->cap_writers = cap;
+	}
+
+	series->by_name[id] = series->n_writers;
+	writer              = &series->writers[series->n_writers++];
+	*writer = (struct series_writer){ .name = id, .offset = -1 };
+	return writer;
+}
+
+static int
+series_map(struct series* series, struct series_writer* writer)
+{
+	struct series_chunk* chunk = mmap(NULL,
+	                                  SERIES_CHUNK_SIZE,
+	                                  PROT_READ | PROT_WRITE,
+	                                  MAP_SHARED,
+	                                  series->fd,
+	                                  writer->offset);
+
+	if (chunk == MAP_FAILED) {
+		return -1;
+	}
+
+	if (writer->chunk != NULL) {
+		munmap(writer->chunk, SERIES_CHUNK_SIZE);
+	}
+
+	writer->chunk = chunk;
+	return 0;
+}
+
+/**
+ * Appends a new chunk to the file for the writer of `name`. The space is
+ * allocated up front, so that running out of disk is an error here rather
+ * than a SIGBUS when the mapping is written to.
+ */
+static int
+series_chunk_new(struct series* series, struct series_writer* writer)
+{
+	const char* name = strtab_get(&series->names, writer->name);
+	int         err;
+
+	/**
+	 * What the chunk being left holds is committed first: its mapping
+	 * is about to go.
+	 */
+	if (writer->pending && series_sync(series) < 0) {
+		return -1;
+	}
+
+	err = posix_fallocate(series->fd, series->size, SERIES_CHUNK_SIZE);
+	if (err != 0) {
+		errno = err;
+		return -1;
+	}
+
+	writer->offset = series->size;
+	if (series_map(series, writer) < 0) {
+		return -1;
+	}
+
+	series->size += SERIES_CHUNK_SIZE;
+	writer->seq = 0;
+	series_cursor_init(
+	  &writer->cursor, writer->chunk->payload, SERIES_PAYLOAD_BITS, 0);
+
+	memcpy(writer->chunk->name, name, strlen(name));
+	writer->chunk->version = SERIES_VERSION;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	writer->chunk->magic = SERIES_MAGIC;
+
+	return 0;
+}
+
+/**
+ * Decodes the chunk a writer was filling to get back to the state it was
+ * left in.
+ */
+static void
+series_resume(struct series_writer* writer)
+{
+	const struct series_commit* latest = series_latest(writer->chunk);
+	struct series_cursor*       cursor = &writer->cursor;
+	struct series_sample        sample;
+	int                         err;
+
+	series_cursor_init(cursor,
+	                   writer->chunk->payload,
+	                   latest != NULL ? latest->n_bits : 0,
+	                   latest != NULL ? latest->n_samples : 0);
+	writer->seq = latest != NULL ? latest->seq : 0;
+
+	while ((err = series_next(cursor, &sample)) > 0) {
+	}
+
+	if (err < 0) {
+		munmap(writer->chunk, SERIES_CHUNK_SIZE);
+		writer->chunk = NULL;
+		return;
+	}
+
+	/**
+	 * A run's count is bumped before the commit that covers the new
+	 * sample: after a crash in between, it's brought back to what was
+	 * committed.
+	 */
+	if (cursor->run > 0) {
+		uint32_t pos = cursor->run_pos;
+
+		series_put(cursor->payload, &pos, cursor->run_len, 32);
+		cursor->run = 0;
+	}
+
+	cursor->n_bits = SERIES_PAYLOAD_BITS;
+}
+
+struct series*
+series_open(const char* path)
+{
+	struct series* series = calloc(1, sizeof(*series));
+	struct stat    st;
+	int            err;
+
+	if (series == NULL) {
+		return NULL;
+	}
+
+	series->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (series->fd == -1 || fstat(series->fd, &st) == -1) {
+		goto fail;
+	}
+
+	/**
+	 * A chunk only partially added to the file (e.g., disk full) is
+	 * dropped.
+	 */
+	series->size = st.st_size - st.st_size % SERIES_CHUNK_SIZE;
+	if (series->size != st.st_size &&
+	    ftruncate(series->fd, series->size) == -1) {
+		goto fail;
+	}
+
+	for (off_t offset = 0; offset < series->size;
+	     offset += SERIES_CHUNK_SIZE) {
+		struct series_chunk   chunk;
+		struct series_writer* writer;
+
+		if (pread(series->fd, &chunk, sizeof(chunk), offset) !=
+		    sizeof(chunk)) {
+			goto fail;
+		}
+
+		if (chunk.magic != SERIES_MAGIC ||
+		    chunk.version != SERIES_VERSION) {
+			continue;
+		}
+
+		writer = series_writer(series, chunk.name);
+		if (writer == NULL) {
+			goto fail;
+		}
+
+		writer->offset = offset;
+	}
+
+	for (size_t i = 0; i < series->n_writers; i++) {
+		if (series_map(series, &series->writers[i]) < 0) {
+			goto fail;
+		}
+
+		series_resume(&series->writers[i]);
+	}
+
+	return series;
+
+fail:
+	err = errno;
+	series_close(series);
+	errno = err;
+	return NULL;
+}
+
+int
+series_append(struct series*              series,
+              const char*                 name,
+              const struct series_sample* sample)
+{
+	struct series_writer* writer = series_writer(series, name);
+	struct series_cursor* cursor;
+	struct series_state*  state;
+
+	if (writer == NULL) {
+		return -1;
+	}
+
+	cursor = &writer->cursor;
+	state  = &cursor->state;
+
+	if (writer->chunk != NULL && cursor->n_samples > 0) {
+		int64_t  dod = (sample->time - state->time) - state->delta;
+		int      predicted = dod == 0;
+		uint64_t xs[SERIES_N_COUNTERS];
+
+		for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+			xs[c] = (sample->values[c] - state->values[c]) ^
+			        state->deltas[c];
+			predicted &= xs[c] == 0;
+		}
+
+		if (predicted && cursor->run_pos != SERIES_NONE &&
+		    cursor->run_len < UINT32_MAX) {
+			uint32_t pos = cursor->run_pos;
+
+			series_put(
+			  cursor->payload, &pos, ++cursor->run_len, 32);
+			goto commit;
+		}
+
+		if (cursor->pos + SERIES_MAX_RECORD_BITS <= cursor->n_bits) {
+			if (predicted) {
+				series_put(cursor->payload, &cursor->pos, 0, 1);
+				cursor->run_pos = cursor->pos;
+				cursor->run_len = 1;
+				series_put(
+				  cursor->payload, &cursor->pos, 1, 32);
+				goto commit;
+			}
+
+			series_put(cursor->payload, &cursor->pos, 1, 1);
+			series_put_dod(cursor->payload, &cursor->pos, dod);
+
+			for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+				series_put_xor(cursor->payload,
+				               &cursor->pos,
+				               xs[c],
+				               &state->lead[c],
+				               &state->trail[c]);
+			}
+
+			cursor->run_pos = SERIES_NONE;
+			goto commit;
+		}
+	}
+
+	/**
+	 * First sample of a chunk: a new one, unless the last chunk of this
+	 * interface never got a sample committed.
+	 */
+	if (writer->chunk == NULL || cursor->n_samples > 0) {
+		if (series_chunk_new(series, writer) < 0) {
+			return -1;
+		}
+	}
+
+	writer->chunk->first_time = sample->time;
+	series_put(cursor->payload, &cursor->pos, (uint64_t)sample->time, 64);
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		series_put(
+		  cursor->payload, &cursor->pos, sample->values[c], 64);
+	}
+
+	series_state_first(state, sample);
+	cursor->n_samples++;
+	writer->pending = 1;
+	return 0;
+
+commit:
+	series_state_next(state, sample);
+	cursor->n_samples++;
+	writer->pending = 1;
+	return 0;
+}
+
+void
+series_close(struct series* series)
+{
+	if (series == NULL) {
+		return;
+	}
+
+	series_sync(series);
+
+	for (size_t i = 0; i < series->n_writers; i++) {
+		if (series->writers[i].chunk != NULL) {
+			munmap(series->writers[i].chunk, SERIES_CHUNK_SIZE);
+		}
+	}
+
+	if (series->fd != -1) {
+		close(series->fd);
+	}
+
+	strtab_free(&series->names);
+	free(series->writers);
+	free(series->by_name);
+	free(series);
+}
+
+int
+series_query(const char* path,
+             const char* name,
+             int64_t     from,
+             int64_t     to,
+             int (*fn)(const char* name, const struct series_sample*, void*),
+             void* data)
+{
+	struct stat st;
+	uint8_t*    map;
+	off_t       size;
+	int         fd;
+	int         ret = 0;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	size = st.st_size - st.st_size % SERIES_CHUNK_SIZE;
+	if (size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+
+	madvise(map, size, MADV_SEQUENTIAL);
+
+	for (off_t offset = 0; offset < size && ret == 0;
+	     offset += SERIES_CHUNK_SIZE) {
+		struct series_chunk* chunk =
+		  (struct series_chunk*)(map + offset);
+		const struct series_commit* latest;
+		struct series_cursor        cursor;
+		struct series_sample        sample;
+		char                        chunk_name[IFNAMSIZ];
+
+		if (chunk->magic != SERIES_MAGIC ||
+		    chunk->version != SERIES_VERSION) {
+			continue;
+		}
+
+		latest = series_latest(chunk);
+		if (latest == NULL) {
+			continue;
+		}
+
+		/**
+		 * Chunks that aren't about the interface or the span asked
+		 * for are skipped without touching their payload.
+		 */
+		memcpy(chunk_name, chunk->name, sizeof(chunk_name));
+		chunk_name[IFNAMSIZ - 1] = '\0';
+		if (name != NULL && strcmp(chunk_name, name) != 0) {
+			continue;
+		}
+
+		if (latest->last_time < from || chunk->first_time > to) {
+			continue;
+		}
+
+		series_cursor_init(
+		  &cursor, chunk->payload, latest->n_bits, latest->n_samples);
+
+		while (ret == 0 && series_next(&cursor, &sample) > 0) {
+			if (sample.time > to) {
+				break;
+			}
+
+			if (sample.time >= from) {
+				ret = fn(chunk_name, &sample, data);
+			}
+		}
+	}
+
+	munmap(map, size);
+	return ret;
+}
+
+struct series_sampler {
+	struct series* series;
+	int64_t        time;
+};
+
+static int
+series_link_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct series_sampler*   sampler = data;
+	const struct ifinfomsg*  ifi     = NLMSG_DATA(msg);
+	struct rtnl_link_stats64 stats   = { 0 };
+	struct series_sample     sample  = { .time = sampler->time };
+	const struct nlattr*     tb[IFLA_MAX + 1];
+	size_t                   len;
+
+	if (msg->nlmsg_type != RTM_NEWLINK) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+	if (tb[IFLA_IFNAME] == NULL || tb[IFLA_STATS64] == NULL) {
+		return 0;
+	}
+
+	/**
+	 * The structure has grown over kernel releases; whatever the
+	 * kernel doesn't know about stays zeroed.
+	 */
+	len = nl_attr_len(tb[IFLA_STATS64]);
+	memcpy(&stats,
+	       nl_attr_data(tb[IFLA_STATS64]),
+	       len < sizeof(stats) ? len : sizeof(stats));
+
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		memcpy(&sample.values[c],
+		       (const char*)&stats + series_counters[c].offset,
+		       sizeof(sample.values[c]));
+	}
+
+	if (series_append(
+	      sampler->series, nl_attr_str(tb[IFLA_IFNAME]), &sample) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int64_t
+series_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+int
+series_run(const char* path, int interval_ms)
+{
+	struct series_sampler sampler = { 0 };
+	int64_t               tick;
+	int                   fd;
+
+	if (interval_ms <= 0) {
+		interval_ms = SERIES_DEFAULT_INTERVAL_MS;
+	}
+
+	sampler.series = series_open(path);
+	if (sampler.series == NULL) {
+		perror("cannot open series");
+		return 1;
+	}
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		perror("cannot open netlink socket");
+		series_close(sampler.series);
+		return 1;
+	}
+
+	/**
+	 * Samples are taken on multiples of the interval and stamped with
+	 * the tick they were taken for (rather than when the answer came
+	 * back), so that a steady interval has a delta-of-delta of 0.
+	 */
+	tick = (series_now_ms() / interval_ms + 1) * interval_ms;
+
+	while (interrupt_signal() == 0) {
+		struct {
+			struct nlmsghdr  hdr;
+			struct ifinfomsg ifi;
+		} req = { 0 };
+		int err;
+
+		if (interrupt_sleep_until(tick) == -1) {
+			continue;
+		}
+
+		req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifi));
+		req.hdr.nlmsg_type  = RTM_GETLINK;
+		req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+		sampler.time = tick;
+		err = nl_transact(fd, &req.hdr, series_link_cb, &sampler);
+
+		if (err == -ENODATA) {
+			break;
+		}
+
+		if (err < 0) {
+			errno = -err;
+			perror("cannot sample counters");
+			close(fd);
+			series_close(sampler.series);
+			return 2;
+		}
+
+		if (series_sync(sampler.series) < 0) {
+			perror("cannot sync series");
+			close(fd);
+			series_close(sampler.series);
+			return 2;
+		}
+
+		/**
+		 * Ticks that were missed (e.g., the host was suspended) are
+		 * skipped rather than made up for.
+		 */
+		tick += interval_ms;
+		if (tick <= series_now_ms()) {
+			tick =
+			  (series_now_ms() / interval_ms + 1) * interval_ms;
+		}
+	}
+
+	close(fd);
+	series_close(sampler.series);
+	return 0;
+}
+
+static int
+series_print(const char* name, const struct series_sample* sample, void* data)
+{
+	(void)data;
+
+	printf("iface: %s\n", name);
+	printf("time: %lld.%03lld\n",
+	       (long long)(sample->time / 1000),
+	       (long long)(sample->time % 1000));
+
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		printf("%s: %llu\n",
+		       series_counters[c].name,
+		       (unsigned long long)sample->values[c]);
+	}
+
+	printf("\n");
+	return 0;
+}
+
+int
+series_query_run(const char* path, const char* name, int64_t from, int64_t to)
+{
+	if (series_query(path, name, from, to, series_print, NULL) == -1) {
+		perror("cannot read series");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+#ifndef IFACER__SERIES_H
+#define IFACER__SERIES_H
+
+/**
+ * series - an on-disk history of interface counters (`--series`,
+ *          `--query`).
+ *
+ * A series file is a sequence of fixed-size chunks (SERIES_CHUNK_SIZE
+ * bytes), each holding the samples of one interface over a span of time:
+ *
+ *      +--------+-------+------------+----------+----------+------------+
+ *      | magic  | name  | first_time | commit 0 | commit 1 | payload... |
+ *      +--------+-------+------------+----------+----------+------------+
+ *
+ * The payload is a bit stream compressed in the spirit of Facebook's
+ * Gorilla:
+ *
+ *   - the first sample is stored as is (64-bit time and counters);
+ *   - timestamps are stored as the difference between consecutive deltas
+ *     (delta-of-delta), which is 0 (a single bit) for a steady interval;
+ *   - each counter is stored as the XOR between its delta and the previous
+ *     delta, with the meaningful bits only (reusing the previous window of
+ *     leading/trailing zeroes when it fits), so a counter growing at a
+ *     steady rate costs a single bit; and
+ *   - a run of samples that are all exactly as predicted (same interval,
+ *     same rates, e.g., an idle interface) is a single record with a
+ *     32-bit count that's bumped in place.
+ *
+ * Writes are append-only through a shared mapping of the chunk being
+ * filled. Samples only become visible once committed: the number of
+ * samples, of payload bits and the last timestamp go to the older of two
+ * commit slots of the chunk header, with a sequence number and a checksum,
+ * and readers only trust what a valid commit covers.
+ *
+ * Commits are batched (`series_sync`, once per tick when sampling): the
+ * file is synced (fdatasync(2)) so that the payload appended to every
+ * chunk is on disk, then every commit slot is written, then the file is
+ * synced again. A crash or a power loss leaves either the new commit or
+ * the previous one intact, covering a payload that made it to disk, at the
+ * cost of two syncs per tick however many interfaces there are.
+ *
+ * Chunk headers tell the time span they cover, so range queries skip whole
+ * chunks without decoding them.
+ */
+
+#include <stdint.h>
+
+#define SERIES_CHUNK_SIZE 4096
+
+enum series_counter {
+	SERIES_RX_BYTES = 0,
+	SERIES_TX_BYTES,
+	SERIES_RX_PACKETS,
+	SERIES_TX_PACKETS,
+	SERIES_RX_ERRORS,
+	SERIES_TX_ERRORS,
+	SERIES_RX_DROPPED,
+	SERIES_TX_DROPPED,
+	SERIES_N_COUNTERS,
+};
+
+struct series_sample {
+	int64_t  time; /* milliseconds since the epoch */
+	uint64_t values[SERIES_N_COUNTERS];
+};
+
+struct series;
+
+/**
+ * Opens (creating it if needed) the series file at `path` for appending,
+ * picking up the chunk each interface was filling.
+ *
+ * Returns NULL with errno set on failure.
+ */
+struct series*
+series_open(const char* path);
+
+/**
+ * Appends a sample of the interface `name`. Samples of an interface must
+ * come in time order.
+ *
+ * Returns 0 or -1 with errno set.
+ */
+int
+series_append(struct series*              series,
+              const char*                 name,
+              const struct series_sample* sample);
+
+/**
+ * Commits the samples appended since the last call, once they're on disk.
+ *
+ * Returns 0 or -1 with errno set.
+ */
+int
+series_sync(struct series* series);
+
+/**
+ * Commits what's left (see `series_sync`) and closes the file.
+ */
+void
+series_close(struct series* series);
+
+/**
+ * Calls `fn` for each sample of the file at `path` taken within
+ * [`from`, `to`] (milliseconds since the epoch), of the interface `name`
+ * or of every interface if NULL. Samples come chunk after chunk, each
+ * chunk in time order.
+ *
+ * Returns 0, the first non-zero value returned by `fn` or -1 with errno
+ * set.
+ */
+int
+series_query(const char* path,
+             const char* name,
+             int64_t     from,
+             int64_t     to,
+             int (*fn)(const char* name, const struct series_sample*, void*),
+             void* data);
+
+/**
+ * Samples the counters of every interface each `interval_ms` (1000 if
+ * 0) into the file at `path` until interrupted.
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+series_run(const char* path, int interval_ms);
+
+/**
+ * Prints the samples of `path` within [`from`, `to`] (milliseconds since
+ * the epoch) of the interface `name` (every interface if NULL).
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+series_query_run(const char* path, const char* name, int64_t from, int64_t to);
+
+#endif
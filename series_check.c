@@ -0,0 +1,263 @@
+/**
+ * series_check - writes samples of many interfaces to a series file and
+ *                reads them back (`make check-series`).
+ *
+ * Counters are generated so as to go through every path of the codec:
+ * idle interfaces (runs), interfaces growing at a steady rate (runs and
+ * single-bit records), and interfaces with random traffic (windows of
+ * meaningful bits opened and reused). Every 97th tick comes late, so that
+ * timestamps also need a delta-of-delta.
+ *
+ * The file is closed and reopened twice on the way, to resume the chunks
+ * being filled, and a child process appends a tick (bumping runs in place,
+ * and with some counters off) and dies without committing it, as in a
+ * crash: reading back must give exactly the samples that were committed.
+ *
+ * Usage: series_check.out FILE [INTERFACES [SAMPLES]]
+ */
+
+#include "./series.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SERIES_CHECK_START 1700000000000LL
+
+struct series_check {
+	int       n_ifaces;
+	int       n_samples;
+	int       last; /* the sample idle interfaces stop being idle at */
+	int*      seen;
+	uint64_t* totals; /* of the random counters, as read back */
+	long long errors;
+};
+
+static uint64_t
+series_check_random(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+/**
+ * The sample `k` of the interface `i`, given the totals of its random
+ * counters up to the previous one (`totals`, updated). Samples of an
+ * interface must be asked for in order.
+ */
+static void
+series_check_sample(int                   i,
+                    int                   k,
+                    int                   last,
+                    uint64_t*             totals,
+                    struct series_sample* sample)
+{
+	sample->time =
+	  SERIES_CHECK_START + (int64_t)k * 1000 + (k % 97 == 0 ? 3 : 0);
+
+	for (int c = 0; c < SERIES_N_COUNTERS; c++) {
+		switch (i % 3) {
+			case 0:
+				sample->values[c] = 1000 + c + (k == last);
+				break;
+			case 1:
+				sample->values[c] = (uint64_t)(i + c + 1) * k;
+				break;
+			default:
+				totals[c] +=
+				  series_check_random((uint64_t)i << 40 |
+				                      (uint64_t)c << 32 | k) %
+				  100000;
+				sample->values[c] = totals[c];
+		}
+	}
+}
+
+/**
+ * Appends the sample `k` of every interface. The one a crash loses
+ * (`crash`) has idle interfaces still idle, so their runs are bumped, and
+ * the first counter of those with random traffic off.
+ */
+static int
+series_check_append(struct series*             series,
+                    const struct series_check* check,
+                    int                        k,
+                    uint64_t*                  totals,
+                    int                        crash)
+{
+	int n_ifaces = check->n_ifaces;
+
+	for (int i = 0; i < n_ifaces; i++) {
+		struct series_sample sample;
+		char                 name[16];
+
+		series_check_sample(i,
+		                    k,
+		                    crash ? -1 : check->last,
+		                    &totals[(size_t)i * SERIES_N_COUNTERS],
+		                    &sample);
+		if (crash && i % 3 == 2) {
+			sample.values[0] += 12345;
+		}
+		snprintf(name, sizeof(name), "if%d", i);
+		if (series_append(series, name, &sample) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+series_check_cb(const char* name, const struct series_sample* got, void* data)
+{
+	struct series_check* check = data;
+	struct series_sample want;
+	int                  i = atoi(name + 2);
+	int                  k;
+
+	if (i < 0 || i >= check->n_ifaces ||
+	    check->seen[i] >= check->n_samples) {
+		check->errors++;
+		return 0;
+	}
+
+	k = check->seen[i]++;
+	series_check_sample(i,
+	                    k,
+	                    check->last,
+	                    &check->totals[(size_t)i * SERIES_N_COUNTERS],
+	                    &want);
+	if (memcmp(&want, got, sizeof(want)) != 0 && check->errors++ < 10) {
+		fprintf(stderr, "%s: sample %d differs\n", name, k);
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	struct series_check check = { .n_ifaces = 500, .n_samples = 20000 };
+	struct series*      series;
+	struct stat         st;
+	uint64_t*           totals;
+	pid_t               child;
+	int                 status;
+
+	if (argc < 2) {
+		fprintf(
+		  stderr, "usage: %s FILE [INTERFACES [SAMPLES]]\n", argv[0]);
+		return 1;
+	}
+
+	if (argc > 2) {
+		check.n_ifaces = atoi(argv[2]);
+	}
+
+	if (argc > 3) {
+		check.n_samples = atoi(argv[3]);
+	}
+
+	check.last = check.n_samples;
+
+	totals =
+	  calloc((size_t)check.n_ifaces * SERIES_N_COUNTERS, sizeof(*totals));
+	check.totals = calloc((size_t)check.n_ifaces * SERIES_N_COUNTERS,
+	                      sizeof(*check.totals));
+	check.seen   = calloc(check.n_ifaces, sizeof(*check.seen));
+	if (totals == NULL || check.totals == NULL || check.seen == NULL) {
+		perror("calloc");
+		return 1;
+	}
+
+	unlink(argv[1]);
+	series = series_open(argv[1]);
+
+	for (int k = 0; k < check.n_samples && series != NULL; k++) {
+		if (series_check_append(series, &check, k, totals, 0) < 0 ||
+		    series_sync(series) < 0) {
+			perror("cannot append");
+			return 1;
+		}
+
+		/**
+		 * Chunks being filled are picked up again twice.
+		 */
+		if (k == check.n_samples / 3 || k == 2 * check.n_samples / 3) {
+			series_close(series);
+			series = series_open(argv[1]);
+		}
+	}
+
+	if (series == NULL) {
+		perror("cannot open series");
+		return 1;
+	}
+
+	/**
+	 * A tick that's appended but never committed: its runs are bumped in
+	 * place, its records written past the commits.
+	 */
+	child = fork();
+	if (child == 0) {
+		series_check_append(series, &check, check.last, totals, 1);
+		_exit(0);
+	}
+
+	if (child == -1 || waitpid(child, &status, 0) != child) {
+		perror("cannot fork");
+		return 1;
+	}
+
+	/**
+	 * The child's mapping is shared: what it wrote is in the file, and
+	 * only the commits tell it apart. Appending goes on from the last
+	 * commit.
+	 */
+	series_close(series);
+	series = series_open(argv[1]);
+	if (series == NULL ||
+	    series_check_append(series, &check, check.last, totals, 0) < 0 ||
+	    series_sync(series) < 0) {
+		perror("cannot append after a crash");
+		return 1;
+	}
+	series_close(series);
+	check.n_samples++;
+
+	if (series_query(
+	      argv[1], NULL, INT64_MIN, INT64_MAX, series_check_cb, &check) <
+	    0) {
+		perror("cannot read series");
+		return 1;
+	}
+
+	for (int i = 0; i < check.n_ifaces; i++) {
+		if (check.seen[i] != check.n_samples && check.errors++ < 10) {
+			fprintf(stderr,
+			        "if%d: %d samples read back, %d written\n",
+			        i,
+			        check.seen[i],
+			        check.n_samples);
+		}
+	}
+
+	stat(argv[1], &st);
+	printf("%d interfaces x %d samples: %lld bytes, %.1f bytes per sample, "
+	       "%lld errors\n",
+	       check.n_ifaces,
+	       check.n_samples,
+	       (long long)st.st_size,
+	       (double)st.st_size / check.n_ifaces / check.n_samples,
+	       check.errors);
+
+	return check.errors != 0;
+}
@@ -0,0 +1,603 @@
+/**
+ * shim - `getifaddrs(3)`, `freeifaddrs(3)`, `if_nameindex(3)` and
+ *        `if_freenameindex(3)` built on ifacer's netlink helpers, to be
+ *        LD_PRELOADed into daemons that poll them:
+ *
+ *      make shim
+ *      LD_PRELOAD=./libifacer.so some-daemon
+ *
+ * glibc's `getifaddrs` dumps links and addresses on every call and hands
+ * out a list made of many small allocations. Here the answer of each dump
+ * is kept as the raw netlink messages (in a scratch buffer) and, once we
+ * know how many entries there are, the whole list is laid out in a single
+ * allocation of fixed-size slots (entry, addresses, name and link
+ * statistics), so building it costs one `malloc` and freeing it one
+ * `free`. `if_nameindex` is served the same way from a link dump.
+ *
+ * With `IFACER_SHIM_TTL_MS` set, the last list built by `getifaddrs` is
+ * handed out again (reference counted, so it is only freed when neither
+ * the cache nor any caller holds it) to every call made within that many
+ * milliseconds, making polling within the window free. Callers sharing a
+ * cached list must treat it as read-only, which is what every caller of
+ * `getifaddrs` does in practice.
+ *
+ * The list follows glibc's layout: one AF_PACKET entry per link (hardware
+ * address, broadcast address and `struct rtnl_link_stats` in `ifa_data`)
+ * followed by one AF_INET / AF_INET6 entry per address.
+ *
+ * Everything but the functions above is hidden (-fvisibility=hidden) so the
+ * helpers don't clash with symbols of the host program.
+ */
+
+#include "./nl.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <ifaddrs.h>
+#include <linux/if_packet.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHIM_EXPORT __attribute__((visibility("default")))
+
+union shim_addr {
+	struct sockaddr     sa;
+	struct sockaddr_in  in;
+	struct sockaddr_in6 in6;
+	struct sockaddr_ll  ll;
+};
+
+/**
+ * One entry of the list and everything it points to.
+ */
+struct shim_slot {
+	struct ifaddrs         ifa;
+	union shim_addr        addr;
+	union shim_addr        netmask;
+	union shim_addr        broadaddr;
+	struct rtnl_link_stats stats;
+	char                   name[IFNAMSIZ];
+};
+
+/**
+ * Lives right before the first slot; `freeifaddrs` finds it from the
+ * head of the list.
+ */
+struct shim_list {
+	int              refs;
+	size_t           count;
+	struct shim_slot slots[];
+};
+
+/**
+ * The raw answer of a dump: the messages, back to back.
+ */
+struct shim_dump {
+	char*  data;
+	size_t len;
+	size_t cap;
+	size_t count;
+};
+
+static struct {
+	pthread_mutex_t   lock;
+	struct shim_list* cached;
+	uint64_t          cached_at_ms;
+	long              ttl_ms;
+	int               ttl_read;
+} shim = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t
+shim_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int
+shim_dump_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct shim_dump* dump = data;
+	size_t            len  = NLMSG_ALIGN(msg->nlmsg_len);
+
+	if (dump->len + len > dump->cap) {
+		size_t cap    = dump->cap ? dump->cap * 2 : NL_BUFSIZE;
+		char*  bigger = NULL;
+
+		while (cap < dump->len + len) {
+			cap *= 2;
+		}
+
+		bigger = realloc(dump->data, cap);
+		if (bigger == NULL) {
+			return -ENOMEM;
+		}
+
+		dump->data = bigger;
+		dump->cap  = cap;
+	}
+
+	memcpy(dump->data + dump->len, msg, msg->nlmsg_len);
+	dump->len += len;
+	dump->count++;
+
+	return 0;
+}
+
+/**
+ * Dumps every link (RTM_GETLINK) or address (RTM_GETADDR) into `dump`.
+ */
+static int
+shim_dump(int fd, uint16_t type, struct shim_dump* dump)
+{
+	struct {
+		struct nlmsghdr hdr;
+		union {
+			struct ifinfomsg ifi;
+			struct ifaddrmsg ifa;
+		};
+	} req = { 0 };
+
+	req.hdr.nlmsg_len =
+	  NLMSG_LENGTH(type == RTM_GETLINK ? sizeof(struct ifinfomsg)
+	                                   : sizeof(struct ifaddrmsg));
+	req.hdr.nlmsg_type  = type;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	dump->len   = 0;
+	dump->count = 0;
+
+	return nl_transact(fd, &req.hdr, shim_dump_cb, dump);
+}
+
+#define shim_dump_for_each(msg, dump)                                          \
+	for (const struct nlmsghdr* msg = (const void*)(dump)->data;           \
+	     (const char*)msg < (dump)->data + (dump)->len;                    \
+	     msg =                                                             \
+	       (const void*)((const char*)msg + NLMSG_ALIGN(msg->nlmsg_len)))
+
+static void
+shim_netmask(union shim_addr* mask, int family, unsigned prefixlen)
+{
+	unsigned char* bytes;
+	size_t         len;
+
+	if (family == AF_INET) {
+		mask->in.sin_family = AF_INET;
+		bytes               = (unsigned char*)&mask->in.sin_addr;
+		len                 = 4;
+	} else {
+		mask->in6.sin6_family = AF_INET6;
+		bytes                 = (unsigned char*)&mask->in6.sin6_addr;
+		len                   = 16;
+	}
+
+	for (size_t i = 0; i < len && prefixlen > 0; i++) {
+		unsigned bits = prefixlen < 8 ? prefixlen : 8;
+
+		bytes[i] = 0xff << (8 - bits);
+		prefixlen -= bits;
+	}
+}
+
+static void
+shim_inet(union shim_addr*     addr,
+          int                  family,
+          uint32_t             ifindex,
+          const struct nlattr* attr)
+{
+	if (family == AF_INET && nl_attr_len(attr) >= 4) {
+		addr->in.sin_family = AF_INET;
+		memcpy(&addr->in.sin_addr, nl_attr_data(attr), 4);
+	} else if (family == AF_INET6 && nl_attr_len(attr) >= 16) {
+		addr->in6.sin6_family = AF_INET6;
+		memcpy(&addr->in6.sin6_addr, nl_attr_data(attr), 16);
+		if (IN6_IS_ADDR_LINKLOCAL(&addr->in6.sin6_addr) ||
+		    IN6_IS_ADDR_MC_LINKLOCAL(&addr->in6.sin6_addr)) {
+			addr->in6.sin6_scope_id = ifindex;
+		}
+	}
+}
+
+/**
+ * Fills `slot` with the AF_PACKET entry of the link in `msg`.
+ */
+static void
+shim_fill_link(struct shim_slot* slot, const struct nlmsghdr* msg)
+{
+	const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFLA_MAX + 1];
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+
+	if (tb[IFLA_IFNAME] != NULL) {
+		size_t len =
+		  strnlen(nl_attr_str(tb[IFLA_IFNAME]), IFNAMSIZ - 1);
+
+		memcpy(slot->name, nl_attr_data(tb[IFLA_IFNAME]), len);
+	}
+
+	slot->addr.ll.sll_family  = AF_PACKET;
+	slot->addr.ll.sll_ifindex = ifi->ifi_index;
+	slot->addr.ll.sll_hatype  = ifi->ifi_type;
+	slot->broadaddr.ll        = slot->addr.ll;
+
+	if (tb[IFLA_ADDRESS] != NULL) {
+		size_t len = nl_attr_len(tb[IFLA_ADDRESS]);
+
+		len = len < sizeof(slot->addr.ll.sll_addr)
+		        ? len
+		        : sizeof(slot->addr.ll.sll_addr);
+		memcpy(
+		  slot->addr.ll.sll_addr, nl_attr_data(tb[IFLA_ADDRESS]), len);
+		slot->addr.ll.sll_halen = len;
+	}
+
+	if (tb[IFLA_BROADCAST] != NULL) {
+		size_t len = nl_attr_len(tb[IFLA_BROADCAST]);
+
+		len = len < sizeof(slot->broadaddr.ll.sll_addr)
+		        ? len
+		        : sizeof(slot->broadaddr.ll.sll_addr);
+		memcpy(slot->broadaddr.ll.sll_addr,
+		       nl_attr_data(tb[IFLA_BROADCAST]),
+		       len);
+		slot->broadaddr.ll.sll_halen = len;
+		slot->ifa.ifa_broadaddr      = &slot->broadaddr.sa;
+	}
+
+	if (tb[IFLA_STATS] != NULL &&
+	    nl_attr_len(tb[IFLA_STATS]) >= sizeof(slot->stats)) {
+		memcpy(&slot->stats,
+		       nl_attr_data(tb[IFLA_STATS]),
+		       sizeof(slot->stats));
+	}
+
+	slot->ifa.ifa_name  = slot->name;
+	slot->ifa.ifa_flags = ifi->ifi_flags;
+	slot->ifa.ifa_addr  = &slot->addr.sa;
+	slot->ifa.ifa_data  = &slot->stats;
+}
+
+static int
+shim_slot_cmp(const void* a, const void* b)
+{
+	const struct shim_slot* const* x = a;
+	const struct shim_slot* const* y = b;
+
+	return (*x)->addr.ll.sll_ifindex - (*y)->addr.ll.sll_ifindex;
+}
+
+/**
+ * Fills `slot` with the entry of the address in `msg`, taking the name
+ * and flags from its link. Returns -1 if the address has no link (e.g., it
+ * came and went between the two dumps).
+ */
+static int
+shim_fill_addr(struct shim_slot*        slot,
+               const struct nlmsghdr*   msg,
+               struct shim_slot* const* links,
+               size_t                   n_links)
+{
+	const struct ifaddrmsg* ifa = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFA_MAX + 1];
+	const struct nlattr*    local;
+	const struct nlattr*    address;
+	struct shim_slot        key = { .addr.ll.sll_ifindex = ifa->ifa_index };
+	struct shim_slot*       keyp = &key;
+	struct shim_slot* const* link;
+
+	if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6) {
+		return -1;
+	}
+
+	link = bsearch(&keyp, links, n_links, sizeof(*links), shim_slot_cmp);
+	if (link == NULL) {
+		return -1;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+	local   = tb[IFA_LOCAL];
+	address = tb[IFA_ADDRESS];
+	if (local == NULL && address == NULL) {
+		return -1;
+	}
+
+	/**
+	 * IFA_LOCAL is our address and IFA_ADDRESS the peer's (the same one
+	 * but on point-to-point links); like glibc, the latter goes in
+	 * `ifa_dstaddr` unless there's a broadcast address to put there
+	 * instead (IPv6 only has IFA_ADDRESS).
+	 */
+	if (local != NULL && address != NULL) {
+		shim_inet(&slot->addr, ifa->ifa_family, ifa->ifa_index, local);
+		shim_inet(
+		  &slot->broadaddr, ifa->ifa_family, ifa->ifa_index, address);
+		slot->ifa.ifa_dstaddr = &slot->broadaddr.sa;
+	} else {
+		shim_inet(&slot->addr,
+		          ifa->ifa_family,
+		          ifa->ifa_index,
+		          local != NULL ? local : address);
+	}
+
+	if (tb[IFA_BROADCAST] != NULL) {
+		shim_inet(&slot->broadaddr,
+		          ifa->ifa_family,
+		          ifa->ifa_index,
+		          tb[IFA_BROADCAST]);
+		slot->ifa.ifa_broadaddr = &slot->broadaddr.sa;
+	}
+
+	if (slot->addr.sa.sa_family == AF_UNSPEC) {
+		return -1;
+	}
+
+	shim_netmask(&slot->netmask, ifa->ifa_family, ifa->ifa_prefixlen);
+
+	if (ifa->ifa_family == AF_INET && tb[IFA_LABEL] != NULL) {
+		size_t len = strnlen(nl_attr_str(tb[IFA_LABEL]), IFNAMSIZ - 1);
+
+		memcpy(slot->name, nl_attr_data(tb[IFA_LABEL]), len);
+	} else {
+		memcpy(slot->name, (*link)->name, IFNAMSIZ);
+	}
+
+	slot->ifa.ifa_name    = slot->name;
+	slot->ifa.ifa_flags   = (*link)->ifa.ifa_flags;
+	slot->ifa.ifa_addr    = &slot->addr.sa;
+	slot->ifa.ifa_netmask = &slot->netmask.sa;
+
+	return 0;
+}
+
+/**
+ * Lays out the links and addresses dumped into a single allocation.
+ */
+static struct shim_list*
+shim_build(const struct shim_dump* links, const struct shim_dump* addrs)
+{
+	struct shim_list*  list;
+	struct shim_slot** sorted;
+	size_t             n_links;
+	size_t             n = 0;
+
+	list   = calloc(1,
+                      sizeof(*list) +
+                        (links->count + addrs->count) * sizeof(list->slots[0]));
+	sorted = malloc((links->count ? links->count : 1) * sizeof(*sorted));
+	if (list == NULL || sorted == NULL) {
+		free(list);
+		free(sorted);
+		return NULL;
+	}
+
+	shim_dump_for_each(msg, links)
+	{
+		if (msg->nlmsg_type == RTM_NEWLINK) {
+			shim_fill_link(&list->slots[n], msg);
+			sorted[n] = &list->slots[n];
+			n++;
+		}
+	}
+
+	n_links = n;
+	qsort(sorted, n_links, sizeof(*sorted), shim_slot_cmp);
+
+	shim_dump_for_each(msg, addrs)
+	{
+		if (msg->nlmsg_type == RTM_NEWADDR &&
+		    shim_fill_addr(&list->slots[n], msg, sorted, n_links) ==
+		      0) {
+			n++;
+		}
+	}
+
+	free(sorted);
+
+	for (size_t i = 0; i + 1 < n; i++) {
+		list->slots[i].ifa.ifa_next = &list->slots[i + 1].ifa;
+	}
+
+	list->count = n;
+	list->refs  = 1;
+	return list;
+}
+
+static struct shim_list*
+shim_load(void)
+{
+	struct shim_dump  links = { 0 };
+	struct shim_dump  addrs = { 0 };
+	struct shim_list* list  = NULL;
+	int               fd;
+	int               err;
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		return NULL;
+	}
+
+	err = shim_dump(fd, RTM_GETLINK, &links);
+	if (err == 0) {
+		err = shim_dump(fd, RTM_GETADDR, &addrs);
+	}
+
+	if (err == 0) {
+		list = shim_build(&links, &addrs);
+		err  = list == NULL ? -ENOMEM : 0;
+	}
+
+	close(fd);
+	free(links.data);
+	free(addrs.data);
+
+	if (err != 0) {
+		errno = -err;
+	}
+
+	return list;
+}
+
+static struct shim_list*
+shim_list_of(struct ifaddrs* ifa)
+{
+	return (struct shim_list*)((char*)ifa -
+	                           offsetof(struct shim_list, slots));
+}
+
+static void
+shim_release(struct shim_list* list)
+{
+	if (__atomic_sub_fetch(&list->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		free(list);
+	}
+}
+
+SHIM_EXPORT int
+getifaddrs(struct ifaddrs** ifap)
+{
+	struct shim_list* list;
+	uint64_t          now = 0;
+
+	pthread_mutex_lock(&shim.lock);
+	if (!shim.ttl_read) {
+		const char* ttl = getenv("IFACER_SHIM_TTL_MS");
+
+		shim.ttl_ms   = ttl != NULL ? atol(ttl) : 0;
+		shim.ttl_read = 1;
+	}
+
+	if (shim.ttl_ms > 0) {
+		now = shim_now_ms();
+		if (shim.cached != NULL &&
+		    now - shim.cached_at_ms < (uint64_t)shim.ttl_ms) {
+			list = shim.cached;
+			__atomic_add_fetch(&list->refs, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&shim.lock);
+			goto out;
+		}
+	}
+	pthread_mutex_unlock(&shim.lock);
+
+	list = shim_load();
+	if (list == NULL) {
+		return -1;
+	}
+
+	if (shim.ttl_ms > 0) {
+		struct shim_list* stale;
+
+		__atomic_add_fetch(&list->refs, 1, __ATOMIC_RELAXED);
+
+		pthread_mutex_lock(&shim.lock);
+		stale             = shim.cached;
+		shim.cached       = list;
+		shim.cached_at_ms = now;
+		pthread_mutex_unlock(&shim.lock);
+
+		if (stale != NULL) {
+			shim_release(stale);
+		}
+	}
+
+out:
+	*ifap = list->count > 0 ? &list->slots[0].ifa : NULL;
+	if (*ifap == NULL) {
+		shim_release(list);
+	}
+
+	return 0;
+}
+
+SHIM_EXPORT void
+freeifaddrs(struct ifaddrs* ifa)
+{
+	if (ifa != NULL) {
+		shim_release(shim_list_of(ifa));
+	}
+}
+
+static int
+shim_count_links_cb(const struct nlmsghdr* msg, void* data)
+{
+	return msg->nlmsg_type == RTM_NEWLINK ? shim_dump_cb(msg, data) : 0;
+}
+
+SHIM_EXPORT struct if_nameindex*
+if_nameindex(void)
+{
+	struct shim_dump     links = { 0 };
+	struct if_nameindex* ifaces;
+	char*                names;
+	size_t               n = 0;
+	int                  fd;
+	int                  err;
+	struct {
+		struct nlmsghdr  hdr;
+		struct ifinfomsg ifi;
+	} req = { 0 };
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		return NULL;
+	}
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifi));
+	req.hdr.nlmsg_type  = RTM_GETLINK;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	err = nl_transact(fd, &req.hdr, shim_count_links_cb, &links);
+	close(fd);
+	if (err != 0) {
+		free(links.data);
+		errno = -err;
+		return NULL;
+	}
+
+	/**
+	 * The array (terminated by a zeroed entry) followed by the names.
+	 */
+	ifaces = calloc(1, (links.count + 1) * (sizeof(*ifaces) + IFNAMSIZ));
+	if (ifaces == NULL) {
+		free(links.data);
+		return NULL;
+	}
+
+	names = (char*)(ifaces + links.count + 1);
+	shim_dump_for_each(msg, &links)
+	{
+		const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+		const struct nlattr*    tb[IFLA_MAX + 1];
+
+		nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+		if (tb[IFLA_IFNAME] == NULL) {
+			continue;
+		}
+
+		ifaces[n].if_index = ifi->ifi_index;
+		ifaces[n].if_name  = names + n * IFNAMSIZ;
+		memcpy(ifaces[n].if_name,
+		       nl_attr_data(tb[IFLA_IFNAME]),
+		       strnlen(nl_attr_str(tb[IFLA_IFNAME]), IFNAMSIZ - 1));
+		n++;
+	}
+
+	free(links.data);
+	return ifaces;
+}
+
+SHIM_EXPORT void
+if_freenameindex(struct if_nameindex* ifaces)
+{
+	free(ifaces);
+}
@@ -0,0 +1,388 @@
+#include "./sockdiag.h"
+#include "./kio.h"
+#include "./nl.h"
+#include "./tally.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/inet_diag.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Socket states go from TCP_ESTABLISHED (1) to TCP_NEW_SYN_RECV (12).
+ */
+#define SOCKDIAG_N_STATES 13
+
+static const char* const sockdiag_state_names[SOCKDIAG_N_STATES] = {
+	[1] = "established", [2] = "syn-sent",   [3] = "syn-recv",
+	[4] = "fin-wait-1",  [5] = "fin-wait-2", [6] = "time-wait",
+	[7] = "close",       [8] = "close-wait", [9] = "last-ack",
+	[10] = "listen",     [11] = "closing",   [12] = "new-syn-recv",
+};
+
+struct sockdiag_key {
+	uint8_t  proto; /* IPPROTO_TCP or IPPROTO_UDP */
+	uint8_t  family;
+	uint16_t pad;
+	uint8_t  addr[16];
+	uint32_t ifindex; /* bound interface, 0 if none */
+};
+
+struct sockdiag_entry {
+	struct sockdiag_key key;
+	uint64_t            counts[SOCKDIAG_N_STATES];
+};
+
+/**
+ * The entries of the keys seen so far.
+ */
+struct sockdiag_table {
+	struct tally entries;
+	uint8_t      proto; /* of the dump in progress */
+};
+
+struct sockdiag_local {
+	int      family;
+	uint8_t  addr[16];
+	uint32_t ifindex;
+};
+
+struct sockdiag_locals {
+	struct sockdiag_local* addrs;
+	size_t                 count;
+	size_t                 cap;
+};
+
+/**
+ * Counts a socket of the dump.
+ */
+static int
+sockdiag_count(const struct nlmsghdr* msg, void* data)
+{
+	struct sockdiag_table*      table = data;
+	const struct inet_diag_msg* diag  = NLMSG_DATA(msg);
+	struct sockdiag_key         key   = { 0 };
+	struct sockdiag_entry*      entry;
+
+	if (msg->nlmsg_type != SOCK_DIAG_BY_FAMILY ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*diag)) ||
+	    diag->idiag_state >= SOCKDIAG_N_STATES) {
+		return 0;
+	}
+
+	key.proto   = table->proto;
+	key.family  = diag->idiag_family;
+	key.ifindex = diag->id.idiag_if;
+	memcpy(
+	  key.addr, diag->id.idiag_src, diag->idiag_family == AF_INET ? 4 : 16);
+
+	entry = tally_get(&table->entries, &key);
+	if (entry == NULL) {
+		return -ENOMEM;
+	}
+
+	entry->counts[diag->idiag_state]++;
+	return 0;
+}
+
+static int
+sockdiag_dump(int                    fd,
+              struct sockdiag_table* table,
+              int                    family,
+              int                    proto,
+              uint32_t               states)
+{
+	struct {
+		struct nlmsghdr         hdr;
+		struct inet_diag_req_v2 req;
+	} req = { 0 };
+
+	req.hdr.nlmsg_len      = sizeof(req);
+	req.hdr.nlmsg_type     = SOCK_DIAG_BY_FAMILY;
+	req.hdr.nlmsg_flags    = NLM_F_REQUEST | NLM_F_DUMP;
+	req.req.sdiag_family   = family;
+	req.req.sdiag_protocol = proto;
+	req.req.idiag_states   = states;
+
+	table->proto = proto;
+
+	return nl_transact(fd, &req.hdr, sockdiag_count, table);
+}
+
+static int
+sockdiag_collect_local(const struct nlmsghdr* msg, void* data)
+{
+	struct sockdiag_locals* locals = data;
+	const struct ifaddrmsg* ifa    = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFA_MAX + 1];
+	const struct nlattr*    local;
+	struct sockdiag_local*  entry;
+
+	if (msg->nlmsg_type != RTM_NEWADDR ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa))) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifa), tb, IFA_MAX);
+
+	local = tb[IFA_LOCAL] != NULL ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	if (local == NULL || nl_attr_len(local) > sizeof(entry->addr)) {
+		return 0;
+	}
+
+	if (locals->count == locals->cap) {
+		size_t                 cap = locals->cap ? locals->cap * 2 : 64;
+		struct sockdiag_local* addrs =
+		  realloc(locals->addrs, cap * sizeof(*addrs));
+
+		if (addrs == NULL) {
+			return -ENOMEM;
+		}
+
+		locals->addrs = addrs;
+		locals->cap   = cap;
+	}
+
+	entry  = &locals->addrs[locals->count++];
+	*entry = (struct sockdiag_local){
+		.family  = ifa->ifa_family,
+		.ifindex = ifa->ifa_index,
+	};
+	memcpy(entry->addr, nl_attr_data(local), nl_attr_len(local));
+
+	return 0;
+}
+
+/**
+ * The interface of a key: the one the socket is bound to, or the one its
+ * local address is assigned to.
+ *
+ * Returns NULL if there's none.
+ */
+static const char*
+sockdiag_iface(const struct sockdiag_key*    key,
+               const struct sockdiag_locals* locals,
+               const struct if_nameindex*    ifaces,
+               size_t                        count)
+{
+	static const uint8_t v4_mapped[12] = { [10] = 0xff, [11] = 0xff };
+	static const uint8_t any[16]       = { 0 };
+	int                  family        = key->family;
+	const uint8_t*       addr          = key->addr;
+	uint32_t             ifindex       = key->ifindex;
+
+	if (family == AF_INET6 && !memcmp(addr, v4_mapped, sizeof(v4_mapped))) {
+		family = AF_INET;
+		addr += sizeof(v4_mapped);
+	}
+
+	if (ifindex == 0) {
+		if (!memcmp(addr, any, family == AF_INET ? 4 : 16)) {
+			return "*";
+		}
+
+		for (size_t i = 0; i < locals->count && ifindex == 0; i++) {
+			if (locals->addrs[i].family == family &&
+			    !memcmp(locals->addrs[i].addr,
+			            addr,
+			            family == AF_INET ? 4 : 16)) {
+				ifindex = locals->addrs[i].ifindex;
+			}
+		}
+	}
+
+	return kio_if_name(ifaces, count, ifindex);
+}
+
+static int
+sockdiag_compare(const void* a, const void* b)
+{
+	const struct sockdiag_key* x = &((const struct sockdiag_entry*)a)->key;
+	const struct sockdiag_key* y = &((const struct sockdiag_entry*)b)->key;
+
+	if (x->proto != y->proto) {
+		return x->proto == IPPROTO_TCP ? -1 : 1;
+	}
+
+	return memcmp(&x->family, &y->family, sizeof(*x) - sizeof(x->proto));
+}
+
+static void
+sockdiag_print(struct sockdiag_table*        table,
+               const struct sockdiag_locals* locals,
+               const struct if_nameindex*    ifaces,
+               size_t                        count)
+{
+	size_t n = tally_sort(&table->entries, sockdiag_compare);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct sockdiag_entry* entry =
+		  tally_at(&table->entries, i);
+		const char* iface =
+		  sockdiag_iface(&entry->key, locals, ifaces, count);
+		char     ip[INET6_ADDRSTRLEN];
+		uint64_t total = 0;
+
+		inet_ntop(entry->key.family, entry->key.addr, ip, sizeof(ip));
+
+		printf("proto: %s\n",
+		       entry->key.proto == IPPROTO_TCP ? "tcp" : "udp");
+		printf("ip: %s\n", ip);
+		if (iface != NULL) {
+			printf("iface: %s\n", iface);
+		}
+
+		for (int state = 1; state < SOCKDIAG_N_STATES; state++) {
+			if (entry->counts[state] > 0) {
+				printf(
+				  "%s: %llu\n",
+				  sockdiag_state_names[state],
+				  (unsigned long long)entry->counts[state]);
+				total += entry->counts[state];
+			}
+		}
+
+		printf("total: %llu\n\n", (unsigned long long)total);
+	}
+}
+
+/**
+ * Turns a comma-separated list of state names into the bitmask the kernel
+ * filters with (a bit per state).
+ *
+ * Returns 0 if a name is unknown.
+ */
+static uint32_t
+sockdiag_parse_states(const char* list)
+{
+	uint32_t states = 0;
+
+	if (list == NULL) {
+		return (1u << SOCKDIAG_N_STATES) - 2;
+	}
+
+	while (*list != '\0') {
+		size_t len   = strcspn(list, ",");
+		int    state = 1;
+
+		while (state < SOCKDIAG_N_STATES &&
+		       (strlen(sockdiag_state_names[state]) != len ||
+		        strncmp(sockdiag_state_names[state], list, len) != 0)) {
+			state++;
+		}
+
+		if (state == SOCKDIAG_N_STATES) {
+			fprintf(stderr,
+			        "unknown socket state: %.*s\n",
+			        (int)len,
+			        list);
+			return 0;
+		}
+
+		states |= 1u << state;
+		list += len + (list[len] == ',');
+	}
+
+	return states;
+}
+
+int
+sockdiag_run(const char* states_list)
+{
+	static const int families[] = { AF_INET, AF_INET6 };
+	static const int protos[]   = { IPPROTO_TCP, IPPROTO_UDP };
+
+	struct sockdiag_table table = {
+		.entries = { .size    = sizeof(struct sockdiag_entry),
+		             .key_len = sizeof(struct sockdiag_key) },
+	};
+	struct sockdiag_locals locals = { 0 };
+	struct if_nameindex*   ifaces;
+	size_t                 count;
+	struct {
+		struct nlmsghdr  hdr;
+		struct ifaddrmsg ifa;
+	} req = { 0 };
+	uint32_t states;
+	int      fd;
+	int      err = 0;
+
+	states = sockdiag_parse_states(states_list);
+	if (states == 0) {
+		return 1;
+	}
+
+	fd = nl_open(NETLINK_SOCK_DIAG, 0);
+	if (fd == -1) {
+		perror("cannot open sock_diag socket");
+		return 1;
+	}
+
+	for (size_t f = 0; f < 2 && err == 0; f++) {
+		for (size_t p = 0; p < 2 && err == 0; p++) {
+			err = sockdiag_dump(
+			  fd, &table, families[f], protos[p], states);
+
+			/**
+			 * The protocol's diag module isn't there (e.g.,
+			 * udp_diag isn't loaded).
+			 */
+			if (err == -ENOENT) {
+				err = 0;
+			}
+		}
+	}
+
+	close(fd);
+
+	if (err < 0) {
+		fprintf(stderr, "cannot dump sockets: %s\n", strerror(-err));
+		tally_free(&table.entries);
+		return 2;
+	}
+
+	/**
+	 * Local addresses and interface names are only needed to resolve
+	 * the keys, however many sockets there were.
+	 */
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		perror("cannot open netlink socket");
+		tally_free(&table.entries);
+		return 1;
+	}
+
+	req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifa));
+	req.hdr.nlmsg_type  = RTM_GETADDR;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+	err = nl_transact(fd, &req.hdr, sockdiag_collect_local, &locals);
+	close(fd);
+
+	if (err < 0) {
+		fprintf(stderr, "cannot dump addresses: %s\n", strerror(-err));
+		free(locals.addrs);
+		tally_free(&table.entries);
+		return 2;
+	}
+
+	ifaces = kio_if_nameindex_sorted(&count);
+
+	sockdiag_print(&table, &locals, ifaces, count);
+
+	if (ifaces != NULL) {
+		if_freenameindex(ifaces);
+	}
+	free(locals.addrs);
+	tally_free(&table.entries);
+
+	return 0;
+}
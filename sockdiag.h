@@ -0,0 +1,43 @@
+#ifndef IFACER__SOCKDIAG_H
+#define IFACER__SOCKDIAG_H
+
+/**
+ * sockdiag - how many TCP and UDP sockets, in which states, use each local
+ *            address (`--sockets`).
+ *
+ * Sockets are dumped with NETLINK_SOCK_DIAG (`man 7 sock_diag`), one
+ * SOCK_DIAG_BY_FAMILY request per family and protocol. The states asked
+ * for (`--states`) are filtered by the kernel, so sockets in other states
+ * never cross into userspace, and no extension is requested: each socket
+ * is a bare `struct inet_diag_msg`.
+ *
+ * Sockets are never kept: each one is counted as it streams by, into a
+ * hash table keyed by protocol, local address and bound interface (the
+ * one set with SO_BINDTODEVICE, if any). Only the keys are resolved to
+ * interfaces at the end: the bound interface, or the interface the local
+ * address is assigned to (`*` for wildcard addresses).
+ *
+ * Output, one record per key:
+ *
+ *      proto: tcp
+ *      ip: 192.0.2.2
+ *      iface: eth0
+ *      established: 1032
+ *      time-wait: 87
+ *      total: 1119
+ *
+ * with a line for each state that has sockets, named as in
+ * `include/net/tcp_states.h` (UDP sockets are `close` when unconnected,
+ * `established` when connected).
+ */
+
+/**
+ * Counts the sockets in the states listed in `states` (comma-separated,
+ * every state if NULL) and prints them.
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+sockdiag_run(const char* states);
+
+#endif
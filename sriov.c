@@ -0,0 +1,299 @@
+#include "./sriov.h"
+#include "./kio.h"
+#include "./nl.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Size of the address field of `struct ifla_vf_mac`.
+ */
+#define SRIOV_MAC_MAX 32
+
+static const char* const sriov_link_states[] = {
+	[IFLA_VF_LINK_STATE_AUTO]    = "auto",
+	[IFLA_VF_LINK_STATE_ENABLE]  = "enable",
+	[IFLA_VF_LINK_STATE_DISABLE] = "disable",
+};
+
+static const struct {
+	int         type;
+	const char* name;
+} sriov_stats[] = {
+	{ IFLA_VF_STATS_RX_BYTES, "rx-bytes" },
+	{ IFLA_VF_STATS_RX_PACKETS, "rx-packets" },
+	{ IFLA_VF_STATS_RX_DROPPED, "rx-dropped" },
+	{ IFLA_VF_STATS_TX_BYTES, "tx-bytes" },
+	{ IFLA_VF_STATS_TX_PACKETS, "tx-packets" },
+	{ IFLA_VF_STATS_TX_DROPPED, "tx-dropped" },
+	{ IFLA_VF_STATS_BROADCAST, "broadcast" },
+	{ IFLA_VF_STATS_MULTICAST, "multicast" },
+};
+
+/**
+ * Copies the payload of `attr` into `dst` (`size` bytes, zeroed first),
+ * however long either is.
+ */
+static void
+sriov_copy(void* dst, size_t size, const struct nlattr* attr)
+{
+	size_t len = nl_attr_len(attr);
+
+	memset(dst, 0, size);
+	memcpy(dst, nl_attr_data(attr), len < size ? len : size);
+}
+
+/**
+ * Prints a setting that drivers report as (uint32_t)-1 when they don't
+ * support it.
+ */
+static void
+sriov_print_flag(const char* key, const struct nlattr* attr)
+{
+	struct ifla_vf_trust setting; /* same layout as ifla_vf_spoofchk */
+
+	if (attr == NULL) {
+		return;
+	}
+
+	sriov_copy(&setting, sizeof(setting), attr);
+	if (setting.setting != (uint32_t)-1) {
+		printf("%s: %s\n", key, setting.setting ? "on" : "off");
+	}
+}
+
+static void
+sriov_print_vf(const char* name, const struct nlattr* info, size_t mac_len)
+{
+	const struct nlattr* tb[IFLA_VF_MAX + 1];
+	struct ifla_vf_mac   mac;
+
+	nl_attr_parse_nested(info, tb, IFLA_VF_MAX);
+
+	/**
+	 * Every VF has a MAC attribute, which is also where its number is.
+	 */
+	if (tb[IFLA_VF_MAC] == NULL) {
+		return;
+	}
+
+	sriov_copy(&mac, sizeof(mac), tb[IFLA_VF_MAC]);
+
+	printf("iface: %s\n", name);
+	printf("vf: %u\n", mac.vf);
+	printf("mac: ");
+	for (size_t i = 0; i < mac_len; i++) {
+		printf(i == 0 ? "%02x" : ":%02x", mac.mac[i]);
+	}
+	printf("\n");
+
+	if (tb[IFLA_VF_VLAN] != NULL) {
+		struct ifla_vf_vlan vlan;
+
+		sriov_copy(&vlan, sizeof(vlan), tb[IFLA_VF_VLAN]);
+		if (vlan.vlan != 0) {
+			printf("vlan: %u\n", vlan.vlan);
+			printf("qos: %u\n", vlan.qos);
+		}
+	}
+
+	sriov_print_flag("spoof-check", tb[IFLA_VF_SPOOFCHK]);
+	sriov_print_flag("trust", tb[IFLA_VF_TRUST]);
+
+	if (tb[IFLA_VF_LINK_STATE] != NULL) {
+		struct ifla_vf_link_state state;
+
+		sriov_copy(&state, sizeof(state), tb[IFLA_VF_LINK_STATE]);
+		if (state.link_state <= IFLA_VF_LINK_STATE_DISABLE) {
+			printf("link-state: %s\n",
+			       sriov_link_states[state.link_state]);
+		}
+	}
+
+	if (tb[IFLA_VF_RATE] != NULL) {
+		struct ifla_vf_rate rate;
+
+		sriov_copy(&rate, sizeof(rate), tb[IFLA_VF_RATE]);
+		printf("max-tx-rate: %u\n", rate.max_tx_rate);
+		printf("min-tx-rate: %u\n", rate.min_tx_rate);
+	}
+
+	if (tb[IFLA_VF_STATS] != NULL) {
+		const struct nlattr* stats[IFLA_VF_STATS_MAX + 1];
+
+		nl_attr_parse_nested(
+		  tb[IFLA_VF_STATS], stats, IFLA_VF_STATS_MAX);
+
+		for (size_t i = 0;
+		     i < sizeof(sriov_stats) / sizeof(*sriov_stats);
+		     i++) {
+			const struct nlattr* stat = stats[sriov_stats[i].type];
+
+			if (stat != NULL &&
+			    nl_attr_len(stat) >= sizeof(uint64_t)) {
+				printf("%s: %llu\n",
+				       sriov_stats[i].name,
+				       (unsigned long long)nl_attr_u64(stat));
+			}
+		}
+	}
+
+	printf("\n");
+}
+
+/**
+ * Prints the VFs listed in the answer about a physical function.
+ */
+static int
+sriov_print_link(const struct nlmsghdr* msg, void* data)
+{
+	const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFLA_MAX + 1];
+	const struct nlattr*    info;
+	const char*             name    = data;
+	size_t                  mac_len = 6;
+
+	if (msg->nlmsg_type != RTM_NEWLINK ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi))) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+
+	if (tb[IFLA_VFINFO_LIST] == NULL) {
+		return 0;
+	}
+
+	if (tb[IFLA_IFNAME] != NULL) {
+		name = nl_attr_str(tb[IFLA_IFNAME]);
+	}
+
+	/**
+	 * VF addresses come in 32-byte fields; they're as long as the
+	 * physical function's.
+	 */
+	if (tb[IFLA_ADDRESS] != NULL &&
+	    nl_attr_len(tb[IFLA_ADDRESS]) <= SRIOV_MAC_MAX) {
+		mac_len = nl_attr_len(tb[IFLA_ADDRESS]);
+	}
+
+	nl_attr_for_each_nested(info, tb[IFLA_VFINFO_LIST])
+	{
+		if ((info->nla_type & NLA_TYPE_MASK) == IFLA_VF_INFO) {
+			sriov_print_vf(name, info, mac_len);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Number of VFs enabled on an interface, according to sysfs: 0 if it
+ * isn't a physical function, -1 if sysfs can't tell.
+ */
+static int
+sriov_numvfs(int sysfs, const char* name)
+{
+	char    path[IFNAMSIZ + sizeof("/device/sriov_numvfs")];
+	char    value[16];
+	ssize_t n;
+	int     fd;
+
+	if (sysfs == -1) {
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/device/sriov_numvfs", name);
+	fd = openat(sysfs, path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return 0;
+	}
+
+	n = read(fd, value, sizeof(value) - 1);
+	close(fd);
+	if (n <= 0) {
+		return 0;
+	}
+
+	value[n] = '\0';
+	return atoi(value);
+}
+
+int
+sriov_run(void)
+{
+	struct if_nameindex* ifaces;
+	uint32_t             mask = RTEXT_FILTER_VF;
+	int                  sysfs;
+	int                  fd;
+	int                  err = 0;
+
+	ifaces = kio_if_nameindex();
+	if (ifaces == NULL) {
+		perror("if_nameindex failed");
+		return 2;
+	}
+
+	fd = nl_open(NETLINK_ROUTE, 0);
+	if (fd == -1) {
+		perror("cannot open netlink socket");
+		if_freenameindex(ifaces);
+		return 1;
+	}
+
+	/**
+	 * Without sysfs, every interface is asked for.
+	 */
+	sysfs = open("/sys/class/net", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	for (size_t i = 0; ifaces[i].if_index != 0 && err == 0; i++) {
+		struct {
+			struct nlmsghdr  hdr;
+			struct ifinfomsg ifi;
+			char             attrs[16];
+		} req = { 0 };
+
+		if (sriov_numvfs(sysfs, ifaces[i].if_name) == 0) {
+			continue;
+		}
+
+		req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifi));
+		req.hdr.nlmsg_type  = RTM_GETLINK;
+		req.hdr.nlmsg_flags = NLM_F_REQUEST;
+		req.ifi.ifi_index   = ifaces[i].if_index;
+		nl_attr_put(
+		  &req.hdr, sizeof(req), IFLA_EXT_MASK, &mask, sizeof(mask));
+
+		err = nl_transact_sized(
+		  fd, &req.hdr, sriov_print_link, ifaces[i].if_name);
+
+		/**
+		 * The interface went away since it was listed.
+		 */
+		if (err == -ENODEV) {
+			err = 0;
+		}
+	}
+
+	if (sysfs != -1) {
+		close(sysfs);
+	}
+	close(fd);
+	if_freenameindex(ifaces);
+
+	if (err < 0) {
+		fprintf(
+		  stderr, "cannot get virtual functions: %s\n", strerror(-err));
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef IFACER__SRIOV_H
+#define IFACER__SRIOV_H
+
+/**
+ * sriov - the SR-IOV virtual functions of every physical function, with
+ *         their settings and counters (`--vfs`).
+ *
+ * The kernel only reports VFs on links asked for with RTEXT_FILTER_VF, and
+ * then reports all of them, with their stats, in the link's message: with
+ * 128 VFs that's over 30KiB, so a dump of every link with the filter set
+ * either needs huge datagrams or comes back truncated. Instead, physical
+ * functions are found through sysfs (those with `device/sriov_numvfs`
+ * above 0), and each is asked for on its own (RTM_GETLINK with its
+ * index), over a single socket, into a buffer sized to the answer (see
+ * `nl_recv_sized`). Links without VFs never cost a request.
+ *
+ * Output, one record per VF:
+ *
+ *      iface: eth0
+ *      vf: 3
+ *      mac: 02:00:00:00:00:03
+ *      vlan: 100
+ *      qos: 0
+ *      spoof-check: on
+ *      trust: off
+ *      link-state: auto
+ *      max-tx-rate: 0
+ *      min-tx-rate: 0
+ *      rx-bytes: 81263
+ *      rx-packets: 764
+ *      ...
+ *
+ * with `iface` the physical function, rates in Mbit/s (0 for none) and
+ * the settings the driver doesn't report left out.
+ */
+
+/**
+ * Prints the VFs of every physical function.
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+sriov_run(void);
+
+#endif
@@ -0,0 +1,169 @@
+#include "./stats.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+struct stats_counters {
+	uint64_t time_ns;
+	uint64_t syscalls;
+	uint64_t bytes;
+};
+
+static const char* stats_phase_names[STATS_PHASE_MAX] = {
+	[STATS_PHASE_STARTUP] = "startup",   [STATS_PHASE_SOCKET] = "socket",
+	[STATS_PHASE_IFCONF] = "ifconf",     [STATS_PHASE_IFADDR] = "ifaddr",
+	[STATS_PHASE_LOCALITY] = "locality", [STATS_PHASE_QUERY] = "query",
+	[STATS_PHASE_OUTPUT] = "output",
+};
+
+int stats_enabled = 0;
+
+/**
+ * Phases are only ever marked by the main thread; syscalls may be charged
+ * from worker threads (e.g., `--ethtool-stats`), hence the atomics.
+ */
+static struct {
+	enum stats_format     format;
+	enum stats_phase      current;
+	uint64_t              mark_ns;
+	struct stats_counters phases[STATS_PHASE_MAX];
+	long                  arena_bytes;
+	long                  arena_peak;
+} stats;
+
+static uint64_t
+stats_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void
+stats_phase_slow(enum stats_phase phase)
+{
+	uint64_t now = stats_now_ns();
+
+	stats.phases[stats.current].time_ns += now - stats.mark_ns;
+	stats.mark_ns = now;
+	__atomic_store_n(&stats.current, phase, __ATOMIC_RELAXED);
+}
+
+void
+stats_syscall_slow(size_t bytes)
+{
+	struct stats_counters* counters =
+	  &stats.phases[__atomic_load_n(&stats.current, __ATOMIC_RELAXED)];
+
+	__atomic_add_fetch(&counters->syscalls, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&counters->bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void
+stats_memory_slow(long delta)
+{
+	long bytes =
+	  __atomic_add_fetch(&stats.arena_bytes, delta, __ATOMIC_RELAXED);
+	long peak = __atomic_load_n(&stats.arena_peak, __ATOMIC_RELAXED);
+
+	while (bytes > peak && !__atomic_compare_exchange_n(&stats.arena_peak,
+	                                                    &peak,
+	                                                    bytes,
+	                                                    1,
+	                                                    __ATOMIC_RELAXED,
+	                                                    __ATOMIC_RELAXED)) {
+	}
+}
+
+static void
+stats_report(void)
+{
+	struct stats_counters total = { 0 };
+	struct rusage         usage = { 0 };
+
+	/**
+	 * Whatever is still buffered is part of the output.
+	 */
+	stats_phase_slow(STATS_PHASE_OUTPUT);
+	fflush(stdout);
+	stats_phase_slow(STATS_PHASE_OUTPUT);
+
+	for (int i = 0; i < STATS_PHASE_MAX; i++) {
+		total.time_ns += stats.phases[i].time_ns;
+		total.syscalls += stats.phases[i].syscalls;
+		total.bytes += stats.phases[i].bytes;
+	}
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	if (stats.format == STATS_FORMAT_JSON) {
+		fprintf(stderr, "{\"phases\":{");
+		for (int i = 0; i < STATS_PHASE_MAX; i++) {
+			fprintf(stderr,
+			        "%s\"%s\":{\"time_ns\":%llu,\"syscalls\":%llu,"
+			        "\"bytes\":%llu}",
+			        i ? "," : "",
+			        stats_phase_names[i],
+			        (unsigned long long)stats.phases[i].time_ns,
+			        (unsigned long long)stats.phases[i].syscalls,
+			        (unsigned long long)stats.phases[i].bytes);
+		}
+		fprintf(stderr,
+		        "},\"total\":{\"time_ns\":%llu,\"syscalls\":%llu,"
+		        "\"bytes\":%llu},\"memory\":{\"arena_peak_bytes\":%ld,"
+		        "\"rss_peak_kb\":%ld}}\n",
+		        (unsigned long long)total.time_ns,
+		        (unsigned long long)total.syscalls,
+		        (unsigned long long)total.bytes,
+		        stats.arena_peak,
+		        usage.ru_maxrss);
+		return;
+	}
+
+	fprintf(stderr,
+	        "%-10s %12s %10s %12s\n",
+	        "phase",
+	        "time_us",
+	        "syscalls",
+	        "bytes");
+	for (int i = 0; i <= STATS_PHASE_MAX; i++) {
+		const struct stats_counters* counters =
+		  i < STATS_PHASE_MAX ? &stats.phases[i] : &total;
+
+		fprintf(stderr,
+		        "%-10s %12.1f %10llu %12llu\n",
+		        i < STATS_PHASE_MAX ? stats_phase_names[i] : "total",
+		        counters->time_ns / 1e3,
+		        (unsigned long long)counters->syscalls,
+		        (unsigned long long)counters->bytes);
+	}
+
+	fprintf(stderr, "arena_peak_bytes: %ld\n", stats.arena_peak);
+	fprintf(stderr, "rss_peak_kb: %ld\n", usage.ru_maxrss);
+}
+
+int
+stats_enable(const char* format)
+{
+	if (format == NULL || !strcmp(format, "text")) {
+		stats.format = STATS_FORMAT_TEXT;
+	} else if (!strcmp(format, "json")) {
+		stats.format = STATS_FORMAT_JSON;
+	} else {
+		errno = EINVAL;
+		return -1;
+	}
+
+	stats.current = STATS_PHASE_STARTUP;
+	stats.mark_ns = stats_now_ns();
+	stats_enabled = 1;
+	atexit(stats_report);
+
+	return 0;
+}
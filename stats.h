@@ -0,0 +1,103 @@
+#ifndef IFACER__STATS_H
+#define IFACER__STATS_H
+
+/**
+ * stats - tells where a run spends its time (`--stats`).
+ *
+ * A run is split in phases (opening the socket, SIOCGIFCONF, the
+ * per-interface SIOCGIFADDR loop, output, ...). Code marks the phase it is
+ * entering with `stats_phase()`; the time elapsed since the previous mark
+ * (CLOCK_MONOTONIC) is charged to the previous phase, so phases that are
+ * interleaved (e.g., one ioctl, one line of output, one ioctl, ...) still
+ * add up correctly.
+ *
+ * Every request to the kernel goes through `kio`, which charges one syscall
+ * and the bytes the kernel wrote back to the current phase. Under
+ * `--replay` those are the requests that would have been made.
+ *
+ * Memory held by arenas (see `arena.h`) is tracked as chunks come and go;
+ * its peak is reported along with the peak resident set size of the
+ * process.
+ *
+ * The summary is written to stderr at exit, either as a table or (with
+ * `--stats=json`) as a single JSON object.
+ *
+ * When stats are disabled, each hook costs a single, predictable branch on
+ * `stats_enabled`.
+ */
+
+#include <stddef.h>
+
+enum stats_phase {
+	STATS_PHASE_STARTUP = 0,
+	STATS_PHASE_SOCKET,
+	STATS_PHASE_IFCONF,
+	STATS_PHASE_IFADDR,
+	STATS_PHASE_LOCALITY,
+	STATS_PHASE_QUERY,
+	STATS_PHASE_OUTPUT,
+	STATS_PHASE_MAX,
+};
+
+enum stats_format {
+	STATS_FORMAT_TEXT = 0,
+	STATS_FORMAT_JSON,
+};
+
+extern int stats_enabled;
+
+/**
+ * Enables the instrumentation and registers the summary to be written at
+ * exit. `format` is NULL (table) or "json".
+ *
+ * Returns -1 (with errno set to EINVAL) for an unknown format.
+ */
+int
+stats_enable(const char* format);
+
+void
+stats_phase_slow(enum stats_phase phase);
+
+void
+stats_syscall_slow(size_t bytes);
+
+void
+stats_memory_slow(long delta);
+
+/**
+ * Charges the time since the last mark to the current phase and makes
+ * `phase` the current one.
+ */
+static inline void
+stats_phase(enum stats_phase phase)
+{
+	if (__builtin_expect(stats_enabled, 0)) {
+		stats_phase_slow(phase);
+	}
+}
+
+/**
+ * Charges one syscall that got `bytes` back from the kernel to the current
+ * phase.
+ */
+static inline void
+stats_syscall(size_t bytes)
+{
+	if (__builtin_expect(stats_enabled, 0)) {
+		stats_syscall_slow(bytes);
+	}
+}
+
+/**
+ * Accounts for `delta` bytes of arena memory being acquired (or, when
+ * negative, released).
+ */
+static inline void
+stats_memory(long delta)
+{
+	if (__builtin_expect(stats_enabled, 0)) {
+		stats_memory_slow(delta);
+	}
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "./strtab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Slots hold `id + 1` so that zeroed memory means empty.
+ */
+#define STRTAB_EMPTY 0
+
+static uint32_t
+strtab_hash(const char* str, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t*
+strtab_slot(const struct strtab* strtab,
+            uint32_t             hash,
+            const char*          str,
+            size_t               len)
+{
+	size_t mask = strtab->n_slots - 1;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		uint32_t*   slot = &strtab->slots[i];
+		const char* candidate;
+
+		if (*slot == STRTAB_EMPTY) {
+			return slot;
+		}
+
+		candidate = strtab->data + *slot - 1;
+		if (!strncmp(candidate, str, len) && candidate[len] == '\0') {
+			return slot;
+		}
+	}
+}
+
+static int
+strtab_rehash(struct strtab* strtab)
+{
+	size_t    n_slots = strtab->n_slots ? strtab->n_slots * 2 : 256;
+	uint32_t* slots   = calloc(n_slots, sizeof(*slots));
+	uint32_t* old     = strtab->slots;
+	size_t    n_old   = strtab->n_slots;
+
+	if (slots == NULL) {
+		return -1;
+	}
+
+	strtab->slots   = slots;
+	strtab->n_slots = n_slots;
+
+	for (size_t i = 0; i < n_old; i++) {
+		const char* str;
+		size_t      len;
+
+		if (old[i] == STRTAB_EMPTY) {
+			continue;
+		}
+
+		str = strtab->data + old[i] - 1;
+		len = strlen(str);
+		*strtab_slot(strtab, strtab_hash(str, len), str, len) = old[i];
+	}
+
+	free(old);
+	return 0;
+}
+
+uint32_t
+strtab_intern(struct strtab* strtab, const char* str, size_t len)
+{
+	uint32_t* slot;
+	uint32_t  id;
+
+	if ((strtab->count + 1) * 2 > strtab->n_slots &&
+	    strtab_rehash(strtab) < 0) {
+		return STRTAB_NONE;
+	}
+
+	slot = strtab_slot(strtab, strtab_hash(str, len), str, len);
+	if (*slot != STRTAB_EMPTY) {
+		return *slot - 1;
+	}
+
+	if (strtab->len + len + 1 > strtab->cap) {
+		size_t cap = strtab->cap ? strtab->cap : 4096;
+		char*  data;
+
+		while (cap < strtab->len + len + 1) {
+			cap *= 2;
+		}
+
+		if (cap >= STRTAB_NONE) {
+			return STRTAB_NONE;
+		}
+
+		data = realloc(strtab->data, cap);
+		if (data == NULL) {
+			return STRTAB_NONE;
+		}
+
+		strtab->data = data;
+		strtab->cap  = cap;
+	}
+
+	id = strtab->len;
+	memcpy(strtab->data + id, str, len);
+	strtab->data[id + len] = '\0';
+	strtab->len += len + 1;
+	strtab->count++;
+	*slot = id + 1;
+
+	return id;
+}
+
+void
+strtab_free(struct strtab* strtab)
+{
+	free(strtab->data);
+	free(strtab->slots);
+	*strtab = (struct strtab){ 0 };
+}
@@ -0,0 +1,47 @@
+#ifndef IFACER__STRTAB_H
+#define IFACER__STRTAB_H
+
+/**
+ * strtab - an interned string table.
+ *
+ * Every distinct string is stored once, NUL-terminated, in a single
+ * growing buffer, and is referred to by a 32-bit id (its offset in the
+ * buffer). At fleet scale the same few names (`lo`, `eth0`, `veth...`)
+ * repeat across thousands of namespaces, so records carrying a 4-byte id
+ * instead of a 16-byte name shrink considerably, and comparing two names
+ * of the same table is comparing two integers.
+ *
+ * Lookups go through an open-addressing hash table of ids.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STRTAB_NONE UINT32_MAX
+
+struct strtab {
+	char*     data;
+	size_t    len;
+	size_t    cap;
+	uint32_t* slots;
+	size_t    n_slots;
+	size_t    count;
+};
+
+/**
+ * Returns the id of the string `str` (`len` bytes, no NUL needed), adding
+ * it if it's not there yet, or STRTAB_NONE if out of memory.
+ */
+uint32_t
+strtab_intern(struct strtab* strtab, const char* str, size_t len);
+
+static inline const char*
+strtab_get(const struct strtab* strtab, uint32_t id)
+{
+	return strtab->data + id;
+}
+
+void
+strtab_free(struct strtab* strtab);
+
+#endif
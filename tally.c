@@ -0,0 +1,127 @@
+#include "./tally.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t
+tally_hash(const void* key, size_t len)
+{
+	const uint8_t* bytes = key;
+	uint32_t       hash  = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Returns the slot of `key` in `records`, or the free slot it would go in.
+ */
+static size_t
+tally_slot(const struct tally* tally,
+           const char*         records,
+           const uint8_t*      used,
+           size_t              cap,
+           const void*         key)
+{
+	for (size_t i = tally_hash(key, tally->key_len) & (cap - 1);;
+	     i        = (i + 1) & (cap - 1)) {
+		if (!used[i] ||
+		    !memcmp(records + i * tally->size, key, tally->key_len)) {
+			return i;
+		}
+	}
+}
+
+static int
+tally_grow(struct tally* tally)
+{
+	size_t   cap     = tally->cap ? tally->cap * 2 : 64;
+	char*    records = calloc(cap, tally->size);
+	uint8_t* used    = calloc(cap, sizeof(*used));
+
+	if (records == NULL || used == NULL) {
+		free(records);
+		free(used);
+		return -1;
+	}
+
+	for (size_t i = 0; i < tally->cap; i++) {
+		const char* record = tally_at(tally, i);
+		size_t      slot;
+
+		if (!tally->used[i]) {
+			continue;
+		}
+
+		slot = tally_slot(tally, records, used, cap, record);
+		memcpy(records + slot * tally->size, record, tally->size);
+		used[slot] = 1;
+	}
+
+	free(tally->records);
+	free(tally->used);
+	tally->records = records;
+	tally->used    = used;
+	tally->cap     = cap;
+	tally->last    = NULL;
+
+	return 0;
+}
+
+void*
+tally_get(struct tally* tally, const void* key)
+{
+	size_t slot;
+
+	if (tally->last != NULL && !memcmp(tally->last, key, tally->key_len)) {
+		return tally->last;
+	}
+
+	if ((tally->count + 1) * 2 > tally->cap && tally_grow(tally) != 0) {
+		return NULL;
+	}
+
+	slot = tally_slot(tally, tally->records, tally->used, tally->cap, key);
+	if (!tally->used[slot]) {
+		memcpy(tally_at(tally, slot), key, tally->key_len);
+		tally->used[slot] = 1;
+		tally->count++;
+	}
+
+	tally->last = tally_at(tally, slot);
+	return tally->last;
+}
+
+size_t
+tally_sort(struct tally* tally, int (*compare)(const void*, const void*))
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < tally->cap; i++) {
+		if (tally->used[i] && n++ != i) {
+			memcpy(tally_at(tally, n - 1),
+			       tally_at(tally, i),
+			       tally->size);
+		}
+	}
+
+	qsort(tally->records, n, tally->size, compare);
+	tally->last = NULL;
+
+	return n;
+}
+
+void
+tally_free(struct tally* tally)
+{
+	free(tally->records);
+	free(tally->used);
+	tally->records = NULL;
+	tally->used    = NULL;
+	tally->count   = 0;
+	tally->cap     = 0;
+	tally->last    = NULL;
+}
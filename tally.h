@@ -0,0 +1,59 @@
+#ifndef IFACER__TALLY_H
+#define IFACER__TALLY_H
+
+/**
+ * tally - counters (or any fixed-size records) keyed by a fixed-size key,
+ *         for modes that aggregate a dump (e.g., sockets per local
+ *         address, forwarding entries per port).
+ *
+ * Records live in an open-addressing table (linear probing), the key at
+ * the start of each record. Dumps tend to list the entries of a key in a
+ * row, so the record hit last is checked before hashing.
+ *
+ * A tally is set up by its record size and key length, e.g.:
+ *
+ *      struct tally tally = { .size    = sizeof(struct port),
+ *                             .key_len = offsetof(struct port, counts) };
+ *
+ * Keys are compared (and hashed) byte by byte: padding must be zeroed.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct tally {
+	size_t size;
+	size_t key_len;
+
+	char*    records;
+	uint8_t* used;
+	size_t   count;
+	size_t   cap; /* a power of 2 */
+	void*    last;
+};
+
+/**
+ * Returns the record of `key` (`key_len` bytes), adding it (zeroed but for
+ * the key) if it's not there yet, or NULL if out of memory.
+ */
+void*
+tally_get(struct tally* tally, const void* key);
+
+/**
+ * Packs the records at the front of the table, then sorts them with
+ * `compare` so that the output is stable. Returns how many there are,
+ * to be read with `tally_at`; nothing can be added afterwards.
+ */
+size_t
+tally_sort(struct tally* tally, int (*compare)(const void*, const void*));
+
+static inline void*
+tally_at(const struct tally* tally, size_t i)
+{
+	return tally->records + i * tally->size;
+}
+
+void
+tally_free(struct tally* tally);
+
+#endif
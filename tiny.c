@@ -0,0 +1,334 @@
+/**
+ * tiny - the default listing of ifacer (interfaces that have an IPv4
+ *        address, see `main.c`) as a freestanding program (`make tiny`).
+ *
+ * Readiness probes and init containers exec the listing over and over, and
+ * most of what a static glibc binary does on each exec (TLS and locale
+ * set-up, stdio, IRELATIVE relocations, atexit handlers) has nothing to do
+ * with the answer. This build has none of it:
+ *
+ *   - `_start` is ours and calls straight into `tiny_main`;
+ *   - the kernel is talked to with raw syscalls (socket, ioctl, mmap,
+ *     write, exit_group); and
+ *   - output is formatted by hand into a single buffer, written with one
+ *     `write(2)` whenever it fills up and at exit.
+ *
+ * The output and exit codes match `./main.out` with no options (1 if the
+ * socket can't be opened or memory can't be had, 2 if an ioctl fails);
+ * errors are reported as `<what>: errno <n>` on stderr.
+ *
+ * Only x86_64 and aarch64 are supported.
+ */
+
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#define TINY_OUT_SIZE 65536
+
+#if defined(__x86_64__)
+
+__asm__(".text\n"
+        ".global _start\n"
+        "_start:\n"
+        "	xor %rbp, %rbp\n"
+        "	and $-16, %rsp\n"
+        "	call tiny_main\n"
+        "	mov %eax, %edi\n"
+        "	mov $231, %eax\n" /* exit_group */
+        "	syscall\n"
+        "	hlt\n");
+
+static long
+tiny_syscall(long n, long a, long b, long c, long d, long e, long f)
+{
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8")   = e;
+	register long r9 __asm__("r9")   = f;
+	long          ret;
+
+	__asm__ volatile(
+	  "syscall"
+	  : "=a"(ret)
+	  : "a"(n), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+	  : "rcx", "r11", "memory");
+	return ret;
+}
+
+#elif defined(__aarch64__)
+
+__asm__(".text\n"
+        ".global _start\n"
+        "_start:\n"
+        "	mov x29, #0\n"
+        "	mov x30, #0\n"
+        "	bl tiny_main\n"
+        "	mov x8, #94\n" /* exit_group */
+        "	svc #0\n");
+
+static long
+tiny_syscall(long n, long a, long b, long c, long d, long e, long f)
+{
+	register long x8 __asm__("x8") = n;
+	register long x0 __asm__("x0") = a;
+	register long x1 __asm__("x1") = b;
+	register long x2 __asm__("x2") = c;
+	register long x3 __asm__("x3") = d;
+	register long x4 __asm__("x4") = e;
+	register long x5 __asm__("x5") = f;
+
+	__asm__ volatile("svc #0"
+	                 : "+r"(x0)
+	                 : "r"(x8), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5)
+	                 : "memory");
+	return x0;
+}
+
+#else
+#error "tiny only supports x86_64 and aarch64"
+#endif
+
+/**
+ * The compiler may turn struct initializations and copies into calls to
+ * these even when freestanding.
+ */
+void*
+memset(void* dst, int c, size_t len)
+{
+	unsigned char* d = dst;
+
+	while (len--) {
+		*d++ = c;
+	}
+
+	return dst;
+}
+
+void*
+memcpy(void* dst, const void* src, size_t len)
+{
+	unsigned char*       d = dst;
+	const unsigned char* s = src;
+
+	while (len--) {
+		*d++ = *s++;
+	}
+
+	return dst;
+}
+
+struct tiny_out {
+	char   buf[TINY_OUT_SIZE];
+	size_t len;
+};
+
+static struct tiny_out tiny_out;
+
+static void
+tiny_write(int fd, const char* data, size_t len)
+{
+	while (len > 0) {
+		long n = tiny_syscall(SYS_write, fd, (long)data, len, 0, 0, 0);
+
+		if (n == -4 /* EINTR */) {
+			continue;
+		}
+		if (n < 0) {
+			return;
+		}
+
+		data += n;
+		len -= n;
+	}
+}
+
+static void
+tiny_flush(void)
+{
+	tiny_write(1, tiny_out.buf, tiny_out.len);
+	tiny_out.len = 0;
+}
+
+static void
+tiny_put(const char* str, size_t len)
+{
+	if (tiny_out.len + len > sizeof(tiny_out.buf)) {
+		tiny_flush();
+	}
+
+	memcpy(tiny_out.buf + tiny_out.len, str, len);
+	tiny_out.len += len;
+}
+
+static size_t
+tiny_strlen(const char* str, size_t max)
+{
+	size_t len = 0;
+
+	while (len < max && str[len] != '\0') {
+		len++;
+	}
+
+	return len;
+}
+
+/**
+ * Formats `value` in decimal at the end of `buf` (which must have room
+ * for 20 digits); returns where it starts.
+ */
+static char*
+tiny_decimal(char* end, unsigned long value)
+{
+	do {
+		*--end = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	return end;
+}
+
+static void
+tiny_error(const char* what, long err)
+{
+	char   buf[128];
+	char   digits[20];
+	char*  num = tiny_decimal(digits + sizeof(digits), -err);
+	size_t len = tiny_strlen(what, 64);
+
+	memcpy(buf, what, len);
+	memcpy(buf + len, ": errno ", 8);
+	len += 8;
+	memcpy(buf + len, num, digits + sizeof(digits) - num);
+	len += digits + sizeof(digits) - num;
+	buf[len++] = '\n';
+
+	tiny_write(2, buf, len);
+}
+
+static void
+tiny_put_ipv4(const struct in_addr* addr)
+{
+	const unsigned char* octets = (const unsigned char*)&addr->s_addr;
+	char                 buf[16];
+	size_t               len = 0;
+
+	for (int i = 0; i < 4; i++) {
+		char  digits[3];
+		char* num = tiny_decimal(digits + sizeof(digits), octets[i]);
+
+		if (i > 0) {
+			buf[len++] = '.';
+		}
+
+		while (num < digits + sizeof(digits)) {
+			buf[len++] = *num++;
+		}
+	}
+
+	tiny_put(buf, len);
+}
+
+static void*
+tiny_alloc(size_t len)
+{
+	long ret = tiny_syscall(SYS_mmap,
+	                        0,
+	                        len,
+	                        PROT_READ | PROT_WRITE,
+	                        MAP_PRIVATE | MAP_ANONYMOUS,
+	                        -1,
+	                        0);
+
+	return ret < 0 && ret > -4096 ? NULL : (void*)ret;
+}
+
+static void
+tiny_free(void* ptr, size_t len)
+{
+	tiny_syscall(SYS_munmap, (long)ptr, len, 0, 0, 0, 0);
+}
+
+int
+tiny_main(void)
+{
+	struct ifconf config = { 0 };
+	struct ifreq* ifreq  = NULL;
+	size_t        size   = 0;
+	long          fd;
+	long          err;
+	int           number_of_ifaces;
+
+	fd = tiny_syscall(SYS_socket, AF_INET, SOCK_STREAM, 0, 0, 0, 0);
+	if (fd < 0) {
+		tiny_error("cannot open socket", fd);
+		return 1;
+	}
+
+	/**
+	 * Same as the default listing: ask how big the answer is, then
+	 * retry with a bigger buffer for as long as it comes back full.
+	 */
+	err = tiny_syscall(SYS_ioctl, fd, SIOCGIFCONF, (long)&config, 0, 0, 0);
+	if (err < 0) {
+		tiny_error("ioctl SIOCGIFCONF failed", err);
+		return 2;
+	}
+
+	for (size_t capacity = config.ifc_len + 4 * sizeof(struct ifreq);;
+	     capacity *= 2) {
+		if (ifreq != NULL) {
+			tiny_free(ifreq, size);
+		}
+
+		size  = capacity;
+		ifreq = tiny_alloc(size);
+		if (ifreq == NULL) {
+			tiny_error("cannot allocate", -12 /* ENOMEM */);
+			return 1;
+		}
+
+		config.ifc_buf = (char*)ifreq;
+		config.ifc_len = capacity;
+
+		err = tiny_syscall(
+		  SYS_ioctl, fd, SIOCGIFCONF, (long)&config, 0, 0, 0);
+		if (err < 0) {
+			tiny_error("ioctl SIOCGIFCONF failed", err);
+			return 2;
+		}
+
+		if ((size_t)config.ifc_len < capacity) {
+			break;
+		}
+	}
+
+	number_of_ifaces = config.ifc_len / sizeof(struct ifreq);
+
+	for (int i = 0; i < number_of_ifaces; i++) {
+		const char* name = ifreq[i].ifr_name;
+
+		tiny_put("iface: ", 7);
+		tiny_put(name, tiny_strlen(name, IFNAMSIZ));
+		tiny_put("\n", 1);
+
+		err = tiny_syscall(
+		  SYS_ioctl, fd, SIOCGIFADDR, (long)&ifreq[i], 0, 0, 0);
+		if (err < 0) {
+			tiny_flush();
+			tiny_error("ioctl failed", err);
+			return 2;
+		}
+
+		tiny_put("ip: ", 4);
+		tiny_put_ipv4(
+		  &((struct sockaddr_in*)&ifreq[i].ifr_addr)->sin_addr);
+		tiny_put("\n\n", 2);
+	}
+
+	tiny_flush();
+	return 0;
+}
@@ -0,0 +1,802 @@
+#define _GNU_SOURCE
+#include "./top.h"
+#include "./arena.h"
+#include "./interrupt.h"
+#include "./nl.h"
+
+#include <errno.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Rows shown when stdout isn't a terminal (and `rows` isn't given).
+ */
+#define TOP_DEFAULT_ROWS 20
+
+/**
+ * Widest line drawn; wider terminals just get blank space on the right.
+ */
+#define TOP_LINE_MAX 256
+
+/**
+ * Lines above the table: a title and the column headers.
+ */
+#define TOP_HEADER_LINES 2
+
+enum top_key {
+	TOP_KEY_RX = 0,
+	TOP_KEY_TX,
+	TOP_KEY_RX_PACKETS,
+	TOP_KEY_TX_PACKETS,
+	TOP_KEY_DROPS,
+	TOP_KEY_ERRORS,
+	TOP_N_KEYS,
+};
+
+static const char* top_sort_names[TOP_N_KEYS] = {
+	[TOP_KEY_RX]     = "rx",
+	[TOP_KEY_TX]     = "tx",
+	[TOP_KEY_DROPS]  = "drops",
+	[TOP_KEY_ERRORS] = "errors",
+};
+
+struct top_entry {
+	int      ifindex;
+	char     name[IFNAMSIZ];
+	uint64_t prev[TOP_N_KEYS];
+	uint64_t rates[TOP_N_KEYS];
+};
+
+struct top {
+	int          fd;
+	int          tty;
+	int          rows;
+	enum top_key sort;
+
+	/**
+	 * Every interface of the last dump, sorted by ifindex, and those of
+	 * the dump before, which rates are computed against. Each list
+	 * lives in its own arena: a dump resets the older one and fills it
+	 * (interfaces that are gone just aren't carried over).
+	 */
+	struct arena      arenas[2];
+	int               current;
+	struct top_entry* entries;
+	size_t            n_entries;
+	size_t            cap_entries;
+	struct top_entry* prev_entries;
+	size_t            n_prev_entries;
+	int               unnamed;
+
+	/**
+	 * Milliseconds between the last two dumps.
+	 */
+	int64_t last_ms;
+	int64_t elapsed_ms;
+
+	/**
+	 * Indexes of the entries shown (a heap while being picked).
+	 */
+	size_t* shown;
+	size_t  cap_shown;
+
+	/**
+	 * The lines on screen, to only redraw the ones that change, and the
+	 * output of a frame.
+	 */
+	char*          screen;
+	size_t         screen_lines;
+	struct winsize size;
+	char*          out;
+	size_t         out_len;
+	size_t         out_cap;
+};
+
+static struct termios top_termios;
+static int            top_termios_saved;
+
+static int64_t
+top_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static struct top_entry*
+top_find(struct top_entry* entries, size_t n_entries, int ifindex)
+{
+	size_t lo = 0;
+	size_t hi = n_entries;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (entries[mid].ifindex < ifindex) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo < n_entries && entries[lo].ifindex == ifindex ? &entries[lo]
+	                                                        : NULL;
+}
+
+/**
+ * Adds an entry for `ifindex` to the current dump, keeping the entries
+ * sorted (dumps come in ifindex order, so this is usually an append).
+ */
+static struct top_entry*
+top_insert(struct top* top, int ifindex)
+{
+	size_t at = top->n_entries;
+
+	if (top->n_entries == top->cap_entries) {
+		size_t cap = top->cap_entries ? top->cap_entries * 2 : 64;
+		struct top_entry* entries;
+
+		entries = arena_extend(&top->arenas[top->current],
+		                       top->entries,
+		                       top->n_entries * sizeof(*entries),
+		                       cap * sizeof(*entries));
+		if (entries == NULL) {
+			return NULL;
+		}
+
+		top->entries     = entries;
+		top->cap_entries = cap;
+	}
+
+	while (at > 0 && top->entries[at - 1].ifindex > ifindex) {
+		at--;
+	}
+
+	memmove(&top->entries[at + 1],
+	        &top->entries[at],
+	        (top->n_entries - at) * sizeof(*top->entries));
+	top->n_entries++;
+
+	top->entries[at]         = (struct top_entry){ 0 };
+	top->entries[at].ifindex = ifindex;
+
+	return &top->entries[at];
+}
+
+static int
+top_stats_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct top*                top  = data;
+	const struct if_stats_msg* ifsm = NLMSG_DATA(msg);
+	const struct nlattr*       tb[IFLA_STATS_MAX + 1];
+	struct rtnl_link_stats64   stats;
+	const struct top_entry*    prev;
+	struct top_entry*          entry;
+	uint64_t                   now[TOP_N_KEYS];
+
+	if (msg->nlmsg_type != RTM_NEWSTATS ||
+	    msg->nlmsg_len < NLMSG_LENGTH(sizeof(*ifsm))) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifsm), tb, IFLA_STATS_MAX);
+	if (tb[IFLA_STATS_LINK_64] == NULL ||
+	    nl_attr_len(tb[IFLA_STATS_LINK_64]) < sizeof(stats)) {
+		return 0;
+	}
+
+	memcpy(&stats, nl_attr_data(tb[IFLA_STATS_LINK_64]), sizeof(stats));
+	now[TOP_KEY_RX]         = stats.rx_bytes;
+	now[TOP_KEY_TX]         = stats.tx_bytes;
+	now[TOP_KEY_RX_PACKETS] = stats.rx_packets;
+	now[TOP_KEY_TX_PACKETS] = stats.tx_packets;
+	now[TOP_KEY_DROPS]      = stats.rx_dropped + stats.tx_dropped;
+	now[TOP_KEY_ERRORS]     = stats.rx_errors + stats.tx_errors;
+
+	entry = top_insert(top, ifsm->ifindex);
+	if (entry == NULL) {
+		return -ENOMEM;
+	}
+
+	prev = top_find(top->prev_entries, top->n_prev_entries, ifsm->ifindex);
+	if (prev != NULL) {
+		memcpy(entry->name, prev->name, sizeof(entry->name));
+	} else {
+		top->unnamed = 1;
+	}
+
+	for (int k = 0; k < TOP_N_KEYS; k++) {
+		entry->prev[k] = now[k];
+		if (prev != NULL && top->elapsed_ms > 0 &&
+		    now[k] >= prev->prev[k]) {
+			entry->rates[k] =
+			  (now[k] - prev->prev[k]) * 1000 / top->elapsed_ms;
+		}
+	}
+
+	return 0;
+}
+
+static int
+top_link_cb(const struct nlmsghdr* msg, void* data)
+{
+	struct top*             top = data;
+	const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+	const struct nlattr*    tb[IFLA_MAX + 1];
+	struct top_entry*       entry;
+
+	if (msg->nlmsg_type != RTM_NEWLINK) {
+		return 0;
+	}
+
+	entry = top_find(top->entries, top->n_entries, ifi->ifi_index);
+	if (entry == NULL) {
+		return 0;
+	}
+
+	nl_msg_parse(msg, sizeof(*ifi), tb, IFLA_MAX);
+	if (tb[IFLA_IFNAME] != NULL) {
+		strncpy(
+		  entry->name, nl_attr_str(tb[IFLA_IFNAME]), IFNAMSIZ - 1);
+	}
+
+	return 0;
+}
+
+/**
+ * Takes a sample: one stats dump, plus a link dump if there are new
+ * interfaces to name.
+ */
+static int
+top_sample(struct top* top)
+{
+	struct {
+		struct nlmsghdr hdr;
+		union {
+			struct if_stats_msg ifsm;
+			struct ifinfomsg    ifi;
+		};
+	} req       = { 0 };
+	int64_t now = top_now_ms();
+	int     err;
+
+	top->elapsed_ms = top->last_ms ? now - top->last_ms : 0;
+	top->last_ms    = now;
+
+	top->prev_entries   = top->entries;
+	top->n_prev_entries = top->n_entries;
+	top->current ^= 1;
+	arena_reset(&top->arenas[top->current]);
+	top->entries     = NULL;
+	top->n_entries   = 0;
+	top->cap_entries = 0;
+
+	req.hdr.nlmsg_len    = NLMSG_LENGTH(sizeof(req.ifsm));
+	req.hdr.nlmsg_type   = RTM_GETSTATS;
+	req.hdr.nlmsg_flags  = NLM_F_REQUEST | NLM_F_DUMP;
+	req.ifsm.family      = AF_UNSPEC;
+	req.ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	err = nl_transact(top->fd, &req.hdr, top_stats_cb, top);
+	if (err < 0) {
+		return err;
+	}
+
+	if (top->unnamed) {
+		memset(&req, 0, sizeof(req));
+		req.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(req.ifi));
+		req.hdr.nlmsg_type  = RTM_GETLINK;
+		req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+		err = nl_transact(top->fd, &req.hdr, top_link_cb, top);
+		if (err < 0) {
+			return err;
+		}
+
+		top->unnamed = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Whether entry `a` goes above entry `b`.
+ */
+static int
+top_before(const struct top* top, size_t a, size_t b)
+{
+	uint64_t ra = top->entries[a].rates[top->sort];
+	uint64_t rb = top->entries[b].rates[top->sort];
+
+	if (ra != rb) {
+		return ra > rb;
+	}
+
+	return top->entries[a].ifindex < top->entries[b].ifindex;
+}
+
+/**
+ * Restores the heap property (the entry that goes lowest at the root)
+ * from `i` down.
+ */
+static void
+top_sift_down(const struct top* top, size_t* heap, size_t n, size_t i)
+{
+	for (;;) {
+		size_t worst = i;
+		size_t left  = 2 * i + 1;
+		size_t right = left + 1;
+		size_t tmp;
+
+		if (left < n && top_before(top, heap[worst], heap[left])) {
+			worst = left;
+		}
+		if (right < n && top_before(top, heap[worst], heap[right])) {
+			worst = right;
+		}
+		if (worst == i) {
+			return;
+		}
+
+		tmp         = heap[i];
+		heap[i]     = heap[worst];
+		heap[worst] = tmp;
+		i           = worst;
+	}
+}
+
+/**
+ * Picks the `rows` entries that go on top, in order, into `top->shown`.
+ *
+ * Returns how many there are.
+ */
+static size_t
+top_pick(struct top* top, size_t rows)
+{
+	size_t* heap = top->shown;
+	size_t  n    = 0;
+
+	for (size_t i = 0; i < top->n_entries; i++) {
+		if (n < rows) {
+			heap[n++] = i;
+
+			if (n == rows) {
+				for (size_t j = n / 2; j-- > 0;) {
+					top_sift_down(top, heap, n, j);
+				}
+			}
+		} else if (rows > 0 && top_before(top, i, heap[0])) {
+			heap[0] = i;
+			top_sift_down(top, heap, n, 0);
+		}
+	}
+
+	if (n < rows) {
+		for (size_t j = n / 2; j-- > 0;) {
+			top_sift_down(top, heap, n, j);
+		}
+	}
+
+	/**
+	 * Popping the lowest entry to the end of the heap until it's empty
+	 * leaves the entries in order.
+	 */
+	for (size_t end = n; end > 1; end--) {
+		size_t tmp    = heap[0];
+		heap[0]       = heap[end - 1];
+		heap[end - 1] = tmp;
+		top_sift_down(top, heap, end - 1, 0);
+	}
+
+	return n;
+}
+
+static void
+top_human(char* buf, size_t len, uint64_t value)
+{
+	static const char units[] = "KMGTPE";
+	double            scaled  = value;
+	int               unit    = -1;
+
+	if (value < 1000) {
+		snprintf(buf, len, "%llu", (unsigned long long)value);
+		return;
+	}
+
+	while (scaled >= 1000 && unit < 5) {
+		scaled /= 1000;
+		unit++;
+	}
+
+	snprintf(buf, len, "%.1f%c", scaled, units[unit]);
+}
+
+static int
+top_reserve(struct top* top, size_t len)
+{
+	char* out;
+
+	if (top->out_len + len <= top->out_cap) {
+		return 0;
+	}
+
+	out = realloc(top->out, top->out_len + len + 4096);
+	if (out == NULL) {
+		return -1;
+	}
+
+	top->out     = out;
+	top->out_cap = top->out_len + len + 4096;
+	return 0;
+}
+
+static void
+top_emit(struct top* top, const char* data, size_t len)
+{
+	if (top_reserve(top, len) == 0) {
+		memcpy(top->out + top->out_len, data, len);
+		top->out_len += len;
+	}
+}
+
+/**
+ * Puts `line` on row `row` of the screen, unless it's there already.
+ */
+static void
+top_line(struct top* top, size_t row, const char* line)
+{
+	char* on_screen = top->screen + row * TOP_LINE_MAX;
+	char  move[32];
+
+	if (!top->tty) {
+		top_emit(top, line, strlen(line));
+		top_emit(top, "\n", 1);
+		return;
+	}
+
+	if (row < top->screen_lines && !strcmp(on_screen, line)) {
+		return;
+	}
+
+	snprintf(move, sizeof(move), "\033[%zu;1H", row + 1);
+	top_emit(top, move, strlen(move));
+	top_emit(top, line, strlen(line));
+	top_emit(top, "\033[K", 3);
+	snprintf(on_screen, TOP_LINE_MAX, "%s", line);
+}
+
+static void
+top_flush(struct top* top)
+{
+	size_t off = 0;
+
+	while (off < top->out_len) {
+		ssize_t n =
+		  write(STDOUT_FILENO, top->out + off, top->out_len - off);
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		off += n;
+	}
+
+	top->out_len = 0;
+}
+
+/**
+ * Draws a frame with as many rows as fit.
+ */
+static void
+top_draw(struct top* top)
+{
+	struct winsize ws    = { 0 };
+	size_t         lines = TOP_HEADER_LINES + TOP_DEFAULT_ROWS;
+	size_t         width = TOP_LINE_MAX - 1;
+	size_t         rows;
+	size_t         n;
+	char           line[TOP_LINE_MAX];
+
+	if (top->tty && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 &&
+	    ws.ws_row > TOP_HEADER_LINES) {
+		lines = ws.ws_row;
+		if (ws.ws_col > 0 && ws.ws_col < width) {
+			width = ws.ws_col;
+		}
+
+		/**
+		 * After a resize, what's on screen can't be trusted: start
+		 * over from a blank one.
+		 */
+		if (ws.ws_row != top->size.ws_row ||
+		    ws.ws_col != top->size.ws_col) {
+			top->size         = ws;
+			top->screen_lines = 0;
+			top_emit(top, "\033[H\033[J", 6);
+		}
+	}
+
+	rows = lines - TOP_HEADER_LINES;
+	if (top->rows > 0 && (size_t)top->rows < rows) {
+		rows = top->rows;
+	}
+
+	if (rows > top->cap_shown) {
+		size_t* shown  = realloc(top->shown, rows * sizeof(*shown));
+		char*   screen = realloc(
+                  top->screen, (rows + TOP_HEADER_LINES) * TOP_LINE_MAX);
+
+		if (shown != NULL) {
+			top->shown = shown;
+		}
+		if (screen != NULL) {
+			top->screen = screen;
+		}
+		if (shown == NULL || screen == NULL) {
+			return;
+		}
+
+		top->cap_shown = rows;
+	}
+
+	n = top_pick(top, rows);
+
+	snprintf(line,
+	         width + 1,
+	         "ifacer top: %zu interfaces, sorted by %s "
+	         "(r/t/d/e to sort, q to quit)",
+	         top->n_entries,
+	         top_sort_names[top->sort]);
+	top_line(top, 0, line);
+
+	snprintf(line,
+	         width + 1,
+	         "%-16s %9s %9s %9s %9s %9s %9s",
+	         "IFACE",
+	         "RX B/s",
+	         "TX B/s",
+	         "RX pkt/s",
+	         "TX pkt/s",
+	         "DROP/s",
+	         "ERR/s");
+	top_line(top, 1, line);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct top_entry* entry = &top->entries[top->shown[i]];
+		char                    rates[TOP_N_KEYS][16];
+
+		for (int k = 0; k < TOP_N_KEYS; k++) {
+			top_human(rates[k], sizeof(rates[k]), entry->rates[k]);
+		}
+
+		snprintf(line,
+		         width + 1,
+		         "%-16s %9s %9s %9s %9s %9s %9s",
+		         entry->name[0] ? entry->name : "?",
+		         rates[TOP_KEY_RX],
+		         rates[TOP_KEY_TX],
+		         rates[TOP_KEY_RX_PACKETS],
+		         rates[TOP_KEY_TX_PACKETS],
+		         rates[TOP_KEY_DROPS],
+		         rates[TOP_KEY_ERRORS]);
+		top_line(top, TOP_HEADER_LINES + i, line);
+	}
+
+	if (top->tty) {
+		/**
+		 * Whatever was below the last row (a shrunk table or
+		 * terminal) is cleared.
+		 */
+		if (TOP_HEADER_LINES + n < top->screen_lines) {
+			char move[32];
+
+			snprintf(move,
+			         sizeof(move),
+			         "\033[%zu;1H\033[J",
+			         TOP_HEADER_LINES + n + 1);
+			top_emit(top, move, strlen(move));
+		}
+		top->screen_lines = TOP_HEADER_LINES + n;
+	} else {
+		top_emit(top, "\n", 1);
+	}
+
+	top_flush(top);
+}
+
+static void
+top_restore(void)
+{
+	static const char leave[] = "\033[?25h\033[?1049l";
+
+	if (!top_termios_saved) {
+		return;
+	}
+
+	tcsetattr(STDIN_FILENO, TCSANOW, &top_termios);
+	if (write(STDOUT_FILENO, leave, sizeof(leave) - 1) == -1) {
+		return;
+	}
+}
+
+/**
+ * Switches to the alternate screen, with keys delivered one at a time
+ * and not echoed. Everything is put back at exit.
+ */
+static int
+top_enter(void)
+{
+	static const char enter[] = "\033[?1049h\033[?25l\033[H\033[J";
+	struct termios    raw;
+
+	if (tcgetattr(STDIN_FILENO, &top_termios) == -1) {
+		return -1;
+	}
+
+	raw = top_termios;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN]  = 0;
+	raw.c_cc[VTIME] = 0;
+
+	if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == -1) {
+		return -1;
+	}
+
+	top_termios_saved = 1;
+	atexit(top_restore);
+
+	if (write(STDOUT_FILENO, enter, sizeof(enter) - 1) == -1) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Handles the keys pressed. Returns 1 to quit, 0 otherwise (`*redraw`
+ * set if the order changed).
+ */
+static int
+top_keys(struct top* top, int* redraw)
+{
+	char    keys[16];
+	ssize_t n = read(STDIN_FILENO, keys, sizeof(keys));
+
+	for (ssize_t i = 0; i < n; i++) {
+		switch (keys[i]) {
+			case 'q':
+				return 1;
+			case 'r':
+				top->sort = TOP_KEY_RX;
+				break;
+			case 't':
+				top->sort = TOP_KEY_TX;
+				break;
+			case 'd':
+				top->sort = TOP_KEY_DROPS;
+				break;
+			case 'e':
+				top->sort = TOP_KEY_ERRORS;
+				break;
+			default:
+				continue;
+		}
+		*redraw = 1;
+	}
+
+	return 0;
+}
+
+int
+top_run(int interval_ms, int rows, const char* sort)
+{
+	struct top top = { .rows = rows, .sort = TOP_KEY_RX };
+	int        err = 0;
+
+	if (interval_ms <= 0) {
+		interval_ms = TOP_DEFAULT_INTERVAL_MS;
+	}
+
+	if (sort != NULL) {
+		int k;
+
+		for (k = 0; k < TOP_N_KEYS; k++) {
+			if (top_sort_names[k] != NULL &&
+			    !strcmp(top_sort_names[k], sort)) {
+				break;
+			}
+		}
+
+		if (k == TOP_N_KEYS) {
+			fprintf(stderr, "unknown sort key: %s\n", sort);
+			return 1;
+		}
+
+		top.sort = k;
+	}
+
+	top.fd = nl_open(NETLINK_ROUTE, 0);
+	if (top.fd == -1) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	top.tty = isatty(STDOUT_FILENO) && isatty(STDIN_FILENO);
+	if (top.tty && top_enter() == -1) {
+		perror("cannot set up terminal");
+		close(top.fd);
+		return 1;
+	}
+
+	/**
+	 * Rates need two samples: the first one just primes the counters.
+	 */
+	err = top_sample(&top);
+
+	while (err == 0 && interrupt_signal() == 0) {
+		int64_t deadline = top.last_ms + interval_ms;
+		int64_t left;
+		int     redraw = 0;
+
+		while ((left = deadline - top_now_ms()) > 0) {
+			struct pollfd pfd = { .fd     = STDIN_FILENO,
+				              .events = POLLIN };
+
+			if (interrupt_signal() != 0) {
+				goto out;
+			}
+
+			/**
+			 * Keys are only read from a terminal; otherwise this
+			 * just sleeps (no descriptors to poll).
+			 */
+			if (interrupt_poll(&pfd, top.tty, left) > 0 &&
+			    top_keys(&top, &redraw)) {
+				goto out;
+			}
+
+			if (redraw) {
+				top_draw(&top);
+				redraw = 0;
+			}
+		}
+
+		err = top_sample(&top);
+		if (err == 0) {
+			top_draw(&top);
+		}
+	}
+
+out:
+	close(top.fd);
+	arena_free(&top.arenas[0]);
+	arena_free(&top.arenas[1]);
+	free(top.shown);
+	free(top.screen);
+	free(top.out);
+
+	if (err < 0 && err != -ENODATA) {
+		top_restore();
+		top_termios_saved = 0;
+		errno             = -err;
+		perror("cannot sample counters");
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef IFACER__TOP_H
+#define IFACER__TOP_H
+
+/**
+ * top - a full-screen table of the busiest interfaces, refreshed every
+ *       interval (`--top`).
+ *
+ * Each refresh costs a single RTM_GETSTATS dump asking for nothing but the
+ * 64-bit link counters. Counters are diffed against the previous sample,
+ * kept (along with the name of each interface) in arrays that are only
+ * grown when interfaces appear, so a steady host doesn't allocate at all.
+ * Names come from a link dump, made only when an interface we don't know
+ * yet shows up.
+ *
+ * Only the rows that fit the terminal are sorted: they're picked with a
+ * bounded heap (O(n log rows)) rather than by sorting every interface.
+ *
+ * Frames are drawn on the alternate screen, and only the lines that
+ * changed since the previous frame are rewritten, in a single `write(2)`.
+ * Keys: `r`, `t`, `d` and `e` sort by receive rate, transmit rate, drops
+ * and errors; `q` quits.
+ *
+ * When stdout isn't a terminal, frames are printed one after the other as
+ * plain text.
+ */
+
+/**
+ * Default number of milliseconds between refreshes.
+ */
+#define TOP_DEFAULT_INTERVAL_MS 1000
+
+/**
+ * Runs until `q` or until interrupted, showing at most `rows` interfaces
+ * (as many as fit the terminal if 0), sorted by `sort` ("rx", "tx",
+ * "drops" or "errors"; "rx" if NULL).
+ *
+ * Returns a non-zero exit code on failure.
+ */
+int
+top_run(int interval_ms, int rows, const char* sort);
+
+#endif
@@ -0,0 +1,129 @@
+#include "./watch.h"
+#include "./ifacer.h"
+#include "./interrupt.h"
+#include "./probes.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <string.h>
+
+static void
+watch_on_link(void*                     data,
+              enum ifacer_event         event,
+              const struct ifacer_link* link)
+{
+	const char* netns = data;
+
+	printf("event: %s-link\n", event == IFACER_EVENT_NEW ? "new" : "del");
+	if (netns != NULL) {
+		printf("netns: %s\n", netns);
+	}
+	printf("iface: %s\n", link->name);
+	printf("index: %u\n", link->index);
+	printf("mtu: %u\n", link->mtu);
+
+	if (link->mac != NULL && link->mac_len > 0) {
+		printf("mac: ");
+		for (size_t i = 0; i < link->mac_len; i++) {
+			printf("%s%02x", i ? ":" : "", link->mac[i]);
+		}
+		printf("\n");
+	}
+
+	printf("state: %s\n\n", (link->flags & IFF_UP) ? "up" : "down");
+}
+
+static void
+watch_on_addr(void*                     data,
+              enum ifacer_event         event,
+              const struct ifacer_addr* addr)
+{
+	const char* netns = data;
+	char        ip[INET6_ADDRSTRLEN];
+
+	if (inet_ntop(addr->family, addr->addr, ip, sizeof(ip)) == NULL) {
+		return;
+	}
+
+	printf("event: %s-addr\n", event == IFACER_EVENT_NEW ? "new" : "del");
+	if (netns != NULL) {
+		printf("netns: %s\n", netns);
+	}
+	if (addr->label != NULL) {
+		printf("iface: %s\n", addr->label);
+	}
+	printf("index: %u\n", addr->index);
+	printf("ip: %s/%u\n\n", ip, addr->prefixlen);
+}
+
+static void
+watch_on_synced(void* data)
+{
+	const char* netns = data;
+
+	printf("event: synced\n");
+	if (netns != NULL) {
+		printf("netns: %s\n", netns);
+	}
+	printf("\n");
+}
+
+const struct ifacer_callbacks watch_callbacks = {
+	.on_link   = watch_on_link,
+	.on_addr   = watch_on_addr,
+	.on_synced = watch_on_synced,
+};
+
+int
+watch_run(void)
+{
+	struct ifacer* ifacer;
+	struct pollfd  pfd;
+
+	ifacer = ifacer_open(&watch_callbacks, NULL, IFACER_WATCH);
+	if (ifacer == NULL) {
+		perror("cannot open netlink socket");
+		return 1;
+	}
+
+	pfd = (struct pollfd){ .fd = ifacer_fd(ifacer), .events = POLLIN };
+
+	while (interrupt_signal() == 0) {
+		size_t pending;
+		int    err = ifacer_step(ifacer);
+
+		if (err == -ENODATA) {
+			fflush(stdout);
+			ifacer_close(ifacer);
+			return 0;
+		}
+
+		if (err < 0) {
+			fprintf(stderr, "watch failed: %s\n", strerror(-err));
+			ifacer_close(ifacer);
+			return 2;
+		}
+
+		/**
+		 * Whoever reads us (likely through a pipe) wants to see
+		 * each batch of changes as soon as it happens.
+		 */
+		pending = __fpending(stdout);
+		PROBE1(flush__start, pending);
+		fflush(stdout);
+		PROBE1(flush__end, pending);
+
+		if (interrupt_poll(&pfd, 1, -1) == -1 && errno != EINTR) {
+			perror("poll failed");
+			ifacer_close(ifacer);
+			return 1;
+		}
+	}
+
+	ifacer_close(ifacer);
+	return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef IFACER__WATCH_H
+#define IFACER__WATCH_H
+
+/**
+ * watch - prints the links and addresses of the host and then every change
+ *         to them as it happens (`--watch`).
+ *
+ * This is the reference user of the non-blocking library API (see
+ * `ifacer.h`): a `poll(2)` loop over the single descriptor it hands out,
+ * stepping the state machine whenever it's readable.
+ *
+ * Each record is a block of `key: value` lines followed by a blank line:
+ *
+ *      event: new-link             event: new-addr
+ *      iface: eth0                 index: 4
+ *      index: 4                    ip: 192.0.2.2/24
+ *      mtu: 1500
+ *      mac: 52:54:00:12:34:56
+ *      state: up
+ *
+ * with `event: synced` marking the end of the initial inventory.
+ */
+
+#include "./ifacer.h"
+
+/**
+ * The callbacks printing those records, for `ifacer_open`. When the data
+ * handed to `ifacer_open` isn't NULL, it's the name of the network
+ * namespace the records are about, printed as a `netns:` line.
+ */
+extern const struct ifacer_callbacks watch_callbacks;
+
+/**
+ * Runs until interrupted.
+ *
+ * Returns a non-zero exit code if the kernel could not be asked.
+ */
+int
+watch_run(void);
+
+#endif